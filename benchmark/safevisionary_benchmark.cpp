@@ -0,0 +1,430 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobGenerator.h"
+#include "sick_safevisionary_base/CRC.h"
+#include "sick_safevisionary_base/PointCloudPlyWriter.h"
+#include "sick_safevisionary_base/SafeVisionaryData.h"
+#include "sick_safevisionary_base/SafeVisionaryDataStream.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------
+// Count all allocations of the process, including those of the library
+
+namespace {
+std::atomic<uint64_t> g_numAllocations(0u);
+}
+
+void* operator new(std::size_t size)
+{
+  g_numAllocations.fetch_add(1u, std::memory_order_relaxed);
+  void* ptr = std::malloc((size > 0u) ? size : 1u);
+  if (nullptr == ptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace visionary {
+
+namespace {
+struct Options
+{
+  int width           = 512;
+  int height          = 424;
+  double minTime      = 0.5;
+  std::string filter  = "";
+  std::string format  = "table";
+  std::string plyFile = "safevisionary_benchmark.ply";
+};
+
+struct Result
+{
+  std::string name;
+  uint64_t iterations;
+  double nsPerIteration;
+  double bytesPerSecond;
+  double allocationsPerIteration;
+};
+
+/// Runs each benchmark in batches of doubling size until a batch takes at least the minimum
+/// time, and reports the figures of this last batch.
+class Runner
+{
+public:
+  explicit Runner(const Options& options)
+    : m_options(options)
+  {
+  }
+
+  template <typename Function>
+  void run(const std::string& name, std::size_t bytesPerIteration, Function function)
+  {
+    if (name.find(m_options.filter) == std::string::npos)
+    {
+      return;
+    }
+
+    // warm up caches and lazily initialized state
+    function();
+
+    uint64_t iterations = 1u;
+    while (true)
+    {
+      const uint64_t allocationsBefore = g_numAllocations.load(std::memory_order_relaxed);
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (uint64_t iteration = 0u; iteration < iterations; ++iteration)
+      {
+        function();
+      }
+      const double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      const uint64_t allocations =
+        g_numAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+      if ((elapsed >= m_options.minTime) || (iterations >= (uint64_t(1) << 40)))
+      {
+        Result result;
+        result.name                    = name;
+        result.iterations              = iterations;
+        result.nsPerIteration          = elapsed * 1e9 / static_cast<double>(iterations);
+        result.bytesPerSecond          = static_cast<double>(bytesPerIteration) *
+                                static_cast<double>(iterations) / std::max(elapsed, 1e-12);
+        result.allocationsPerIteration =
+          static_cast<double>(allocations) / static_cast<double>(iterations);
+        m_results.push_back(result);
+        return;
+      }
+      iterations *= 2u;
+    }
+  }
+
+  void print() const
+  {
+    if (m_options.format == "json")
+    {
+      std::printf("{\n  \"width\": %d,\n  \"height\": %d,\n  \"benchmarks\": [\n",
+                  m_options.width,
+                  m_options.height);
+      for (std::size_t idx = 0u; idx < m_results.size(); ++idx)
+      {
+        const Result& result = m_results[idx];
+        std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_frame\": %.1f, "
+                    "\"bytes_per_second\": %.0f, \"allocations_per_frame\": %.2f}%s\n",
+                    result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations),
+                    result.nsPerIteration,
+                    result.bytesPerSecond,
+                    result.allocationsPerIteration,
+                    (idx + 1u < m_results.size()) ? "," : "");
+      }
+      std::printf("  ]\n}\n");
+    }
+    else if (m_options.format == "csv")
+    {
+      std::printf("name,iterations,ns_per_frame,bytes_per_second,allocations_per_frame\n");
+      for (const Result& result : m_results)
+      {
+        std::printf("%s,%llu,%.1f,%.0f,%.2f\n",
+                    result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations),
+                    result.nsPerIteration,
+                    result.bytesPerSecond,
+                    result.allocationsPerIteration);
+      }
+    }
+    else
+    {
+      std::printf("%d x %d\n", m_options.width, m_options.height);
+      std::printf("%-32s %12s %14s %12s %12s\n",
+                  "benchmark",
+                  "iterations",
+                  "ns/frame",
+                  "MB/s",
+                  "allocs/frame");
+      for (const Result& result : m_results)
+      {
+        std::printf("%-32s %12llu %14.1f %12.1f %12.2f\n",
+                    result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations),
+                    result.nsPerIteration,
+                    result.bytesPerSecond / 1e6,
+                    result.allocationsPerIteration);
+      }
+    }
+  }
+
+private:
+  const Options& m_options;
+  std::vector<Result> m_results;
+};
+
+/// Gives the benchmark access to the lookup table calculation
+class BenchmarkData : public SafeVisionaryData
+{
+public:
+  void preCalcRadialCamInfo()
+  {
+    preCalcCamInfo(RADIAL);
+  }
+};
+
+/// Transport which repeats the UDP fragments of one Blob from memory
+class MemoryTransport : public ITransport
+{
+public:
+  explicit MemoryTransport(const std::vector<std::vector<uint8_t>>& datagrams)
+    : m_datagrams(datagrams)
+    , m_next(0u)
+  {
+  }
+
+  int send(const std::vector<std::uint8_t>& buffer) override
+  {
+    return static_cast<int>(buffer.size());
+  }
+
+  int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override
+  {
+    const std::vector<uint8_t>& datagram = m_datagrams[m_next];
+    m_next                               = (m_next + 1u) % m_datagrams.size();
+    const std::size_t size               = std::min(datagram.size(), maxBytesToReceive);
+    buffer.assign(datagram.begin(), datagram.begin() + size);
+    return static_cast<int>(size);
+  }
+
+  int read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive) override
+  {
+    return recv(buffer, nBytesToReceive);
+  }
+
+  int shutdown() override
+  {
+    return 0;
+  }
+
+private:
+  const std::vector<std::vector<uint8_t>>& m_datagrams;
+  std::size_t m_next;
+};
+
+std::size_t getFileSize(const std::string& fileName)
+{
+  std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+  return file ? static_cast<std::size_t>(file.tellg()) : 0u;
+}
+
+void runBenchmarks(const Options& options)
+{
+  Runner runner(options);
+
+  BlobGenerator generator;
+  generator.setResolution(options.width, options.height);
+  std::vector<uint8_t> blob;
+  generator.generate(1u, BlobGenerator::toDeviceTimestamp(std::chrono::system_clock::now()), blob);
+
+  // XML and depth map segment of the canned Blob
+  const uint8_t* const segmentTable = blob.data() + sizeof(BlobDataHeader);
+  const uint32_t xmlBegin  = readUnalignBigEndian<uint32_t>(segmentTable);
+  const uint32_t xmlEnd    = readUnalignBigEndian<uint32_t>(segmentTable + 8u);
+  const uint32_t depthEnd  = readUnalignBigEndian<uint32_t>(segmentTable + 16u);
+  const std::string xml(blob.begin() + BLOB_DATA_SEGMENT_BASE + xmlBegin,
+                        blob.begin() + BLOB_DATA_SEGMENT_BASE + xmlEnd);
+  std::vector<uint8_t> depthSegment(blob.begin() + BLOB_DATA_SEGMENT_BASE + xmlEnd,
+                                    blob.begin() + BLOB_DATA_SEGMENT_BASE + depthEnd);
+
+  // UDP fragments of the canned Blob
+  std::vector<std::vector<uint8_t>> datagrams;
+  for (std::size_t offset = 0u; offset < blob.size(); offset += UDP_FRAGMENT_PAYLOAD_MAX)
+  {
+    const std::size_t payloadSize = std::min(UDP_FRAGMENT_PAYLOAD_MAX, blob.size() - offset);
+    std::vector<uint8_t> datagram(MAX_UDP_BLOB_PACKET_SIZE);
+    datagram.resize(writeUdpFragment(datagram.data(),
+                                     1u,
+                                     static_cast<uint16_t>(datagrams.size()),
+                                     0u,
+                                     (offset + payloadSize) == blob.size(),
+                                     blob.data() + offset,
+                                     payloadSize));
+    datagrams.push_back(datagram);
+  }
+
+  uint32_t crc = 0u;
+  runner.run("crc32/depthmap_segment", depthSegment.size(), [&] {
+    crc ^= CRC_calcCrc32Block(
+      depthSegment.data(), static_cast<uint32_t>(depthSegment.size()), CRC_DEFAULT_INIT_VALUE32);
+  });
+  runner.run("crc32c/blob", blob.size(), [&] {
+    crc ^= CRC_calcCrc32CBlock(
+      blob.data(), static_cast<uint32_t>(blob.size()), CRC_DEFAULT_INIT_VALUE32);
+  });
+  runner.run("crc32c/udp_fragment", datagrams[0].size(), [&] {
+    crc ^= CRC_calcCrc32CBlock(
+      datagrams[0].data(), static_cast<uint32_t>(datagrams[0].size()), CRC_DEFAULT_INIT_VALUE32);
+  });
+
+  BenchmarkData data;
+  VisionaryData& dataHandler = data;
+  uint32_t changeCounter     = 1u;
+  runner.run("data/parseXML", xml.size(), [&] { dataHandler.parseXML(xml, ++changeCounter); });
+  runner.run("data/parseBinaryData", depthSegment.size(), [&] {
+    dataHandler.parseBinaryData(depthSegment.begin(), depthSegment.size());
+  });
+
+  const std::size_t numPixel = static_cast<std::size_t>(options.width * options.height);
+  runner.run("data/preCalcCamInfo", numPixel * sizeof(PointXYZ), [&] {
+    data.preCalcRadialCamInfo();
+  });
+
+  std::vector<PointXYZ> pointCloud;
+  runner.run("data/generatePointCloud", numPixel * sizeof(uint16_t), [&] {
+    data.generatePointCloud(pointCloud);
+  });
+  runner.run("data/transformPointCloud", pointCloud.size() * sizeof(PointXYZ), [&] {
+    data.transformPointCloud(pointCloud);
+  });
+
+  std::shared_ptr<SafeVisionaryData> streamData = std::make_shared<SafeVisionaryData>();
+  SafeVisionaryDataStream stream(streamData);
+  runner.run(
+    "stream/processBlob", blob.size(), [&] { stream.processBlob(blob.data(), blob.size()); });
+
+  SafeVisionaryDataStream udpStream(streamData);
+  udpStream.openUdpConnection(std::unique_ptr<ITransport>(new MemoryTransport(datagrams)));
+  runner.run("stream/getNextBlobUdp", blob.size(), [&] { udpStream.getNextBlobUdp(); });
+
+  const std::vector<uint16_t>& intensityMap = data.getIntensityMap();
+  for (int useBinary = 1; useBinary >= 0; --useBinary)
+  {
+    PointCloudPlyWriter::WriteFormatPLY(
+      options.plyFile.c_str(), pointCloud, intensityMap, useBinary != 0);
+    runner.run(useBinary ? "ply/binary" : "ply/ascii", getFileSize(options.plyFile), [&] {
+      PointCloudPlyWriter::WriteFormatPLY(
+        options.plyFile.c_str(), pointCloud, intensityMap, useBinary != 0);
+    });
+  }
+  std::remove(options.plyFile.c_str());
+
+  // keep the checksums alive
+  if (crc == 0x12345678u)
+  {
+    std::printf(" ");
+  }
+  runner.print();
+}
+
+void printUsage(const char* name)
+{
+  std::printf("Usage: %s [options]\n"
+              "  --width <pixels>   image width (default: 512)\n"
+              "  --height <pixels>  image height (default: 424)\n"
+              "  --min-time <s>     minimum measuring time per benchmark (default: 0.5)\n"
+              "  --filter <text>    only run benchmarks whose name contains the text\n"
+              "  --format <format>  table, json or csv (default: table)\n"
+              "  --ply-file <file>  temporary file of the PLY benchmarks\n",
+              name);
+}
+} // namespace
+
+} // namespace visionary
+
+int main(int argc, char* argv[])
+{
+  visionary::Options options;
+  for (int idx = 1; idx + 1 < argc; idx += 2)
+  {
+    const std::string option = argv[idx];
+    const char* value        = argv[idx + 1];
+    if (option == "--width")
+    {
+      options.width = std::atoi(value);
+    }
+    else if (option == "--height")
+    {
+      options.height = std::atoi(value);
+    }
+    else if (option == "--min-time")
+    {
+      options.minTime = std::atof(value);
+    }
+    else if (option == "--filter")
+    {
+      options.filter = value;
+    }
+    else if (option == "--format")
+    {
+      options.format = value;
+    }
+    else if (option == "--ply-file")
+    {
+      options.plyFile = value;
+    }
+    else
+    {
+      visionary::printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if ((argc % 2) == 0)
+  {
+    visionary::printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  visionary::runBenchmarks(options);
+  return EXIT_SUCCESS;
+}
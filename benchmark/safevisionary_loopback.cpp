@@ -0,0 +1,508 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobGenerator.h"
+#include "sick_safevisionary_base/DeviceEmulator.h"
+#include "sick_safevisionary_base/SafeVisionaryData.h"
+#include "sick_safevisionary_base/SafeVisionaryDataStream.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/UdpSocket.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#  include <pthread.h>
+#  include <time.h>
+#endif
+
+namespace visionary {
+
+namespace {
+struct Options
+{
+  std::vector<unsigned int> cameras     = {1u, 2u, 4u};
+  std::vector<int> receiveBufferSizes   = {128 * 1024, 512 * 1024, 4 * 1024 * 1024};
+  std::vector<double> linkRates         = {0.0, 1000.0};
+  double framesPerSecond                = 30.0;
+  int width                             = 512;
+  int height                            = 424;
+  double warmUp                         = 1.0;
+  double duration                       = 5.0;
+  uint16_t port                         = 6060u;
+  std::string format                    = "table";
+};
+
+/// Measured figures of one configuration
+struct Row
+{
+  unsigned int cameras;
+  int receiveBufferSize;
+  int grantedReceiveBufferSize;
+  double linkRate;
+  double framesPerSecond;
+  double frameLoss;
+  double fragmentLoss;
+  double latencyP50;
+  double latencyP99;
+  double latencyP999;
+  double cpuPerCamera;
+};
+
+/// UDP socket which counts the datagrams received while measuring and keeps the timestamp of the
+/// UDP header, i.e. the time in us the emulator sent the Blob of the last datagram
+class CountingTransport : public ITransport
+{
+public:
+  CountingTransport(std::unique_ptr<UdpSocket> socket, const std::atomic<bool>& measuring)
+    : m_socket(std::move(socket))
+    , m_measuring(measuring)
+    , m_numDatagrams(0u)
+    , m_lastTimestamp(0u)
+  {
+  }
+
+  int send(const std::vector<std::uint8_t>& buffer) override
+  {
+    return m_socket->send(buffer);
+  }
+
+  int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override
+  {
+    const int size = m_socket->recv(buffer, maxBytesToReceive);
+    if ((size > 0) && m_measuring)
+    {
+      m_numDatagrams++;
+    }
+    if (size >= static_cast<int>(sizeof(UdpDataHeader)))
+    {
+      m_lastTimestamp =
+        readUnalignBigEndian<uint32_t>(buffer.data() + offsetof(UdpDataHeader, timeStamp));
+    }
+    return size;
+  }
+
+  int read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive) override
+  {
+    return m_socket->read(buffer, nBytesToReceive);
+  }
+
+  int shutdown() override
+  {
+    return m_socket->shutdown();
+  }
+
+  uint64_t getNumDatagrams() const
+  {
+    return m_numDatagrams;
+  }
+
+  /// \return UDP header timestamp of the last datagram, only read by the receiving thread
+  uint32_t getLastTimestamp() const
+  {
+    return m_lastTimestamp;
+  }
+
+private:
+  std::unique_ptr<UdpSocket> m_socket;
+  const std::atomic<bool>& m_measuring;
+  std::atomic<uint64_t> m_numDatagrams;
+  uint32_t m_lastTimestamp;
+};
+
+/// One SafeVisionaryDataStream receiving an emulated camera in its own thread
+struct Receiver
+{
+  std::shared_ptr<SafeVisionaryData> data;
+  std::unique_ptr<SafeVisionaryDataStream> stream;
+  CountingTransport* transport;
+  std::thread thread;
+  std::atomic<uint64_t> numBlobs;
+  std::vector<uint64_t> latencies;
+  double cpuTimeStart;
+};
+
+uint64_t getSteadyTimeUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+/// \return CPU time of the given thread in seconds, 0 where not supported
+double getThreadCpuTime(std::thread& thread)
+{
+#ifndef _WIN32
+  clockid_t clock;
+  struct timespec time;
+  if ((pthread_getcpuclockid(thread.native_handle(), &clock) == 0) &&
+      (clock_gettime(clock, &time) == 0))
+  {
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+  }
+#endif
+  (void)thread;
+  return 0.0;
+}
+
+double getPercentile(const std::vector<uint64_t>& sorted, double percentile)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  const std::size_t idx = static_cast<std::size_t>(percentile * static_cast<double>(sorted.size()));
+  return static_cast<double>(sorted[std::min(idx, sorted.size() - 1u)]);
+}
+
+void receive(Receiver& receiver, const std::atomic<bool>& measuring, const std::atomic<bool>& stop)
+{
+  while (!stop)
+  {
+    if (!receiver.stream->getNextBlobUdp() || !measuring)
+    {
+      continue;
+    }
+    // the last fragment completed the Blob, its header carries the lower 32 bits of the send time
+    const uint32_t now    = static_cast<uint32_t>(getSteadyTimeUs());
+    const int32_t latency = static_cast<int32_t>(now - receiver.transport->getLastTimestamp());
+    receiver.numBlobs++;
+    receiver.latencies.push_back((latency > 0) ? static_cast<uint64_t>(latency) : 0u);
+  }
+}
+
+bool runConfiguration(const Options& options,
+                      unsigned int cameras,
+                      int receiveBufferSize,
+                      double linkRate,
+                      Row& row)
+{
+  std::atomic<bool> measuring(false);
+  std::atomic<bool> stop(false);
+
+  row                          = Row();
+  row.cameras                  = cameras;
+  row.receiveBufferSize        = receiveBufferSize;
+  row.grantedReceiveBufferSize = 0;
+  row.linkRate                 = linkRate;
+
+  std::vector<std::unique_ptr<Receiver>> receivers;
+  for (unsigned int camera = 0u; camera < cameras; ++camera)
+  {
+    std::unique_ptr<UdpSocket> socket(new UdpSocket());
+    if (socket->bindPort(htons(static_cast<uint16_t>(options.port + camera)), receiveBufferSize) !=
+        0)
+    {
+      std::printf("Failed to bind UDP port %u\n", options.port + camera);
+      return false;
+    }
+    row.grantedReceiveBufferSize = socket->getReceiveBufferSize();
+
+    std::unique_ptr<Receiver> receiver(new Receiver());
+    receiver->data      = std::make_shared<SafeVisionaryData>();
+    receiver->stream    = std::unique_ptr<SafeVisionaryDataStream>(
+      new SafeVisionaryDataStream(receiver->data));
+    receiver->transport = new CountingTransport(std::move(socket), measuring);
+    receiver->stream->openUdpConnection(std::unique_ptr<ITransport>(receiver->transport));
+    receiver->numBlobs     = 0u;
+    receiver->cpuTimeStart = 0.0;
+    receivers.push_back(std::move(receiver));
+  }
+  for (std::unique_ptr<Receiver>& receiver : receivers)
+  {
+    receiver->latencies.reserve(
+      static_cast<std::size_t>(options.duration * std::max(options.framesPerSecond, 1000.0)));
+    receiver->thread =
+      std::thread(receive, std::ref(*receiver), std::cref(measuring), std::cref(stop));
+  }
+
+  DeviceEmulator emulator;
+  emulator.setPort(options.port);
+  emulator.setResolution(options.width, options.height);
+  emulator.setFrameRate(options.framesPerSecond);
+  emulator.setNumCameras(cameras);
+  emulator.setLinkRate(linkRate * 1e6);
+  const bool started = emulator.start();
+
+  if (started)
+  {
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmUp));
+    for (std::unique_ptr<Receiver>& receiver : receivers)
+    {
+      receiver->cpuTimeStart = getThreadCpuTime(receiver->thread);
+    }
+    const uint64_t blobsSentStart                         = emulator.getNumBlobsSent();
+    const std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    measuring                                             = true;
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+
+    measuring = false;
+    const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+    const uint64_t blobsSent = emulator.getNumBlobsSent() - blobsSentStart;
+
+    double cpuTime = 0.0;
+    for (std::unique_ptr<Receiver>& receiver : receivers)
+    {
+      cpuTime += getThreadCpuTime(receiver->thread) - receiver->cpuTimeStart;
+    }
+    row.cpuPerCamera = 100.0 * cpuTime / elapsed / cameras;
+
+    uint64_t blobsReceived     = 0u;
+    uint64_t fragmentsReceived = 0u;
+    for (std::unique_ptr<Receiver>& receiver : receivers)
+    {
+      blobsReceived += receiver->numBlobs;
+      fragmentsReceived += receiver->transport->getNumDatagrams();
+    }
+
+    BlobGenerator generator;
+    generator.setResolution(options.width, options.height);
+    std::vector<uint8_t> blob;
+    generator.generate(1u, 0u, blob);
+    const uint64_t fragmentsPerBlob =
+      (blob.size() + UDP_FRAGMENT_PAYLOAD_MAX - 1u) / UDP_FRAGMENT_PAYLOAD_MAX;
+    const uint64_t fragmentsSent = blobsSent * fragmentsPerBlob;
+
+    row.framesPerSecond = static_cast<double>(blobsReceived) / elapsed / cameras;
+    row.frameLoss       = (blobsSent > blobsReceived)
+                            ? 100.0 * static_cast<double>(blobsSent - blobsReceived) / blobsSent
+                            : 0.0;
+    row.fragmentLoss =
+      (fragmentsSent > fragmentsReceived)
+        ? 100.0 * static_cast<double>(fragmentsSent - fragmentsReceived) / fragmentsSent
+        : 0.0;
+  }
+  emulator.stop();
+
+  // an empty datagram lets each blocking receive return
+  stop = true;
+  for (unsigned int camera = 0u; camera < cameras; ++camera)
+  {
+    UdpSocket wakeUp;
+    wakeUp.connect("127.0.0.1", htons(static_cast<uint16_t>(options.port + camera)));
+    wakeUp.send(std::vector<uint8_t>());
+    wakeUp.shutdown();
+  }
+
+  std::vector<uint64_t> latencies;
+  for (std::unique_ptr<Receiver>& receiver : receivers)
+  {
+    receiver->thread.join();
+    receiver->stream->closeUdpConnection();
+    latencies.insert(latencies.end(), receiver->latencies.begin(), receiver->latencies.end());
+  }
+  std::sort(latencies.begin(), latencies.end());
+  row.latencyP50  = getPercentile(latencies, 0.5);
+  row.latencyP99  = getPercentile(latencies, 0.99);
+  row.latencyP999 = getPercentile(latencies, 0.999);
+
+  return started;
+}
+
+void printRows(const Options& options, const std::vector<Row>& rows)
+{
+  if (options.format == "csv")
+  {
+    std::printf("cameras,target_fps,rcvbuf,rcvbuf_granted,link_mbit,fps_per_camera,frame_loss,"
+                "fragment_loss,latency_p50_us,latency_p99_us,latency_p999_us,cpu_per_camera\n");
+    for (const Row& row : rows)
+    {
+      std::printf("%u,%.1f,%d,%d,%.0f,%.2f,%.3f,%.3f,%.0f,%.0f,%.0f,%.2f\n",
+                  row.cameras,
+                  options.framesPerSecond,
+                  row.receiveBufferSize,
+                  row.grantedReceiveBufferSize,
+                  row.linkRate,
+                  row.framesPerSecond,
+                  row.frameLoss,
+                  row.fragmentLoss,
+                  row.latencyP50,
+                  row.latencyP99,
+                  row.latencyP999,
+                  row.cpuPerCamera);
+    }
+    return;
+  }
+
+  std::printf("\n%d x %d, target %.1f frames/s per camera, %.1f s per configuration\n",
+              options.width,
+              options.height,
+              options.framesPerSecond,
+              options.duration);
+  std::printf("%7s %10s %10s %9s %9s %8s %8s %10s %10s %10s %8s\n",
+              "cameras",
+              "rcvbuf kB",
+              "granted kB",
+              "link Mbit",
+              "fps/cam",
+              "loss %",
+              "frag %",
+              "p50 us",
+              "p99 us",
+              "p99.9 us",
+              "cpu/cam %");
+  for (const Row& row : rows)
+  {
+    std::printf("%7u %10d %10d %9.0f %9.2f %8.3f %8.3f %10.0f %10.0f %10.0f %8.2f\n",
+                row.cameras,
+                row.receiveBufferSize / 1024,
+                row.grantedReceiveBufferSize / 1024,
+                row.linkRate,
+                row.framesPerSecond,
+                row.frameLoss,
+                row.fragmentLoss,
+                row.latencyP50,
+                row.latencyP99,
+                row.latencyP999,
+                row.cpuPerCamera);
+  }
+}
+
+template <typename T>
+std::vector<T> parseList(const char* value)
+{
+  std::vector<T> list;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    std::stringstream itemStream(item);
+    T number;
+    if (itemStream >> number)
+    {
+      list.push_back(number);
+    }
+  }
+  return list;
+}
+
+void printUsage(const char* name)
+{
+  std::printf(
+    "Usage: %s [options]\n"
+    "  --cameras <list>     numbers of cameras to sweep (default: 1,2,4)\n"
+    "  --rcvbuf <list>      receive buffer sizes in bytes to sweep\n"
+    "                       (default: 131072,524288,4194304)\n"
+    "  --link-rate <list>   UDP link rates in Mbit/s to sweep, 0 = one burst per Blob\n"
+    "                       (default: 0,1000)\n"
+    "  --fps <rate>         frames per second per camera, 0 = unlimited (default: 30)\n"
+    "  --width <pixels>     image width (default: 512)\n"
+    "  --height <pixels>    image height (default: 424)\n"
+    "  --duration <s>       measuring time per configuration (default: 5)\n"
+    "  --warm-up <s>        time before measuring (default: 1)\n"
+    "  --port <port>        port of the first camera (default: 6060)\n"
+    "  --format <format>    table or csv (default: table)\n",
+    name);
+}
+} // namespace
+
+} // namespace visionary
+
+int main(int argc, char* argv[])
+{
+  visionary::Options options;
+  for (int idx = 1; idx + 1 < argc; idx += 2)
+  {
+    const std::string option = argv[idx];
+    const char* value        = argv[idx + 1];
+    if (option == "--cameras")
+    {
+      options.cameras = visionary::parseList<unsigned int>(value);
+    }
+    else if (option == "--rcvbuf")
+    {
+      options.receiveBufferSizes = visionary::parseList<int>(value);
+    }
+    else if (option == "--link-rate")
+    {
+      options.linkRates = visionary::parseList<double>(value);
+    }
+    else if (option == "--fps")
+    {
+      options.framesPerSecond = std::atof(value);
+    }
+    else if (option == "--width")
+    {
+      options.width = std::atoi(value);
+    }
+    else if (option == "--height")
+    {
+      options.height = std::atoi(value);
+    }
+    else if (option == "--duration")
+    {
+      options.duration = std::atof(value);
+    }
+    else if (option == "--warm-up")
+    {
+      options.warmUp = std::atof(value);
+    }
+    else if (option == "--port")
+    {
+      options.port = static_cast<uint16_t>(std::atoi(value));
+    }
+    else if (option == "--format")
+    {
+      options.format = value;
+    }
+    else
+    {
+      visionary::printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if ((argc % 2) == 0)
+  {
+    visionary::printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<visionary::Row> rows;
+  for (unsigned int cameras : options.cameras)
+  {
+    for (int receiveBufferSize : options.receiveBufferSizes)
+    {
+      for (double linkRate : options.linkRates)
+      {
+        visionary::Row row;
+        if (!visionary::runConfiguration(options, cameras, receiveBufferSize, linkRate, row))
+        {
+          return EXIT_FAILURE;
+        }
+        rows.push_back(row);
+      }
+    }
+  }
+  visionary::printRows(options, rows);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "VisionaryData.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace visionary {
+
+/// Synthesizes Blobs as a safeVisionary device streams them, to feed SafeVisionaryDataStream
+/// without hardware.
+///
+/// Each Blob carries the XML metadata and all data segments the device can send: depth map
+/// (uint16 distance, uint16 intensity, uint8 state), device status, ROI, local I/Os, field
+/// information, logic signals and IMU, each with a valid CRC32 and length trailer. The depth map
+/// shows a wall in front of the camera and a box moving from left to right with the frame number.
+class BlobGenerator
+{
+public:
+  BlobGenerator();
+
+  /// Sets the image size and derives pinhole intrinsics without distortion from a horizontal
+  /// field of view of 70 degrees (default: 512 x 424).
+  void setResolution(int width, int height);
+
+  /// Sets the image size and all camera parameters announced in the XML metadata.
+  void setCameraParameters(const CameraParameters& params);
+
+  /// \return camera parameters announced in the XML metadata
+  const CameraParameters& getCameraParameters() const;
+
+  /// Sets the distance of the wall in mm (default: 3000)
+  void setWallDistance(double distance);
+
+  /// Generates the Blob of one frame.
+  ///
+  /// \param[in] frameNumber frame number, also used as change counter of the depth map
+  /// \param[in] timestamp timestamp of all data segments in the packed date and time format of
+  ///                      the device, see toDeviceTimestamp
+  /// \param[out] blob complete Blob beginning with the Blob header; its capacity is reused
+  void generate(uint32_t frameNumber, uint64_t timestamp, std::vector<uint8_t>& blob);
+
+  /// \return size of each generated Blob in bytes
+  std::size_t getBlobSize() const;
+
+  /// Packs a time into the timestamp format of the device: local date and time down to
+  /// milliseconds, as decoded by VisionaryData::getTimestampMS. The time zone field is left 0.
+  ///
+  /// \param[in] time time to pack
+  /// \return device timestamp
+  static uint64_t toDeviceTimestamp(std::chrono::system_clock::time_point time);
+
+private:
+  /// Builds the XML metadata and the static maps for the current parameters
+  void update();
+
+  /// Renders the moving box of the given frame into the distance map of the Blob
+  void drawBox(uint32_t frameNumber, uint8_t* distanceMap) const;
+
+  CameraParameters m_cameraParams;
+  double m_wallDistance;
+
+  std::string m_xml;
+
+  /// Change counter of the XML segment, incremented whenever the parameters change
+  uint32_t m_xmlChangeCounter;
+
+  /// Distance of the box and the wall for each pixel in map units
+  std::vector<uint16_t> m_boxDistance;
+  std::vector<uint16_t> m_wallDistanceMap;
+  std::vector<uint16_t> m_intensityMap;
+
+  /// Offsets of the segments relative to BLOB_DATA_SEGMENT_BASE, last entry is the end
+  std::vector<uint32_t> m_segmentOffsets;
+};
+
+} // namespace visionary
@@ -0,0 +1,97 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace visionary {
+
+/// File format of recorded raw Blob logs.
+///
+/// A recording consists of the log file and a side index file (log file name + ".idx"). All values
+/// are stored in little-endian byte order. The log file starts with a BlobLogFileHeader followed
+/// by the records. Each record is a BlobLogRecordHeader followed by the unparsed Blob data, padded
+/// to a multiple of BLOB_LOG_ALIGNMENT bytes. The file may end with zero bytes of a preallocated
+/// extent, a record header without the record magic marks the end of the log.
+///
+/// The index file starts with a BlobLogFileHeader followed by one BlobLogIndexEntry per record,
+/// in recording order.
+
+/// Magic of the log file header
+constexpr char BLOB_LOG_MAGIC[8] = {'S', 'V', 'B', 'L', 'O', 'G', '\0', '\0'};
+
+/// Magic of the index file header
+constexpr char BLOB_LOG_INDEX_MAGIC[8] = {'S', 'V', 'B', 'I', 'D', 'X', '\0', '\0'};
+
+/// Version of the log and index file format
+constexpr uint32_t BLOB_LOG_VERSION = 1u;
+
+/// Magic of each record header
+constexpr uint32_t BLOB_LOG_RECORD_MAGIC = 0x424f4c42u; // "BLOB"
+
+/// Alignment of the records within the log file
+constexpr uint32_t BLOB_LOG_ALIGNMENT = 8u;
+
+/// Header of the log and the index file
+struct BlobLogFileHeader
+{
+  char magic[8];       ///< BLOB_LOG_MAGIC or BLOB_LOG_INDEX_MAGIC
+  uint32_t version;    ///< BLOB_LOG_VERSION
+  uint32_t headerSize; ///< size of this header, the records or index entries follow
+};
+
+/// Header of one recorded Blob
+struct BlobLogRecordHeader
+{
+  uint32_t magic;         ///< BLOB_LOG_RECORD_MAGIC
+  uint32_t length;        ///< length of the Blob data following the header, without padding
+  uint64_t hostTimestamp; ///< host receive time in ns since the epoch
+};
+
+/// Index entry of one recorded Blob
+struct BlobLogIndexEntry
+{
+  uint32_t frameNumber;     ///< frame number (change counter of data segment 1)
+  uint32_t length;          ///< length of the Blob data
+  uint64_t deviceTimestamp; ///< timestamp of data segment 1, 0 if not available
+  uint64_t hostTimestamp;   ///< host receive time in ns since the epoch
+  uint64_t offset;          ///< offset of the record header within the log file
+};
+
+static_assert(sizeof(BlobLogFileHeader) == 16u, "unexpected padding of BlobLogFileHeader");
+static_assert(sizeof(BlobLogRecordHeader) == 16u, "unexpected padding of BlobLogRecordHeader");
+static_assert(sizeof(BlobLogIndexEntry) == 32u, "unexpected padding of BlobLogIndexEntry");
+
+/// Gets frame number and device timestamp of a Blob without parsing it. Both are taken from data
+/// segment 1, like the frame number in SafeVisionaryDataStream::parseBlobData.
+///
+/// \param[in] blob complete Blob data, beginning with the Blob header
+/// \param[in] size size of the Blob data
+/// \param[out] frameNumber change counter of data segment 1, 0 if not available
+/// \param[out] deviceTimestamp timestamp of data segment 1, 0 if not available
+void getBlobFrameInfo(const uint8_t* blob,
+                      std::size_t size,
+                      uint32_t& frameNumber,
+                      uint64_t& deviceTimestamp);
+
+} // namespace visionary
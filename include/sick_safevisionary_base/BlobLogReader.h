@@ -0,0 +1,121 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "BlobLog.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace visionary {
+
+/// Random access to a Blob log written by BlobRecorder.
+///
+/// Log and index file are memory mapped, Blobs are returned as pointers into the mapped log. A
+/// missing or incomplete index (e.g. after a crash of the recording process) is completed by
+/// scanning the log. Frame numbers and timestamps usually increase within a recording and the find
+/// functions do a binary search on the index. A recording spanning a device restart or a wrap of
+/// the frame number is detected when opening the log, the find functions then search linearly.
+///
+/// A Blob can be parsed with SafeVisionaryDataStream::processBlob.
+class BlobLogReader
+{
+public:
+  BlobLogReader();
+  ~BlobLogReader();
+
+  /// Opens a Blob log and its index file (fileName + ".idx"). An open log is closed first.
+  ///
+  /// \param[in] fileName name of the log file
+  /// \retval true the log has been opened
+  /// \retval false the log could not be mapped or is no Blob log
+  bool open(const std::string& fileName);
+
+  /// Closes the log. It is allowed to call close on a reader which is not open.
+  void close();
+
+  /// \return number of Blobs in the log
+  std::size_t getNumBlobs() const;
+
+  /// Gets the index entry of a Blob in native byte order.
+  ///
+  /// \param[in] index position of the Blob in the log, must be less than getNumBlobs()
+  BlobLogIndexEntry getIndexEntry(std::size_t index) const;
+
+  /// Gets a Blob without copying it.
+  ///
+  /// \param[in] index position of the Blob in the log
+  /// \param[out] data pointer to the Blob data, valid until the reader is closed
+  /// \param[out] size size of the Blob data
+  /// \retval true the Blob is available
+  /// \retval false the index is out of range or the record is damaged
+  bool getBlob(std::size_t index, const uint8_t*& data, std::size_t& size) const;
+
+  /// Finds the first Blob with a frame number not less than the given one. If the frame numbers
+  /// of the log do not increase, the Blob with the smallest frame number not less than the given
+  /// one is found, the first one in the log if several Blobs have it.
+  ///
+  /// \param[in] frameNumber frame number to seek to
+  /// \param[out] index position of the Blob in the log
+  /// \retval false all Blobs have a smaller frame number
+  bool findFrame(uint32_t frameNumber, std::size_t& index) const;
+
+  /// Finds the first Blob received at or after the given host time, see findFrame for logs whose
+  /// host timestamps do not increase.
+  ///
+  /// \param[in] hostTimestamp host time in ns since the epoch
+  /// \param[out] index position of the Blob in the log
+  /// \retval false all Blobs have been received earlier
+  bool findHostTimestamp(uint64_t hostTimestamp, std::size_t& index) const;
+
+  /// Finds the first Blob with a device timestamp not less than the given one, see findFrame for
+  /// logs whose device timestamps do not increase.
+  ///
+  /// \param[in] deviceTimestamp device timestamp to seek to
+  /// \param[out] index position of the Blob in the log
+  /// \retval false all Blobs have a smaller device timestamp
+  bool findDeviceTimestamp(uint64_t deviceTimestamp, std::size_t& index) const;
+
+private:
+  /// Scans the log for records behind the given offset and appends them to m_rebuiltIndex
+  void scanLog(uint64_t offset);
+
+  MappedFile m_logFile;
+  MappedFile m_indexFile;
+
+  /// Index entries in little-endian byte order, pointing into the mapped index or m_rebuiltIndex
+  const BlobLogIndexEntry* m_index;
+  std::size_t m_numBlobs;
+
+  /// Index completed by scanning the log, only used if the index file is missing or incomplete
+  std::vector<BlobLogIndexEntry> m_rebuiltIndex;
+
+  /// Whether the keys never decrease over the index, so that a binary search finds them
+  bool m_frameNumbersSorted;
+  bool m_hostTimestampsSorted;
+  bool m_deviceTimestampsSorted;
+};
+
+} // namespace visionary
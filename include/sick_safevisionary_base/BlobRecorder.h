@@ -0,0 +1,152 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "BlobLog.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace visionary {
+
+/// Records raw, unparsed Blobs into a log file with a side index, see BlobLog.h for the format.
+///
+/// record() only copies the Blob into a lock-free single producer / single consumer ring buffer. A
+/// dedicated writer thread appends the records to the log file, extracts frame number and device
+/// timestamp for the index and grows the file in preallocated extents. In case the ring buffer is
+/// full the Blob is dropped instead of blocking the caller, see getNumDropped().
+///
+/// record() must be called from one thread at a time, e.g. by the receive thread of a
+/// SafeVisionaryDataStream (see SafeVisionaryDataStream::setRecorder).
+class BlobRecorder
+{
+public:
+  BlobRecorder();
+  ~BlobRecorder();
+
+  /// Sets the size of the ring buffer between record() and the writer thread, applied on the next
+  /// open(). It should hold the Blobs of at least a few hundred milliseconds.
+  ///
+  /// \param[in] numBytes size in bytes, at least twice the largest Blob record (default: 64 MiB)
+  void setRingBufferSize(std::size_t numBytes);
+
+  /// Sets the size of the extents by which the log file is preallocated.
+  ///
+  /// \param[in] numBytes size in bytes, 0 disables preallocation (default: 64 MiB)
+  void setChunkSize(uint64_t numBytes);
+
+  /// Lets record() wait for space in the ring buffer instead of dropping the Blob. Only meant for
+  /// offline conversions, a receiving thread must not block (default: false). record() stops
+  /// waiting and drops the Blob when the log is closed.
+  void setBlockWhenFull(bool blockWhenFull);
+
+  /// Sets the source of the host timestamps, e.g. the capture time when converting a packet
+  /// capture. The clock is called by record() and has to return ns since the epoch.
+  ///
+  /// \param[in] clock timestamp source, an empty function selects the system clock (default)
+  void setClock(std::function<uint64_t()> clock);
+
+  /// Creates the log file and its index file (fileName + ".idx") and starts the writer thread.
+  /// An open recording is closed first.
+  ///
+  /// \param[in] fileName name of the log file
+  /// \retval true the files have been created
+  /// \retval false the files could not be created
+  bool open(const std::string& fileName);
+
+  /// Writes the remaining records, truncates the log file to its used size and closes the files.
+  /// It is allowed to call close on a recorder which is not open. It must not be called while
+  /// another thread is in record().
+  void close();
+
+  /// \return true if a recording is open
+  bool isOpen() const;
+
+  /// Queues a Blob for recording, stamped with the current host time.
+  ///
+  /// \param[in] data complete Blob data, beginning with the Blob header
+  /// \param[in] size size of the Blob data
+  /// \retval true the Blob has been queued
+  /// \retval false no recording is open or the ring buffer is full (see setBlockWhenFull)
+  bool record(const uint8_t* data, std::size_t size);
+
+  /// \return number of Blobs which have been queued
+  uint64_t getNumRecorded() const;
+
+  /// \return number of Blobs which have been dropped because the ring buffer was full
+  uint64_t getNumDropped() const;
+
+  /// \return number of bytes written to the log file
+  uint64_t getNumBytesWritten() const;
+
+private:
+  /// Main loop of the writer thread
+  void writerLoop();
+
+  /// Writes all records which are currently in the ring buffer.
+  ///
+  /// \return false in case writing to the files failed
+  bool writePending();
+
+  /// Makes sure that the preallocated extent of the log file covers the given size
+  void reserveFileSize(uint64_t size);
+
+  std::size_t m_ringBufferSize;
+  uint64_t m_chunkSize;
+  bool m_blockWhenFull;
+  std::function<uint64_t()> m_clock;
+
+  /// Ring buffer of records, each consisting of a BlobLogRecordHeader and the padded Blob data
+  std::vector<uint8_t> m_ringBuffer;
+
+  /// Write and read position of the ring buffer, counted in bytes since open()
+  std::atomic<uint64_t> m_head;
+  std::atomic<uint64_t> m_tail;
+
+  std::FILE* m_logFile;
+  std::FILE* m_indexFile;
+
+  /// Used size and preallocated size of the log file
+  uint64_t m_fileSize;
+  uint64_t m_allocatedSize;
+
+  std::vector<BlobLogIndexEntry> m_indexEntries;
+
+  std::thread m_writerThread;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  std::atomic<bool> m_running;
+
+  std::atomic<uint64_t> m_numRecorded;
+  std::atomic<uint64_t> m_numDropped;
+  std::atomic<uint64_t> m_numBytesWritten;
+};
+
+} // namespace visionary
@@ -0,0 +1,166 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "BlobLogReader.h"
+#include "ITransport.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace visionary {
+
+/// Transport which replays a recorded Blob log like a sensor would stream it, to drive
+/// SafeVisionaryDataStream without hardware (see SafeVisionaryDataStream::openUdpConnection and
+/// SafeVisionaryDataStream::openTcpConnection).
+///
+/// In UDP mode each recv call returns one datagram consisting of UdpDataHeader, payload and CRC32C.
+/// Fragments can be dropped or swapped with their successor at random to test the reassembly. In
+/// TCP mode the Blob header and the rest of the Blob are returned in separate packets, as the
+/// device sends them.
+///
+/// Blobs are paced by their recorded host receive timestamps, scaled by the replay speed. When the
+/// end of the log is reached, recv returns 0 (connection closed) unless looping is enabled.
+class BlobReplayTransport : public ITransport
+{
+public:
+  enum class Mode
+  {
+    UDP_FRAGMENTS,
+    TCP_STREAM
+  };
+
+  /// \param[in] reader open Blob log
+  /// \param[in] mode protocol to emulate
+  BlobReplayTransport(std::shared_ptr<BlobLogReader> reader, Mode mode);
+  ~BlobReplayTransport();
+
+  /// Sets the replay speed relative to the recording.
+  ///
+  /// \param[in] speed 1 for the original timing, 2 for twice as fast, ..., 0 for as fast as
+  ///                  possible (default: 1)
+  void setSpeed(double speed);
+
+  /// Restarts at the first Blob when the end of the log has been reached (default: false)
+  void setLoop(bool loop);
+
+  /// Continues the replay with the given Blob, e.g. one found by BlobLogReader::findFrame.
+  void seek(std::size_t index);
+
+  /// Sets the probability with which a UDP fragment is dropped (default: 0)
+  void setFragmentDropProbability(double probability);
+
+  /// Sets the probability with which a UDP fragment is swapped with the next fragment of the same
+  /// Blob (default: 0)
+  void setFragmentReorderProbability(double probability);
+
+  /// Sets the seed of the random numbers used for the fault injection
+  void setRandomSeed(uint32_t seed);
+
+  /// \return number of Blobs which have been replayed completely
+  uint64_t getNumBlobsSent() const;
+
+  /// \return number of UDP fragments which have been dropped
+  uint64_t getNumFragmentsDropped() const;
+
+  /// \return number of UDP fragments which have been swapped with their successor
+  uint64_t getNumFragmentsReordered() const;
+
+  /// Data sent to the replayed device is ignored.
+  int send(const std::vector<std::uint8_t>& buffer) override;
+
+  /// Returns the next UDP datagram or the next TCP packet, waiting until it is due.
+  int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override;
+
+  /// Reads exactly nBytesToReceive bytes of the TCP byte stream.
+  int read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive) override;
+
+  /// Ends the replay, a recv waiting for the next Blob returns immediately.
+  int shutdown() override;
+
+private:
+  /// Part of the current Blob which is returned by one recv call
+  struct Packet
+  {
+    uint32_t offset;         ///< offset within the Blob
+    uint32_t length;         ///< number of Blob bytes
+    uint16_t fragmentNumber; ///< UDP fragment number
+    bool isLastFragment;     ///< UDP flag for the last fragment
+  };
+
+  /// Loads the next Blob of the log and waits until it is due.
+  ///
+  /// \return false at the end of the log or after shutdown
+  bool nextBlob();
+
+  /// Splits the current Blob into packets and applies the fault injection
+  void buildPackets();
+
+  /// Writes the current packet into the buffer
+  ///
+  /// \return number of bytes written
+  int writePacket(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive);
+
+  /// \return random number in [0, 1)
+  double nextRandom();
+
+  std::shared_ptr<BlobLogReader> m_reader;
+  Mode m_mode;
+
+  double m_speed;
+  bool m_loop;
+  double m_dropProbability;
+  double m_reorderProbability;
+  uint32_t m_randomState;
+
+  /// Index of the next Blob to load
+  std::size_t m_nextBlob;
+
+  /// Current Blob and its packets
+  const uint8_t* m_blobData;
+  std::size_t m_blobSize;
+  uint64_t m_blobTimestamp;
+  uint16_t m_blobNumber;
+  std::vector<Packet> m_packets;
+  std::size_t m_nextPacket;
+
+  /// Start of the replay and the recorded host time it corresponds to
+  bool m_timingValid;
+  std::chrono::steady_clock::time_point m_replayStart;
+  uint64_t m_firstTimestamp;
+
+  std::mutex m_mutex;
+  std::condition_variable m_shutdownSignal;
+  bool m_shutdown;
+
+  std::atomic<uint64_t> m_numBlobsSent;
+  std::atomic<uint64_t> m_numFragmentsDropped;
+  std::atomic<uint64_t> m_numFragmentsReordered;
+};
+
+} // namespace visionary
@@ -0,0 +1,145 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SafeVisionaryData.h"
+
+namespace visionary {
+
+/// Detection of the parts of the distance map which changed compared to a reference map.
+///
+/// The map is divided into square tiles. A pixel has changed if it became valid or invalid, or if
+/// its distance differs from the reference by more than its threshold. The threshold of each pixel
+/// is the larger one of a range-dependent model (offset + relative * distance) and a multiple of
+/// the temporal noise learned for that pixel. The noise is learned from the differences between
+/// consecutive frames, not from the deviation from the reference, so a slow drift does not raise
+/// its own threshold and is reported once it has accumulated beyond the threshold.
+///
+/// The reference is either fixed (e.g. the empty scene) or follows the stream: in the latter
+/// case the reference of a tile is updated whenever the tile is reported as changed, so it always
+/// matches the data the consumer processed last.
+class ChangeDetector
+{
+public:
+  enum class Reference
+  {
+    PREVIOUS, ///< compare with the map of the last report of each tile
+    FIXED     ///< compare with the map given to setReference()
+  };
+
+  /// \param[in] tileSize edge length of the tiles in pixels
+  explicit ChangeDetector(int tileSize = 16);
+  ~ChangeDetector();
+
+  /// Sets the range-dependent threshold.
+  /// \param[in] relative threshold relative to the reference distance, default is 0.01
+  /// \param[in] offset constant part of the threshold in [m], default is 0.01
+  void setThreshold(float relative, float offset);
+
+  /// Sets the multiple of the learned per-pixel noise used as threshold, 0 disables the learned
+  /// noise. Default is 4.
+  void setNoiseFactor(float factor);
+
+  /// Sets whether the indices of all changed pixels are collected. Default is false.
+  void setCollectChangedPixels(bool collect);
+
+  /// Uses a fixed reference map from now on, e.g. a map of the empty scene. If its size does not
+  /// match the next frame, the frame replaces it like after reset().
+  void setReference(const std::vector<uint16_t>& distanceMap);
+
+  /// Compares with the map of the last report of each tile from now on. This is the default.
+  void usePreviousFrameAsReference();
+
+  /// Forgets the reference and the learned noise, the next frame marks all tiles as changed.
+  void reset();
+
+  /// Compares the distance map with the reference. All tiles are changed on the first frame and
+  /// whenever the size of the map changes.
+  ///
+  /// \param[in] distanceMap distance map with width x height pixels in row-major order
+  /// \param[in] width width of the distance map
+  /// \param[in] height height of the distance map
+  /// \return number of changed tiles
+  std::size_t detect(const std::vector<uint16_t>& distanceMap, int width, int height);
+
+  /// Convenience overload for the distance map of a frame
+  std::size_t detect(const SafeVisionaryData& data);
+
+  /// Recalculates the points of the changed tiles of the last detect() in an organized point
+  /// cloud of the frame. The whole point cloud is calculated if its size does not match.
+  void updatePointCloud(SafeVisionaryData& data, std::vector<PointXYZ>& pointCloud) const;
+
+  /// \return bitmap with one bit per tile in row-major order, bit (i % 64) of word i / 64
+  const std::vector<uint64_t>& getDirtyTileBitmap() const;
+
+  /// \return indices (tileY * getTilesX() + tileX) of the changed tiles in ascending order
+  const std::vector<uint32_t>& getDirtyTiles() const;
+
+  /// \return indices of the changed pixels in ascending order, only if collecting is enabled
+  const std::vector<uint32_t>& getChangedPixels() const;
+
+  /// \return true if the given tile has changed
+  bool isTileDirty(int tileX, int tileY) const;
+
+  int getTileSize() const;
+  int getTilesX() const;
+  int getTilesY() const;
+
+private:
+  /// Compares the pixels [colBegin, colEnd) of a row, learns the noise of the unchanged pixels
+  /// and stores the row as previous frame
+  /// \return true if any of the pixels has changed
+  bool compareRow(const uint16_t* map, int row, int colBegin, int colEnd);
+
+  /// Copies a tile of the map into the reference
+  void updateReference(const uint16_t* map, int colBegin, int rowBegin, int colEnd, int rowEnd);
+
+  int m_tileSize;
+  float m_relativeThreshold;
+  float m_offsetThreshold;
+  float m_noiseFactor;
+  bool m_collectChangedPixels;
+  Reference m_referenceMode;
+  bool m_hasReference;
+
+  int m_width;
+  int m_height;
+  int m_tilesX;
+  int m_tilesY;
+
+  std::vector<uint16_t> m_reference;
+  /// Map of the previous frame
+  std::vector<uint16_t> m_previous;
+  /// Mean absolute difference of each pixel between consecutive frames in units of the distance
+  /// map
+  std::vector<float> m_noise;
+
+  std::vector<uint64_t> m_dirtyTileBitmap;
+  std::vector<uint32_t> m_dirtyTiles;
+  std::vector<uint32_t> m_changedPixels;
+};
+
+} // namespace visionary
@@ -0,0 +1,178 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "CoLaCommand.h"
+#include "CoLaError.h"
+#include "IAuthentication.h"
+#include "TcpSocket.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace visionary {
+
+/// Stand-in for the CoLa2 control channel of a safeVisionary device, to measure and
+/// regression-test SafeVisionaryControl without hardware (see SafeVisionaryControl::open with a
+/// port).
+///
+/// The emulator listens on a TCP port and serves one client at a time; further clients are
+/// accepted after the current one disconnected. Concurrent clients need one emulator per port. It
+/// supports opening and closing sessions, reading and writing variables, method invocations with
+/// registered handlers and the GetChallenge / SetUserLevel handshake of AuthenticationSecure,
+/// including Run as logout. Each response can be delayed to emulate the processing time of the
+/// device.
+///
+/// Variable values and method parameters are the serialized CoLa parameters, e.g. as written by
+/// CoLaParameterWriter after the command name.
+class CoLa2Emulator
+{
+public:
+  /// Handler of a method invocation.
+  ///
+  /// \param[in] parameters serialized parameters of the invocation
+  /// \param[out] returnValues serialized return values
+  /// \return CoLaError::OK or the error which is sent instead of the return values
+  typedef std::function<CoLaError::Enum(const std::vector<uint8_t>& parameters,
+                                        std::vector<uint8_t>& returnValues)>
+    MethodHandler;
+
+  CoLa2Emulator();
+  ~CoLa2Emulator();
+
+  /// Sets the TCP port in host byte order (default: 2122)
+  void setPort(uint16_t port);
+
+  /// Sets the delay before each response (default: 0)
+  void setResponseDelay(std::chrono::microseconds delay);
+
+  /// Sets the delay before the responses to the variable or method with the given name, overriding
+  /// the default delay.
+  void setResponseDelay(const std::string& name, std::chrono::microseconds delay);
+
+  /// Adds or replaces a variable. The variable DeviceIdent is predefined.
+  ///
+  /// \param[in] name variable name
+  /// \param[in] value serialized value
+  /// \param[in] writable false to answer write requests with VARIABLE_WRITE_ACCESS_DENIED
+  void setVariable(const std::string& name,
+                   const std::vector<uint8_t>& value,
+                   bool writable = true);
+
+  /// Gets the current value of a variable, e.g. after a client has written it.
+  ///
+  /// \return false if the variable does not exist
+  bool getVariable(const std::string& name, std::vector<uint8_t>& value) const;
+
+  /// Adds or replaces the handler of a method. GetChallenge, SetUserLevel and Run are built in.
+  void setMethod(const std::string& name, MethodHandler handler);
+
+  /// Sets the password of a user level. Login to a user level without password is not accepted.
+  void setPassword(IAuthentication::UserLevel userLevel, const std::string& password);
+
+  /// Opens the server socket and starts serving clients.
+  ///
+  /// \retval true the emulator is listening
+  /// \retval false the server socket could not be opened, e.g. because the port is in use
+  bool start();
+
+  /// Disconnects the current client and stops the emulator. It is allowed to call stop when the
+  /// emulator is not running.
+  void stop();
+
+  /// \return number of requests which have been answered
+  uint64_t getNumRequests() const;
+
+  /// \return number of sessions which have been opened
+  uint64_t getNumSessions() const;
+
+  /// \return user level of the current client after SetUserLevel or Run
+  IAuthentication::UserLevel getUserLevel() const;
+
+private:
+  struct Variable
+  {
+    std::vector<uint8_t> value;
+    bool writable;
+  };
+
+  /// Accepts clients and answers their requests until stop is called
+  void runServer();
+
+  /// Answers the requests of the connected client until it disconnects
+  void serveClient();
+
+  /// Creates the response to one request
+  ///
+  /// \param[in] request request without magic bytes and length
+  /// \param[out] response response without magic bytes and length
+  /// \return name of the addressed variable or method, used to select the delay
+  std::string handleRequest(const std::vector<uint8_t>& request, std::vector<uint8_t>& response);
+
+  /// Creates the response to a variable access or method invocation
+  void handleCommand(CoLaCommand& command, std::vector<uint8_t>& response);
+
+  /// Built-in methods of the authentication
+  CoLaError::Enum methodGetChallenge(const std::vector<uint8_t>& parameters,
+                                     std::vector<uint8_t>& returnValues);
+  CoLaError::Enum methodSetUserLevel(const std::vector<uint8_t>& parameters,
+                                     std::vector<uint8_t>& returnValues);
+  CoLaError::Enum methodRun(const std::vector<uint8_t>& parameters,
+                            std::vector<uint8_t>& returnValues);
+
+  uint16_t m_port;
+  TcpSocket m_socket;
+  std::thread m_thread;
+
+  /// Protects the configuration, the variables and the connection state
+  mutable std::mutex m_mutex;
+  bool m_running;
+  bool m_clientConnected;
+
+  std::chrono::microseconds m_responseDelay;
+  std::map<std::string, std::chrono::microseconds> m_responseDelays;
+  std::map<std::string, Variable> m_variables;
+  std::map<std::string, MethodHandler> m_methods;
+  std::map<IAuthentication::UserLevel, std::string> m_passwords;
+
+  /// Session and authentication state of the current client
+  uint32_t m_sessionId;
+  IAuthentication::UserLevel m_userLevel;
+  bool m_challengeValid;
+  IAuthentication::UserLevel m_challengeUserLevel;
+  std::array<uint8_t, 16> m_challenge;
+  std::array<uint8_t, 16> m_salt;
+  uint32_t m_randomState;
+
+  std::atomic<uint64_t> m_numRequests;
+  std::atomic<uint64_t> m_numSessions;
+};
+
+} // namespace visionary
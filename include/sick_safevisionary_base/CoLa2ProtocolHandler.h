@@ -45,6 +45,11 @@ private:
   uint8_t calculateChecksum(const std::vector<uint8_t>& buffer);
   uint16_t getReqId();
   std::vector<std::uint8_t> createCoLa2Header();
+
+  /// Receives one response and removes magic bytes and length
+  ///
+  /// \return false if the connection has been closed or the response is invalid
+  bool receiveResponse(std::vector<std::uint8_t>& buffer);
 };
 
 } // namespace visionary
@@ -0,0 +1,126 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "SafeVisionaryData.h"
+
+namespace visionary {
+
+/// Remapping of the distance, intensity and pixel state maps onto an ideal pinhole camera with
+/// the focal lengths and the principal point of the sensor, i.e. without lens distortion.
+///
+/// The distortion model is the one of the point cloud calculation, extended by the tangential
+/// coefficients p1, p2 and the radial coefficient k3: the undistorted position of a pixel is
+/// xu = xd * (1 + k1 * r^2 + k2 * r^4 + k3 * r^6) + 2 * p1 * xd * yd + p2 * (r^2 + 2 * xd^2) and
+/// yu accordingly. The remap tables invert this once per change of the camera parameters and
+/// store the source pixel of each rectified pixel in fixed point, so the warp of a frame only
+/// consists of table look-ups and integer arithmetic.
+class DepthRectifier
+{
+public:
+  enum class Interpolation
+  {
+    NEAREST, ///< value of the nearest source pixel
+    BILINEAR ///< bilinear interpolation, invalid source pixels are left out
+  };
+
+  enum class DepthType
+  {
+    RADIAL, ///< keep the radial distance of the distance map
+    PLANAR  ///< convert into the z coordinate of the point cloud, as usual for pinhole images
+  };
+
+  DepthRectifier();
+  ~DepthRectifier();
+
+  /// Sets the interpolation of the distance and intensity map. The pixel state map always uses
+  /// the nearest pixel. Default is NEAREST.
+  void setInterpolation(Interpolation interpolation);
+
+  /// Sets the depth written to the rectified distance map. Default is RADIAL.
+  void setDepthType(DepthType depthType);
+
+  /// Sets the number of threads splitting the rows of the maps, 0 for one per hardware thread.
+  /// Default is 1.
+  void setNumThreads(unsigned numThreads);
+
+  /// Recalculates the remap tables in case the camera parameters have changed.
+  /// \return true if the tables are valid for the given parameters
+  bool update(const CameraParameters& cameraParams);
+
+  /// Rectifies the maps of a frame. The remap tables are updated automatically.
+  /// \param[in] data frame to rectify
+  /// \param[out] distanceMap rectified distance map, invalid pixels are 0
+  /// \param[out] intensityMap rectified intensity map
+  /// \param[out] stateMap rectified pixel state map
+  /// \return false if the frame does not contain valid maps
+  bool rectify(const SafeVisionaryData& data,
+               std::vector<uint16_t>& distanceMap,
+               std::vector<uint16_t>& intensityMap,
+               std::vector<uint8_t>& stateMap);
+
+  /// Rectifies a distance map of the size of the camera parameters given to update().
+  bool rectifyDistanceMap(const std::vector<uint16_t>& input, std::vector<uint16_t>& output);
+
+  /// Rectifies an intensity map of the size of the camera parameters given to update().
+  bool rectifyIntensityMap(const std::vector<uint16_t>& input, std::vector<uint16_t>& output);
+
+  /// Rectifies a pixel state map of the size of the camera parameters given to update().
+  bool rectifyStateMap(const std::vector<uint8_t>& input, std::vector<uint8_t>& output);
+
+private:
+  /// Source of one rectified pixel
+  struct RemapEntry
+  {
+    int32_t index;   ///< index of the nearest source pixel, -1 outside of the image
+    int32_t index00; ///< index of the upper left source pixel for the bilinear interpolation
+    uint8_t weightX; ///< horizontal weight of the right pixels in 1/256
+    uint8_t weightY; ///< vertical weight of the lower pixels in 1/256
+    uint8_t stepX;   ///< 1 if the right pixels exist
+    uint8_t stepY;   ///< 1 if the lower pixels exist
+  };
+
+  void remapRows(const uint16_t* input,
+                 uint16_t* output,
+                 bool isDistance,
+                 int rowBegin,
+                 int rowEnd) const;
+
+  Interpolation m_interpolation;
+  DepthType m_depthType;
+  unsigned m_numThreads;
+
+  /// Camera parameters the tables have been calculated for
+  CameraParameters m_cameraParams;
+  bool m_tablesValid;
+
+  std::vector<RemapEntry> m_remapTable;
+  /// Factor from radial to planar distance of each rectified pixel in 1/65536
+  std::vector<uint32_t> m_planarFactor;
+  /// FocalToRayCross in units of the distance map
+  uint32_t m_f2rc;
+};
+
+} // namespace visionary
@@ -0,0 +1,154 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "BlobGenerator.h"
+#include "TcpSocket.h"
+#include "UdpSocket.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace visionary {
+
+/// Emulates one or more safeVisionary devices streaming synthetic Blobs (see BlobGenerator), as a
+/// reproducible load source for SafeVisionaryDataStream without hardware.
+///
+/// Each camera runs in its own thread and uses its own port: camera i sends to port + i. In UDP
+/// mode the Blobs are split into fragments with UdpDataHeader and CRC32C and sent to the
+/// destination address. In TCP mode each camera listens on its port and streams to the first client
+/// which connects, sending the Blob header and the rest of the Blob separately like the device. The
+/// camera stops when the client disconnects.
+///
+/// Each Blob carries the local time at which it is due as device timestamp. The UDP header
+/// carries the lower 32 bits of the std::chrono::steady_clock time in us at which the Blob is due,
+/// so a receiver on the same host can measure the latency from it.
+class DeviceEmulator
+{
+public:
+  enum class Protocol
+  {
+    UDP,
+    TCP
+  };
+
+  DeviceEmulator();
+  ~DeviceEmulator();
+
+  /// Sets the protocol (default: UDP)
+  void setProtocol(Protocol protocol);
+
+  /// Sets the IP address the UDP fragments are sent to (default: 127.0.0.1)
+  void setDestination(const std::string& ipAddress);
+
+  /// Sets the port of the first camera in host byte order (default: 6060)
+  void setPort(uint16_t port);
+
+  /// Sets the image size of all cameras (default: 512 x 424)
+  void setResolution(int width, int height);
+
+  /// Sets the frame rate of each camera, 0 sends as fast as possible (default: 30)
+  void setFrameRate(double framesPerSecond);
+
+  /// Sets the number of emulated cameras (default: 1)
+  void setNumCameras(unsigned int numCameras);
+
+  /// Sets the link rate each camera spreads its UDP fragments to, like the Ethernet link of the
+  /// device. 0 sends the fragments of a Blob in one burst (default: 1 Gbit/s).
+  ///
+  /// \param[in] bitsPerSecond link rate in bit/s
+  void setLinkRate(double bitsPerSecond);
+
+  /// Opens the sockets of all cameras and starts streaming.
+  ///
+  /// \retval true all cameras have been started
+  /// \retval false a socket could not be opened, e.g. because the port is in use
+  bool start();
+
+  /// Stops all cameras and closes their sockets. It is allowed to call stop when the emulator is
+  /// not running.
+  void stop();
+
+  /// \return true between start and stop
+  bool isRunning() const;
+
+  /// \return number of Blobs sent by all cameras
+  uint64_t getNumBlobsSent() const;
+
+  /// \return number of Blob bytes sent by all cameras, without UDP headers and checksums
+  uint64_t getNumBytesSent() const;
+
+private:
+  /// Streams Blobs of one camera until stop is called
+  void runCamera(unsigned int index);
+
+  /// Sends one Blob as UDP fragments
+  ///
+  /// \return false if sending failed
+  bool sendUdp(ITransport& transport,
+               const std::vector<uint8_t>& blob,
+               uint16_t blobNumber,
+               uint32_t timestamp,
+               std::vector<uint8_t>& datagram);
+
+  /// Sends one Blob over a TCP connection
+  ///
+  /// \return false if sending failed
+  bool sendTcp(ITransport& transport,
+               const std::vector<uint8_t>& blob,
+               std::vector<uint8_t>& packet);
+
+  /// Waits until the given time or until stop is called
+  ///
+  /// \return false if the emulator has been stopped
+  bool waitUntil(std::chrono::steady_clock::time_point time);
+
+  Protocol m_protocol;
+  std::string m_ipAddress;
+  uint16_t m_port;
+  int m_width;
+  int m_height;
+  double m_framesPerSecond;
+  unsigned int m_numCameras;
+  double m_linkRate;
+
+  /// Socket of each camera, depending on the protocol
+  std::vector<std::unique_ptr<UdpSocket>> m_udpSockets;
+  std::vector<std::unique_ptr<TcpSocket>> m_tcpSockets;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_stopSignal;
+  std::atomic<bool> m_running;
+
+  std::atomic<uint64_t> m_numBlobsSent;
+  std::atomic<uint64_t> m_numBytesSent;
+};
+
+} // namespace visionary
@@ -0,0 +1,116 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace visionary {
+
+/// Spatial filter for the uint16 distance map which removes mixed pixels ("flying pixels") at
+/// depth edges before the point cloud is generated.
+///
+/// A valid pixel is compared with its left, right, upper and lower neighbor. A neighbor is a
+/// discontinuity if their distances differ by more than offset + relative * distance of the pixel.
+/// Pixels with at least the configured number of discontinuities are set to 0 (invalid).
+/// Invalid neighbors are ignored. Optionally, pixels with flagged bits in the pixel state map are
+/// removed as well and not used as neighbors.
+class FlyingPixelFilter
+{
+public:
+  FlyingPixelFilter();
+  ~FlyingPixelFilter();
+
+  /// Sets the discontinuity threshold.
+  /// \param[in] relative threshold relative to the distance of the pixel, default is 0.03
+  /// \param[in] offset constant part of the threshold in [m], default is 0.02
+  void setThreshold(float relative, float offset);
+
+  /// Sets the number of discontinuous neighbors (1 to 4) which remove a pixel. Default is 2, which
+  /// keeps the outermost pixels of objects and removes pixels lying between two surfaces.
+  void setMinDiscontinuities(int count);
+
+  /// Sets the bits of the pixel state map which mark a pixel as unreliable. Only used if a state
+  /// map is passed to apply(). Default is 0, i.e. the state map is not used.
+  void setStateMask(uint8_t mask);
+
+  /// Sets the number of threads splitting the rows of the map, 0 for one per hardware thread.
+  /// Default is 1.
+  void setNumThreads(unsigned numThreads);
+
+  /// Filters the distance map in place.
+  ///
+  /// \param[in,out] distanceMap distance map with width x height pixels in row-major order
+  /// \param[in] width width of the distance map
+  /// \param[in] height height of the distance map
+  /// \param[in] stateMap optional pixel state map with the same layout, may be nullptr
+  /// \return false if the sizes of the maps do not match, the map is not changed then
+  bool apply(std::vector<uint16_t>& distanceMap,
+             int width,
+             int height,
+             const std::vector<uint8_t>* stateMap = nullptr);
+
+  /// Filters the distance map into a buffer of the caller.
+  ///
+  /// \param[in] distanceMap distance map with width x height pixels in row-major order
+  /// \param[in] width width of the distance map
+  /// \param[in] height height of the distance map
+  /// \param[out] filteredMap filtered distance map, resized to the size of the input
+  /// \param[in] stateMap optional pixel state map with the same layout, may be nullptr
+  /// \return false if the sizes of the maps do not match
+  bool apply(const std::vector<uint16_t>& distanceMap,
+             int width,
+             int height,
+             std::vector<uint16_t>& filteredMap,
+             const std::vector<uint8_t>* stateMap = nullptr);
+
+  /// \return number of pixels removed by the last call of apply()
+  std::size_t getNumRejected() const;
+
+private:
+  /// Filters the rows [rowBegin, rowEnd) of input into output
+  /// \return number of removed pixels
+  std::size_t filterRows(const uint16_t* input,
+                         const uint8_t* state,
+                         int width,
+                         int height,
+                         uint16_t* output,
+                         int rowBegin,
+                         int rowEnd) const;
+
+  /// Filters a single pixel, used at the borders of the rows
+  uint16_t filterPixel(
+    const uint16_t* input, const uint8_t* state, int width, int height, int row, int col) const;
+
+  uint16_t m_relativeThreshold; ///< relative threshold as 0.16 fixed point
+  uint16_t m_offsetThreshold;   ///< constant threshold in units of the distance map
+  int m_minDiscontinuities;
+  uint8_t m_stateMask;
+  unsigned m_numThreads;
+  std::size_t m_numRejected;
+
+  /// Buffer for filtering in place
+  std::vector<uint16_t> m_buffer;
+};
+
+} // namespace visionary
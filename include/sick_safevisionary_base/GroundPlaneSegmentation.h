@@ -0,0 +1,131 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PointXYZ.h"
+#include "VisionaryData.h"
+
+namespace visionary {
+
+/// Coefficients of the plane a*x + b*y + c*z + d = 0 with unit normal (a, b, c).
+/// Units are in meters.
+struct PlaneCoefficients
+{
+  float a;
+  float b;
+  float c;
+  float d;
+};
+
+/// Segmentation of the ground plane in organized point clouds as returned by generatePointCloud().
+///
+/// The floor is expected close to a prior plane, usually the plane z = 0 of the world coordinate
+/// system given by the Cam2World matrix. Points on a sampling grid which are close to the prior
+/// are used as candidates of a RANSAC search with a fixed number of iterations; the best
+/// hypothesis is refined by a least squares fit to its inliers before all points of the cloud are
+/// labeled. All buffers are allocated by the setters, so segment() does not allocate memory once
+/// the inlier mask has the size of the point cloud, and its run time is bounded by the number of
+/// samples, the number of iterations and the size of the point cloud.
+class GroundPlaneSegmentation
+{
+public:
+  GroundPlaneSegmentation();
+  ~GroundPlaneSegmentation();
+
+  /// Sets the prior plane from the Cam2World matrix of the device. The floor is assumed to be the
+  /// plane z = floorHeight in world coordinates.
+  /// \param[in] cameraParams camera parameters containing the Cam2World matrix
+  /// \param[in] floorHeight height of the floor in world coordinates in meters
+  void setPrior(const CameraParameters& cameraParams, float floorHeight = 0.f);
+
+  /// Sets the prior plane in the frame of the point cloud.
+  void setPrior(const PlaneCoefficients& prior);
+  const PlaneCoefficients& getPrior() const;
+
+  /// Sets the maximal distance of candidate points to the prior plane and the maximal angle
+  /// between the normals of a plane hypothesis and the prior plane.
+  /// \param[in] distance maximal distance in meters, default is 0.15
+  /// \param[in] angle maximal angle in radians, default is 0.17 (about 10 degrees)
+  void setPriorTolerance(float distance, float angle);
+
+  /// Sets the maximal distance of an inlier to the plane in meters. Default is 0.03.
+  void setDistanceThreshold(float distance);
+  float getDistanceThreshold() const;
+
+  /// Sets the number of RANSAC iterations. Default is 64.
+  void setMaxIterations(int iterations);
+
+  /// Sets the maximal number of candidate points taken from the sampling grid. Default is 2048.
+  void setMaxSamples(int samples);
+
+  /// Sets the minimal fraction of candidate points which have to be inliers of the plane found.
+  /// Default is 0.2.
+  void setMinInlierRatio(float ratio);
+
+  /// Segments the ground plane.
+  ///
+  /// \param[in] pointCloud organized point cloud with width x height points in row-major order
+  /// \param[in] width width of the point cloud
+  /// \param[in] height height of the point cloud
+  /// \param[out] inlierMask 1 for each point on the ground plane, 0 otherwise. Resized to the size
+  ///             of the point cloud.
+  /// \param[out] plane coefficients of the ground plane, the prior if no plane has been found.
+  ///             The normal points to the same side as the normal of the prior.
+  /// \retval true the ground plane has been found
+  /// \retval false not enough points support a plane close to the prior, the mask is cleared
+  bool segment(const std::vector<PointXYZ>& pointCloud,
+               int width,
+               int height,
+               std::vector<uint8_t>& inlierMask,
+               PlaneCoefficients& plane);
+
+  /// \return number of inliers found by the last call of segment()
+  size_t getNumInliers() const;
+
+private:
+  /// Collects the candidate points close to the prior from a sampling grid
+  void sampleCandidates(const std::vector<PointXYZ>& pointCloud, int width, int height);
+
+  /// Searches the plane hypothesis with most candidate inliers.
+  /// \return number of candidate inliers of the best hypothesis
+  size_t findBestPlane(PlaneCoefficients& plane);
+
+  /// Least squares fit to the candidate inliers of the given plane
+  void refinePlane(PlaneCoefficients& plane) const;
+
+  PlaneCoefficients m_prior;
+  float m_priorDistance;
+  float m_minCosAngle;
+  float m_distanceThreshold;
+  int m_maxIterations;
+  float m_minInlierRatio;
+  size_t m_numInliers;
+
+  /// Candidate points, sized to the maximal number of samples
+  std::vector<PointXYZ> m_candidates;
+  size_t m_numCandidates;
+};
+
+} // namespace visionary
@@ -0,0 +1,130 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "SafeVisionaryData.h"
+
+namespace visionary {
+
+/// One cell of the height grid
+struct HeightGridCell
+{
+  float maxHeight;        ///< largest world z coordinate of all hits in [m]
+  uint32_t hitCount;      ///< number of pixels which hit the cell since it has been cleared
+  uint32_t lastSeenFrame; ///< frame number of the last hit
+};
+
+/// 2.5D height map of the x-y plane of the world coordinate system, accumulated from the distance
+/// maps of one or more sensors.
+///
+/// Each valid pixel is projected through the look-up table and the Cam2World matrix of its frame
+/// without creating a point cloud. The projection runs in parallel on bands of image rows, the
+/// grid update is a single pass over the projected pixels afterwards, so the cost of a frame only
+/// depends on the number of pixels. Cells which have not been hit for more than the maximal age
+/// are treated as empty and restart on the next hit; decay() clears them explicitly.
+class HeightGridAccumulator
+{
+public:
+  /// \param[in] originX world x coordinate of the lower border of the grid in [m]
+  /// \param[in] originY world y coordinate of the lower border of the grid in [m]
+  /// \param[in] resolution edge length of a cell in [m]
+  /// \param[in] cellsX number of cells in x direction
+  /// \param[in] cellsY number of cells in y direction
+  HeightGridAccumulator(float originX, float originY, float resolution, int cellsX, int cellsY);
+  ~HeightGridAccumulator();
+
+  /// Sets the band of world z coordinates of the pixels which are accumulated.
+  /// Default is the full range.
+  void setHeightBand(float minHeight, float maxHeight);
+
+  /// Sets the number of frames after which a cell without hits is treated as empty.
+  /// 0 disables the decay, which is the default.
+  void setMaxAge(uint32_t frames);
+
+  /// Sets the number of threads used for the projection, 0 for one per hardware thread.
+  /// Default is 1.
+  void setNumThreads(unsigned numThreads);
+
+  /// Accumulates the distance map of a frame, stamped with its frame number.
+  void integrate(SafeVisionaryData& data);
+
+  /// Accumulates the distance map of a frame, stamped with the given frame number, e.g. a common
+  /// counter in case several sensors with independent frame numbers are integrated.
+  void integrate(SafeVisionaryData& data, uint32_t frameNumber);
+
+  /// Clears all cells which are older than the maximal age relative to the last integrated frame.
+  /// In contrast to integrate(), this visits every cell of the grid.
+  void decay();
+
+  /// Clears all cells.
+  void clear();
+
+  /// Gets a cell of the grid.
+  /// \param[in] x cell index in x direction
+  /// \param[in] y cell index in y direction
+  /// \param[out] cell content of the cell
+  /// \return true if the cell is inside the grid and has been hit within the maximal age
+  bool getCell(int x, int y, HeightGridCell& cell) const;
+
+  /// Gets all cells in row-major order (index y * cellsX + x), including outdated cells.
+  const std::vector<HeightGridCell>& getCells() const;
+
+  int getCellsX() const;
+  int getCellsY() const;
+  float getResolution() const;
+
+private:
+  /// Projects the pixels of the rows [rowBegin, rowEnd) to cell indices and heights
+  void projectRows(const std::vector<uint16_t>& distanceMap,
+                   const std::vector<PointXYZ>& lookUpTable,
+                   const float* cam2world,
+                   float f2rc,
+                   int width,
+                   int rowBegin,
+                   int rowEnd);
+
+  /// \return true if the cell has not been hit for more than the maximal age
+  bool isOutdated(const HeightGridCell& cell, uint32_t frameNumber) const;
+
+  float m_originX;
+  float m_originY;
+  float m_resolution;
+  int m_cellsX;
+  int m_cellsY;
+  float m_minHeight;
+  float m_maxHeight;
+  uint32_t m_maxAge;
+  unsigned m_numThreads;
+  uint32_t m_lastFrameNumber;
+
+  std::vector<HeightGridCell> m_cells;
+
+  /// Cell index of each pixel of the current frame, -1 if the pixel is not accumulated
+  std::vector<int32_t> m_pixelCells;
+  /// Height of each pixel of the current frame
+  std::vector<float> m_pixelHeights;
+};
+
+} // namespace visionary
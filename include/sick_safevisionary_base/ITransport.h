@@ -61,6 +61,11 @@ public:
   ///
   /// \return number of received bytes, negative values are OS error codes.
   virtual int read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive) = 0;
+
+  /// Closes the transport
+  ///
+  /// \return OS error code.
+  virtual int shutdown() = 0;
 };
 
 } // namespace visionary
@@ -0,0 +1,124 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace visionary {
+
+/// False color and tone mapping of the uint16 distance and intensity maps for visualization.
+///
+/// All settings are folded into a look-up table with one RGBA color per possible map value, so
+/// the conversion of a frame is a single table look-up per pixel. The table is only recalculated
+/// when a setting changes; with auto-range, the range is taken from percentiles of a histogram
+/// of each frame and the table is only recalculated when the range moves noticeably.
+class MapColorizer
+{
+public:
+  enum class Colormap
+  {
+    GRAY,  ///< black to white, e.g. for intensity images
+    JET,   ///< blue - cyan - yellow - red
+    TURBO, ///< perceptually smoother variant of JET
+    HOT    ///< black - red - yellow - white
+  };
+
+  MapColorizer();
+  ~MapColorizer();
+
+  /// Sets the colormap. Default is TURBO.
+  void setColormap(Colormap colormap);
+
+  /// Sets the fixed range of map values spread over the colormap, values outside are clamped.
+  /// Disables auto-range. Default is the full range of the map.
+  void setRange(uint16_t minValue, uint16_t maxValue);
+
+  /// Takes the range from each frame: the given percentiles of the valid values are mapped to the
+  /// ends of the colormap.
+  /// \param[in] lowPercentile lower percentile, e.g. 0.02
+  /// \param[in] highPercentile upper percentile, e.g. 0.98
+  void setAutoRange(float lowPercentile, float highPercentile);
+
+  /// Sets the gamma of the mapping. The position t in [0, 1] within the range is raised to the
+  /// power of 1 / gamma before the colormap is applied, so values > 1 brighten dark regions.
+  /// Default is 1.
+  void setGamma(float gamma);
+
+  /// Sets the color of invalid values (0 and 0xFFFF). Default is transparent black.
+  void setInvalidColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+  /// Sets the number of threads splitting the rows of the map, 0 for one per hardware thread.
+  /// Default is 1.
+  void setNumThreads(unsigned numThreads);
+
+  /// Colorizes a map into a buffer of the caller.
+  ///
+  /// \param[in] map map with width x height pixels in row-major order
+  /// \param[in] width width of the map
+  /// \param[in] height height of the map
+  /// \param[out] rgba image with 4 bytes per pixel in the order red, green, blue, alpha
+  /// \param[in] rowStride distance of the image rows in bytes, 0 for width * 4
+  /// \return false if the size of the map does not match
+  bool colorize(const std::vector<uint16_t>& map,
+                int width,
+                int height,
+                uint8_t* rgba,
+                std::size_t rowStride = 0u);
+
+  /// Colorizes a map into a vector, which is resized to width * height * 4 bytes.
+  bool colorize(const std::vector<uint16_t>& map,
+                int width,
+                int height,
+                std::vector<uint8_t>& rgba);
+
+  /// \return current range of the mapping, e.g. as determined by auto-range
+  uint16_t getMinValue() const;
+  uint16_t getMaxValue() const;
+
+private:
+  /// Determines the range from the percentiles of the valid values of the map
+  void updateAutoRange(const std::vector<uint16_t>& map);
+
+  /// Recalculates the look-up table for the current settings
+  void updateLookUpTable();
+
+  Colormap m_colormap;
+  uint16_t m_minValue;
+  uint16_t m_maxValue;
+  bool m_autoRange;
+  float m_lowPercentile;
+  float m_highPercentile;
+  float m_gamma;
+  uint32_t m_invalidColor;
+  unsigned m_numThreads;
+
+  /// RGBA color of each map value, in memory order
+  std::vector<uint32_t> m_lookUpTable;
+  bool m_lookUpTableValid;
+
+  /// Histogram buffer for auto-range
+  std::vector<uint32_t> m_histogram;
+};
+
+} // namespace visionary
@@ -0,0 +1,74 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace visionary {
+
+/// Read-only memory mapping of a complete file
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /// Maps a file, a mapped file is closed first.
+  ///
+  /// \param[in] fileName name of the file
+  /// \retval true the file has been mapped
+  /// \retval false the file could not be opened or mapped
+  bool open(const std::string& fileName);
+
+  /// Unmaps the file. It is allowed to call close on a file which is not open.
+  void close();
+
+  /// \return true if a file is mapped
+  bool isOpen() const;
+
+  /// \return pointer to the begin of the file, nullptr if no file is mapped or the file is empty
+  const uint8_t* data() const;
+
+  /// \return size of the file in bytes
+  std::size_t size() const;
+
+  /// Hints the operating system that the file is read from the beginning to the end
+  void adviseSequential() const;
+
+private:
+  const uint8_t* m_data;
+  std::size_t m_size;
+  bool m_isOpen;
+#ifdef _WIN32
+  void* m_fileHandle;
+  void* m_mappingHandle;
+#else
+  int m_fileDescriptor;
+#endif
+};
+
+} // namespace visionary
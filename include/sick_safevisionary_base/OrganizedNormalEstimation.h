@@ -0,0 +1,90 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+#include "PointXYZ.h"
+
+namespace visionary {
+
+/// Surface normal estimation for organized point clouds as returned by generatePointCloud().
+///
+/// Instead of searching the nearest neighbors in 3D, the normal of each point is the cross
+/// product of the horizontal and vertical tangents given by its neighbors in the image. Neighbors
+/// which are invalid (NaN) or lie behind a depth discontinuity are not used; one-sided
+/// differences are taken if only one neighbor of a direction is usable.
+class OrganizedNormalEstimation
+{
+public:
+  OrganizedNormalEstimation();
+  ~OrganizedNormalEstimation();
+
+  /// Sets the distance in pixels between a point and the neighbors used for its tangents.
+  /// Larger distances smooth the normals of noisy surfaces. Default is 1.
+  void setNeighborDistance(int pixels);
+  int getNeighborDistance() const;
+
+  /// Sets the maximal distance between a point and a neighbor relative to the range of the point
+  /// and the neighbor distance, e.g. 0.05 accepts a neighbor 1 pixel away within 10 cm at 2 m
+  /// range. Neighbors further away are regarded as lying behind a depth discontinuity.
+  void setMaxDepthChangeFactor(float factor);
+  float getMaxDepthChangeFactor() const;
+
+  /// Sets the viewpoint the normals are oriented to, in the frame of the point cloud. Default is
+  /// the origin, i.e. the sensor for point clouds in the camera perspective.
+  void setViewpoint(float x, float y, float z);
+
+  /// Sets the number of threads splitting the rows of the point cloud, 0 for one per hardware
+  /// thread. Default is 1.
+  void setNumThreads(unsigned numThreads);
+
+  /// Computes the normals of all points.
+  ///
+  /// \param[in] pointCloud organized point cloud with width x height points in row-major order
+  /// \param[in] width width of the point cloud
+  /// \param[in] height height of the point cloud
+  /// \param[out] normals unit normal vector of each point, NaN where no normal could be
+  ///             computed. Resized to the size of the point cloud, so no memory is allocated when
+  ///             the same vector is passed for each frame.
+  void compute(const std::vector<PointXYZ>& pointCloud,
+               int width,
+               int height,
+               std::vector<PointXYZ>& normals) const;
+
+  /// Computes the normals of the rows [rowBegin, rowEnd) only, e.g. to distribute the work on
+  /// threads of the caller. The normals vector must already have the size of the point cloud.
+  void computeRows(const std::vector<PointXYZ>& pointCloud,
+                   int width,
+                   int height,
+                   std::vector<PointXYZ>& normals,
+                   int rowBegin,
+                   int rowEnd) const;
+
+private:
+  int m_neighborDistance;
+  float m_maxDepthChangeFactor;
+  PointXYZ m_viewpoint;
+  unsigned m_numThreads;
+};
+
+} // namespace visionary
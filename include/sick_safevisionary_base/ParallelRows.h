@@ -0,0 +1,46 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <functional>
+
+namespace visionary {
+
+/// Splits the rows [0, numRows) into contiguous bands and processes them concurrently.
+///
+/// rowFunction is called once per band with the first and the past-the-end row of the band.
+/// The bands are processed by the calling thread and a pool of worker threads shared by all
+/// calls. The workers are started on first use and kept until the program exits, so a call only
+/// wakes them; still, each call costs a few microseconds of synchronization, which is why the
+/// image processing classes default to a single thread. numThreads = 1 runs everything on the
+/// calling thread without using the pool. numThreads = 0 uses one thread per hardware thread.
+/// While the pool serves one call, a concurrent or nested call processes all rows on its calling
+/// thread. The function returns after all bands have been processed.
+///
+/// \param[in] numRows number of rows to process
+/// \param[in] numThreads number of concurrent bands
+/// \param[in] rowFunction function processing the rows [rowBegin, rowEnd)
+void parallelForRows(int numRows,
+                     unsigned numThreads,
+                     const std::function<void(int rowBegin, int rowEnd)>& rowFunction);
+
+} // namespace visionary
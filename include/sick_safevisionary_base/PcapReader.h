@@ -0,0 +1,139 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace visionary {
+
+/// UDP datagram of a packet capture
+struct PcapUdpDatagram
+{
+  const uint8_t* data;     ///< UDP payload, points into the mapped capture
+  std::size_t size;        ///< size of the UDP payload
+  uint64_t timestamp;      ///< capture time in ns since the epoch
+  uint32_t sourceAddress;  ///< IPv4 source address, host byte order
+  uint32_t destAddress;    ///< IPv4 destination address, host byte order
+  uint16_t sourcePort;     ///< UDP source port, host byte order
+  uint16_t destPort;       ///< UDP destination port, host byte order
+};
+
+/// Reader for the UDP datagrams of pcap and pcapng captures, e.g. written by tcpdump or Wireshark.
+///
+/// The capture is memory mapped and read sequentially, datagrams are returned without copying.
+/// Supported link types are Ethernet (with VLAN tags), raw IP, BSD loopback and Linux cooked
+/// captures (SLL and SLL2). Only complete, unfragmented IPv4 UDP packets are returned, all other
+/// packets are skipped.
+class PcapReader
+{
+public:
+  PcapReader();
+  ~PcapReader();
+
+  /// Opens a capture, an open capture is closed first.
+  ///
+  /// \param[in] fileName name of the pcap or pcapng file
+  /// \retval true the capture has been opened
+  /// \retval false the file could not be mapped or has an unknown format
+  bool open(const std::string& fileName);
+
+  /// Closes the capture. It is allowed to call close on a reader which is not open.
+  void close();
+
+  /// Sets the UDP destination port of the datagrams to return.
+  ///
+  /// \param[in] port port in host byte order, 0 returns the datagrams of all ports (default)
+  void setPortFilter(uint16_t port);
+
+  /// Gets the next UDP datagram of the capture.
+  ///
+  /// \param[out] datagram payload and meta data of the datagram
+  /// \retval true a datagram has been found
+  /// \retval false the end of the capture has been reached
+  bool nextDatagram(PcapUdpDatagram& datagram);
+
+  /// Continues with the first packet of the capture
+  void rewind();
+
+  /// \return number of packets read so far, including skipped ones
+  uint64_t getNumPackets() const;
+
+  /// \return number of packets skipped so far because they are no matching IPv4 UDP datagrams
+  uint64_t getNumSkipped() const;
+
+private:
+  /// Capture interface of a pcapng section, or the single interface of a pcap file
+  struct Interface
+  {
+    uint16_t linkType;
+    uint64_t ticksPerSecond; ///< timestamp resolution
+  };
+
+  /// Gets the next packet from the capture.
+  ///
+  /// \return false at the end of the capture
+  bool nextPacket(const uint8_t*& data, std::size_t& size, uint64_t& timestamp, uint16_t& linkType);
+
+  bool nextPcapPacket(const uint8_t*& data,
+                      std::size_t& size,
+                      uint64_t& timestamp,
+                      uint16_t& linkType);
+  bool nextPcapngPacket(const uint8_t*& data,
+                        std::size_t& size,
+                        uint64_t& timestamp,
+                        uint16_t& linkType);
+
+  /// Parses the options of an interface description block for the timestamp resolution
+  uint64_t parseTimestampResolution(const uint8_t* options, std::size_t size) const;
+
+  /// Extracts the UDP datagram of a packet
+  ///
+  /// \return false if the packet is no complete IPv4 UDP datagram
+  bool decodePacket(const uint8_t* data,
+                    std::size_t size,
+                    uint16_t linkType,
+                    PcapUdpDatagram& datagram) const;
+
+  uint16_t read16(const uint8_t* ptr) const;
+  uint32_t read32(const uint8_t* ptr) const;
+
+  MappedFile m_file;
+  bool m_isPcapng;
+
+  /// true if the byte order of the capture differs from the host byte order
+  bool m_swapped;
+
+  /// Position of the next packet or block
+  std::size_t m_position;
+
+  std::vector<Interface> m_interfaces;
+  uint16_t m_portFilter;
+  uint64_t m_numPackets;
+  uint64_t m_numSkipped;
+};
+
+} // namespace visionary
@@ -0,0 +1,81 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include "ITransport.h"
+#include "PcapReader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace visionary {
+
+/// UDP transport which delivers the datagrams of a packet capture, so that a capture runs through
+/// the UDP header check and Blob reassembly of SafeVisionaryDataStream (see
+/// SafeVisionaryDataStream::openUdpConnection). The datagrams are delivered as fast as they are
+/// read, recv returns 0 (connection closed) at the end of the capture. Datagrams too short for
+/// the UDP header of the data stream are skipped.
+class PcapTransport : public ITransport
+{
+public:
+  /// \param[in] reader open capture, usually with the port filter set to the data stream port
+  explicit PcapTransport(std::shared_ptr<PcapReader> reader);
+  ~PcapTransport();
+
+  /// \return capture time of the last delivered datagram in ns since the epoch
+  uint64_t getTimestamp() const;
+
+  /// Data sent to the captured device is ignored.
+  int send(const std::vector<std::uint8_t>& buffer) override;
+
+  /// Returns the payload of the next UDP datagram of the capture.
+  int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override;
+
+  /// Same as recv, datagrams can not be read partially.
+  int read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive) override;
+
+  /// Ends the delivery of datagrams.
+  int shutdown() override;
+
+private:
+  std::shared_ptr<PcapReader> m_reader;
+  uint64_t m_timestamp;
+  bool m_shutdown;
+};
+
+/// Converts the safeVisionary data stream of a packet capture into a Blob log (see BlobRecorder).
+/// The UDP fragments are reassembled to Blobs like received ones, the capture time of the last
+/// fragment of a Blob is used as its host timestamp.
+///
+/// \param[in] captureFile name of the pcap or pcapng file
+/// \param[in] port UDP destination port of the data stream in host byte order
+/// \param[in] logFile name of the Blob log to write
+/// \retval true the capture has been converted
+/// \retval false the capture could not be read or the log could not be created
+bool convertPcapToBlobLog(const std::string& captureFile,
+                          uint16_t port,
+                          const std::string& logFile);
+
+} // namespace visionary
@@ -0,0 +1,115 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace visionary {
+
+/// Run of consecutive set pixels within one row of a PixelMask
+struct PixelRun
+{
+  int begin;  ///< column of the first pixel of the run
+  int length; ///< number of pixels of the run
+};
+
+/// Image with one bit per pixel, e.g. one flag of the pixel state map.
+///
+/// Each row starts at a 64 bit word, bit (col % 64) of word (col / 64) belongs to column col. Bits
+/// behind the last column of a row are always 0, so masks of the same size can be combined word
+/// by word with the usual bit operations.
+class PixelMask
+{
+public:
+  PixelMask();
+  ~PixelMask();
+
+  /// Sets the size and clears all pixels. No memory is allocated if the size does not grow.
+  void resize(int width, int height);
+
+  int getWidth() const;
+  int getHeight() const;
+
+  /// \return number of 64 bit words per row
+  int getWordsPerRow() const;
+
+  /// Gets the words of the mask, row after row.
+  std::vector<uint64_t>& getWords();
+  const std::vector<uint64_t>& getWords() const;
+
+  /// \return true if the pixel is set
+  bool get(int col, int row) const;
+
+  /// Sets or clears a pixel
+  void set(int col, int row, bool value);
+
+  /// \return number of set pixels
+  std::size_t count() const;
+
+  /// \return number of set pixels in a row
+  std::size_t countRow(int row) const;
+
+  /// Gets the runs of set pixels in a row.
+  /// \param[in] row row of the mask
+  /// \param[out] runs runs from left to right, the vector is cleared first
+  void getRuns(int row, std::vector<PixelRun>& runs) const;
+
+  /// Keeps only the pixels which are also set in the other mask of the same size
+  void andWith(const PixelMask& other);
+
+  /// Adds the pixels which are set in the other mask of the same size
+  void orWith(const PixelMask& other);
+
+  /// Removes the pixels which are set in the other mask of the same size
+  void andNotWith(const PixelMask& other);
+
+  /// Sets the pixels of the mask for which any of the given bits of the pixel state is set.
+  ///
+  /// \param[in] stateMap pixel state map with width x height bytes in row-major order
+  /// \param[in] width width of the state map
+  /// \param[in] height height of the state map
+  /// \param[in] flags bits of the pixel state which set a pixel of the mask
+  /// \return false if the size of the state map does not match
+  bool decode(const std::vector<uint8_t>& stateMap, int width, int height, uint8_t flags);
+
+  /// Decodes all 8 bits of the pixel state map at once, masks[i] receives bit i.
+  ///
+  /// \param[in] stateMap pixel state map with width x height bytes in row-major order
+  /// \param[in] width width of the state map
+  /// \param[in] height height of the state map
+  /// \param[out] masks array of 8 masks, resized to the size of the state map
+  /// \return false if the size of the state map does not match
+  static bool decodeAll(const std::vector<uint8_t>& stateMap,
+                        int width,
+                        int height,
+                        PixelMask masks[8]);
+
+private:
+  int m_width;
+  int m_height;
+  int m_wordsPerRow;
+  std::vector<uint64_t> m_words;
+};
+
+} // namespace visionary
@@ -0,0 +1,113 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PointXYZ.h"
+
+namespace visionary {
+
+/// Point with fixed point coordinates in multiples of the unit of the QuantizedPointCloud
+struct PointXYZ16
+{
+  int16_t x;
+  int16_t y;
+  int16_t z;
+};
+
+#pragma pack(push, 1)
+/// Header of a serialized QuantizedPointCloud.
+/// All values are little-endian, the points follow directly after the header.
+struct QuantizedPointCloudHeader
+{
+  uint32_t magic;     ///< marks the start of a serialized point cloud, set to 'QPC1'
+  uint16_t version;   ///< version of the serialization format
+  uint16_t reserved;  ///< reserved, set to 0
+  uint32_t width;     ///< width of the organized point cloud, number of points if unorganized
+  uint32_t height;    ///< height of the organized point cloud, 1 if unorganized
+  float unit;         ///< size of one quantization step in meters
+  uint32_t numPoints; ///< number of points following the header
+};
+#pragma pack(pop)
+
+/// Point cloud with 16 bit fixed point coordinates for compact transport between processes and
+/// hosts. Each coordinate is stored as multiple of a configurable unit, e.g. 1 mm gives a range of
+/// about +-32 m at 6 bytes per point instead of 12 bytes for a PointXYZ.
+/// Invalid (NaN) coordinates are stored as INVALID_VALUE, coordinates outside of the
+/// representable range are clamped.
+class QuantizedPointCloud
+{
+public:
+  /// Value of an invalid coordinate
+  static const int16_t INVALID_VALUE = -32768;
+
+  /// Magic bytes and version of the serialization format
+  static const uint32_t HEADER_MAGIC   = 0x31435051u; // 'QPC1'
+  static const uint16_t HEADER_VERSION = 1u;
+
+  /// \param[in] unit size of one quantization step in meters
+  explicit QuantizedPointCloud(float unit = 0.001f);
+  ~QuantizedPointCloud();
+
+  /// Sets the size of one quantization step in meters.
+  /// Already stored points are not converted.
+  void setUnit(float unit);
+  float getUnit() const;
+
+  /// Sets the size of the organized point cloud and resizes the point vector accordingly
+  void resize(uint32_t width, uint32_t height);
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+
+  std::vector<PointXYZ16>& getPoints();
+  const std::vector<PointXYZ16>& getPoints() const;
+
+  /// Quantizes a point cloud. The point cloud is regarded as unorganized if width and height do
+  /// not match its size.
+  void fromPointCloud(const std::vector<PointXYZ>& pointCloud,
+                      uint32_t width  = 0u,
+                      uint32_t height = 0u);
+
+  /// Converts back to a floating point cloud in meters. Invalid coordinates become NaN.
+  void toPointCloud(std::vector<PointXYZ>& pointCloud) const;
+
+  /// Serializes header and points into the buffer, which is resized accordingly
+  void serialize(std::vector<uint8_t>& buffer) const;
+
+  /// Restores the point cloud from a serialized buffer
+  /// \return Returns true in case the buffer contains a valid serialized point cloud
+  bool deserialize(const uint8_t* data, std::size_t size);
+
+  /// Quantizes a single coordinate given in meters
+  static int16_t quantize(float value, float invUnit);
+
+private:
+  float m_unit;
+  uint32_t m_width;
+  uint32_t m_height;
+  std::vector<PointXYZ16> m_points;
+};
+
+} // namespace visionary
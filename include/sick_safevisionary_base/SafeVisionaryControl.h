@@ -51,12 +51,15 @@ public:
   ///
   /// \param[in] hostname name or IP address of the Visionary sensor.
   /// \param[in] sessionTimeout_s timeout of session in seconds
+  /// \param[in] port TCP port in host byte order, e.g. of a CoLa2Emulator on localhost
   ///
   /// \retval true The connection to the sensor successfully was established.
   /// \retval false The connection attempt failed; the sensor is either
   ///               - switched off or has a different IP address or name
   ///               - not available using for PCs network settings (different subnet)
-  bool open(const std::string& hostname, uint8_t sessionTimeout_s = kSessionTimeout_s);
+  bool open(const std::string& hostname,
+            uint8_t sessionTimeout_s = kSessionTimeout_s,
+            uint16_t port            = COLA_2);
 
   /// Close a connection
   ///
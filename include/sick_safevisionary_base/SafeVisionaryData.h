@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 
+#include "StageHistograms.h"
 #include "VisionaryData.h"
 
 #define DEPTHMAP_SEGMENT 1
@@ -353,6 +354,26 @@ struct IMU_ELEMENT
 
 #pragma pack(pop)
 
+/// Statistics of a uint16 image of one frame. The values 0 and 0xFFFF are counted as invalid and
+/// excluded from all other figures.
+struct MapStatistics
+{
+  uint16_t minValue;               ///< smallest valid value, 0 if there is no valid value
+  uint16_t maxValue;               ///< largest valid value, 0 if there is no valid value
+  float mean;                      ///< mean of the valid values
+  uint32_t numValid;               ///< number of valid pixels
+  uint32_t numInvalid;             ///< number of invalid pixels
+  int histogramShift;              ///< a value belongs to the bin (value >> histogramShift)
+  std::vector<uint32_t> histogram; ///< number of valid pixels per bin
+};
+
+/// Statistics of the images of one frame, see SafeVisionaryData::setStatisticsEnabled()
+struct FrameStatistics
+{
+  MapStatistics distance;
+  MapStatistics intensity;
+};
+
 class SafeVisionaryData : public VisionaryData
 {
 public:
@@ -418,6 +439,65 @@ public:
   /// \param[out] vector containing the calculated point cloud
   void generatePointCloud(std::vector<PointXYZ>& pointCloud) override;
 
+  /// Calculate and return a decimated point cloud in the camera perspective. Units are in meters.
+  /// Each binSize x binSize pixel block of the distance map is reduced to a single point, the
+  /// result is organized with (getWidth() / binSize) x (getHeight() / binSize) points.
+  /// The look-up table for the decimated point cloud is kept separately, so decimated and full
+  /// resolution point clouds can be generated alternately from the same frame.
+  /// \param[out] pointCloud vector containing the calculated point cloud
+  /// \param[in] binning reduction applied to each pixel block
+  /// \param[in] binSize edge length of the pixel blocks, e.g. 2 or 4
+  void generatePointCloud(std::vector<PointXYZ>& pointCloud, PixelBinning binning, int binSize);
+
+  /// Calculate and return the point cloud in the camera perspective from another distance map
+  /// with the layout of getDistanceMap(), e.g. the output of a TemporalDepthFilter. The look-up
+  /// table of this frame is used. Units are in meters.
+  /// \param[in] distanceMap distance map in the unit DISTANCE_MAP_UNIT
+  /// \param[out] pointCloud vector containing the calculated point cloud, empty in case the size
+  ///             of the distance map does not match
+  void generatePointCloud(const std::vector<uint16_t>& distanceMap,
+                          std::vector<PointXYZ>& pointCloud);
+
+  /// Recalculate the points of a rectangular pixel region of an organized point cloud in the
+  /// camera perspective, keeping all other points. The whole point cloud is calculated in case it
+  /// does not have the size of the distance map, e.g. on the first call. Units are in meters.
+  /// \param[in,out] pointCloud organized point cloud of this frame
+  /// \param[in] colBegin first column of the region
+  /// \param[in] rowBegin first row of the region
+  /// \param[in] colEnd column after the last column of the region
+  /// \param[in] rowEnd row after the last row of the region
+  void generatePointCloudRegion(
+    std::vector<PointXYZ>& pointCloud, int colBegin, int rowBegin, int colEnd, int rowEnd);
+
+  /// Calculate and return the point cloud in the camera perspective as 16 bit fixed point
+  /// coordinates, directly from the distance map. The unit already set in the given point cloud
+  /// is used for the quantization.
+  /// \param[in,out] pointCloud quantized point cloud, resized to the image size
+  void generateQuantizedPointCloud(QuantizedPointCloud& pointCloud);
+
+  /// Calculate and return the point cloud in world coordinates, i.e. already transformed with the
+  /// Cam2World matrix, restricted to a volume of interest. Units are in meters.
+  /// Pixels outside of the range gate are rejected before any floating point computation.
+  /// \param[out] pointCloud vector containing the calculated point cloud
+  /// \param[in] gating range gate and crop box applied during the generation
+  void generateCroppedPointCloud(std::vector<PointXYZ>& pointCloud,
+                                 const PointCloudGating& gating);
+
+  /// Calculate a 2D laser scan in the x-y plane of the world coordinate system directly from the
+  /// distance map, without generating the point cloud. Bin i covers the angles from
+  /// config.angleMin + i * config.angleIncrement to the start of the next bin and contains the
+  /// smallest range of all points within the height band.
+  /// \param[out] ranges range of each bin in [m], infinity for bins without a point
+  /// \param[in] config angular bins, height band and range limits
+  void generateLaserScan(std::vector<float>& ranges, const LaserScanConfig& config);
+
+  /// Gets the look-up table used for the point cloud calculation, e.g. to project single pixels.
+  /// A pixel with the distance map value d is located at
+  /// lut[i] * d * DISTANCE_MAP_UNIT - (0, 0, f2rc / 1000) in the camera perspective in meters.
+  /// The table is calculated on the first call after a change of the metadata.
+  /// \return vector containing one entry per pixel
+  const std::vector<PointXYZ>& getPointCloudLookUpTable();
+
   /// factor to convert Radial distance map from fixed point to floating point
   static const float DISTANCE_MAP_UNIT;
 
@@ -426,6 +506,24 @@ public:
   /// \return Returns the last error, OK in case there occurred no error
   DataHandlerError getLastError();
 
+  /// Enables the statistics of the distance and intensity map. They are calculated while the maps
+  /// are copied out of the received Blob, so no additional pass over the maps is needed.
+  /// \param[in] enabled true to calculate the statistics for each frame
+  /// \param[in] histogramBins number of histogram bins, a power of 2 up to 65536
+  void setStatisticsEnabled(bool enabled, uint32_t histogramBins = 256u);
+
+  /// Gets the statistics of the current frame. All figures are 0 if the statistics are disabled
+  /// or the frame does not contain the map.
+  /// \return statistics of the distance and intensity map
+  const FrameStatistics& getStatistics() const;
+
+  /// Gets the durations of the parsing stages (XML, DEPTHMAP_CRC and DEPTHMAP_COPY), recorded while
+  /// enabled by setEnabled. Only available if the library has been built with
+  /// ENABLE_INSTRUMENTATION.
+  ///
+  /// \return histograms which may be read and reset from another thread
+  StageHistograms& getStageHistograms();
+
   /// Gets the structure with the active segments.
   ///
   /// \return Returns the structure with the active segments
@@ -524,6 +622,15 @@ private:
 
   /// Stores the last error which occurred while parsing the Blob data segments
   DataHandlerError m_lastDataHandlerError;
+
+  /// Calculate the statistics while parsing the depth map
+  bool m_statisticsEnabled;
+
+  /// Statistics of the current frame
+  FrameStatistics m_statistics;
+
+  /// Durations of the parsing stages
+  StageHistograms m_stageHistograms;
 };
 
 } // namespace visionary
@@ -21,9 +21,13 @@
 
 #pragma once
 
+#include "BlobRecorder.h"
+#include "SafeVisionaryData.h"
+#include "StageHistograms.h"
 #include "TcpSocket.h"
 #include "UdpSocket.h"
 #include "VisionaryData.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -62,6 +66,38 @@ enum class DataStreamError
   DATA_SEGMENT_IMU_ERROR
 };
 
+/// Number of values of DataStreamError
+constexpr std::size_t NUM_DATA_STREAM_ERRORS =
+  static_cast<std::size_t>(DataStreamError::DATA_SEGMENT_IMU_ERROR) + 1u;
+
+/// Number of values of DataHandlerError
+constexpr std::size_t NUM_DATA_HANDLER_ERRORS =
+  static_cast<std::size_t>(DataHandlerError::INVALID_VERSION_SEGMENT_IMU) + 1u;
+
+/// Health counters of a SafeVisionaryDataStream since its creation, see
+/// SafeVisionaryDataStream::getHealth(). Alert on the difference of two snapshots.
+struct StreamHealth
+{
+  uint64_t fragmentsReceived; ///< UDP fragments or TCP packets received
+  uint64_t fragmentsSkipped;  ///< UDP fragments skipped while searching the start of a Blob
+  uint64_t bytesReceived;     ///< bytes received from the transport, including UDP headers
+  uint64_t blobsCompleted;    ///< Blobs received and parsed successfully
+  uint64_t resyncs;           ///< searches for the start of a Blob which had to skip data
+  uint64_t timeouts;          ///< receive calls which timed out or failed
+  uint64_t blobNumberGaps;    ///< jumps of the UDP Blob number, i.e. events with lost Blobs
+  uint64_t blobsLost; ///< UDP Blobs missing between two complete ones, partially received or not
+
+  /// Calls for the next Blob which failed, by the DataStreamError reported by getLastError()
+  uint64_t blobsDropped[NUM_DATA_STREAM_ERRORS];
+
+  /// Blobs dropped because of an invalid data segment, by the DataHandlerError of the
+  /// SafeVisionaryData handler
+  uint64_t segmentErrors[NUM_DATA_HANDLER_ERRORS];
+
+  /// \return number of all failed calls for the next Blob
+  uint64_t getNumBlobsDropped() const;
+};
+
 class SafeVisionaryDataStream
 {
 public:
@@ -71,6 +107,8 @@ public:
   /// Connects to the sensor data stream using the given UDP port
   ///
   /// \param[in] port    UDP port to bind
+  /// \param[in] receiveBufferSize requested socket receive buffer size in bytes; raise it when
+  ///                              fragments get lost at high frame rates or with several cameras
   ///
   /// \retval true The connection to the sensor data stream has been successfully established.
   /// \retval false The connection attempt failed; the sensor is either
@@ -78,16 +116,35 @@ public:
   ///               - not available using for PCs network settings (different subnet)
   ///               - the protocol type or the port did not match. Please check your sensor
   ///               documentation.
-  bool openUdpConnection(std::uint16_t port);
+  bool openUdpConnection(std::uint16_t port,
+                         int receiveBufferSize = UdpSocket::DEFAULT_RECEIVE_BUFFER_SIZE);
+
+  /// Receives the sensor data stream as UDP fragments from the given transport instead of a UDP
+  /// socket, e.g. from a BlobReplayTransport.
+  ///
+  /// \param[in] transport transport delivering one UDP datagram per recv call
+  /// \retval true always, the transport is expected to be open
+  bool openUdpConnection(std::unique_ptr<ITransport> transport);
 
   /// Connects to the sensor data stream using the given TCP port and given IPAddress
   bool openTcpConnection(std::uint16_t port, std::string deviceIpAddress);
 
+  /// Receives the sensor data stream as TCP byte stream from the given transport instead of a TCP
+  /// socket, e.g. from a BlobReplayTransport.
+  ///
+  /// \param[in] transport transport delivering the byte stream
+  /// \retval true always, the transport is expected to be open
+  bool openTcpConnection(std::unique_ptr<ITransport> transport);
+
   /// Closes the connection. It is allowed to call close of a connection
   /// that is not open. In this case this call is a no-op.
+  ///
+  /// The transport is shut down but kept until the next open or the destruction of the stream, so
+  /// close may be called while another thread waits in getNextBlobUdp. Opening a new connection or
+  /// destroying the stream must not race with a receiving thread.
   void closeUdpConnection();
 
-  // Close the Tcp connection
+  /// Closes the Tcp connection, see closeUdpConnection for the threading rules.
   void closeTcpConnection();
 
   /// Receive a single blob from the connected device and store it in buffer.
@@ -95,6 +152,12 @@ public:
   /// \return Returns true when a complete blob has been successfully received.
   bool getNextBlobUdp();
 
+  /// Receives the Blob until the header of the next Blob arrives. When the receive fails before,
+  /// e.g. at the end of a replayed log, the data received so far is parsed as the last Blob and
+  /// getLastError keeps reporting the receive error.
+  ///
+  /// \param[in,out] receiveBufferPacketSize header of the current Blob, returns the header of the
+  ///                                        next Blob or is cleared when the receive failed
   /// \return Returns true when a complete blob has been successfully received.
   bool getNextBlobTcp(std::vector<std::uint8_t>& receiveBufferPacketSize);
 
@@ -103,18 +166,64 @@ public:
   /// \return Returns the last error, OK in case there occurred no error
   DataStreamError getLastError();
 
-  // start bytes of Blob data have been found
+  // start bytes of Blob data have been found, false when the receive failed before
   bool getBlobStartTcp(std::vector<std::uint8_t>& receiveBufferPacketSize);
 
+  /// Parses a complete Blob which has not been received by this stream, e.g. one read by a
+  /// BlobLogReader. The Blob is checked and parsed like a received one.
+  ///
+  /// \param[in] data Blob data, beginning with the Blob header
+  /// \param[in] size size of the Blob data
+  /// \return Returns true when the Blob has been successfully parsed.
+  bool processBlob(const std::uint8_t* data, std::size_t size);
+
+  /// Sets a recorder which gets each reassembled Blob before it is parsed. The receiving thread
+  /// only copies the Blob into the ring buffer of the recorder.
+  ///
+  /// \param[in] recorder open recorder, nullptr stops recording
+  void setRecorder(std::shared_ptr<BlobRecorder> recorder);
+
+  /// Gets the durations of the receiving stages (RECEIVE, FRAGMENT, RECORD, PARSE and APPLICATION),
+  /// recorded while enabled by setEnabled. The parsing stages of the data segments are recorded by
+  /// SafeVisionaryData. Only available if the library has been built with ENABLE_INSTRUMENTATION.
+  ///
+  /// \return histograms which may be read and reset from another thread
+  StageHistograms& getStageHistograms();
+
+  /// Gets a snapshot of the health counters. It is cheap and may be called from another thread
+  /// while this stream is receiving. The counters are only written by the receiving thread, so
+  /// they are never reset; compare two snapshots to get the rates.
+  ///
+  /// \return health counters since the creation of the stream
+  StreamHealth getHealth() const;
+
 private:
+  /// Atomic counterpart of StreamHealth
+  struct HealthCounters
+  {
+    std::atomic<uint64_t> fragmentsReceived;
+    std::atomic<uint64_t> fragmentsSkipped;
+    std::atomic<uint64_t> bytesReceived;
+    std::atomic<uint64_t> blobsCompleted;
+    std::atomic<uint64_t> resyncs;
+    std::atomic<uint64_t> timeouts;
+    std::atomic<uint64_t> blobNumberGaps;
+    std::atomic<uint64_t> blobsLost;
+    std::atomic<uint64_t> blobsDropped[NUM_DATA_STREAM_ERRORS];
+    std::atomic<uint64_t> segmentErrors[NUM_DATA_HANDLER_ERRORS];
+  };
+
   /// Shared pointer to the Visionary data handler
   std::shared_ptr<VisionaryData> m_dataHandler;
 
-  /// Unique pointer the UDP socket used to receive the measurement data output stream
-  std::unique_ptr<UdpSocket> m_pTransportUdp;
+  /// Data handler as SafeVisionaryData to get its errors, nullptr for other data handlers
+  SafeVisionaryData* m_safeDataHandler;
 
-  /// Unique TCP socket used to receive the measurement data output stream
-  TcpSocket m_pTransportTcp;
+  /// Unique pointer the UDP transport used to receive the measurement data output stream
+  std::unique_ptr<ITransport> m_pTransportUdp;
+
+  /// Unique pointer the TCP transport used to receive the measurement data output stream
+  std::unique_ptr<ITransport> m_pTransportTcp;
 
   /// Buffer which stores the received Blob data
   std::vector<uint8_t> m_blobDataBuffer;
@@ -134,6 +243,24 @@ private:
   /// Stores the last error which occurred while parsing the data stream
   DataStreamError m_lastDataStreamError;
 
+  /// Optional recorder of the raw Blob data
+  std::shared_ptr<BlobRecorder> m_recorder;
+
+  /// Durations of the receiving stages
+  StageHistograms m_stageHistograms;
+
+  /// Time the last call for the next Blob returned, to measure the APPLICATION stage
+  std::chrono::steady_clock::time_point m_lastBlobReturn;
+
+  /// Health counters, written by the receiving thread only
+  HealthCounters m_health;
+
+  /// Blob number of the last completely received UDP Blob, to detect lost Blobs
+  uint16_t m_lastCompleteBlobNumber;
+
+  /// Flag whether m_lastCompleteBlobNumber is valid
+  bool m_hasLastCompleteBlobNumber;
+
   /// Gets the next fragment of the Blob data via the opened UDP socket.
   ///
   /// \param[out] receiveBuffer Vector which contains the received fragment
@@ -179,6 +306,21 @@ private:
   /// \return Returns true in case the parsing of the Blob data has been successful, otherwise
   /// returns false
   bool parseBlobData();
+
+  /// Checks that the segment offsets are ascending, leave room for the framing of each data
+  /// segment and lie within the Blob data, so that the segments can be parsed safely.
+  ///
+  /// \return Returns true in case the segment offsets are valid
+  bool checkSegmentOffsets() const;
+
+  /// Counts a completely received UDP Blob and detects gaps in the Blob numbers
+  void countCompleteBlobNumber();
+
+  /// Counts the result of a call for the next Blob, either as completed or by its error
+  ///
+  /// \param[in] result result of the call
+  /// \return the given result
+  bool countBlobResult(bool result);
 };
 
 } // namespace visionary
@@ -0,0 +1,137 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace visionary {
+
+/// Maximum size of the BLOBs
+constexpr std::size_t BLOB_SIZE_MAX = 3000u * 1024u;
+
+// Max UDP Packet size
+// We don't support jumbo frames here
+// The normal Ethernet MTU is 1500 bytes
+// the minimum IPv4 header size is 20bytes
+// the UDP header size is 8 bytes
+constexpr std::size_t MAX_UDP_BLOB_PACKET_SIZE = 1500u - (20u + 8u);
+
+// Max TCP Packet size
+// We don't support jumbo frames here
+// The normal Ethernet MTU is 1500 bytes
+// the minimum IPv4 header size is 20bytes
+// the minimum IPv4 TCP header size is 20 bytes
+constexpr std::size_t MAX_TCP_BLOB_PACKET_SIZE = 1500u - (20u + 20u);
+
+// 4 byte 0x2020202
+// 4 byte Packet Length
+// 2 byte Protocol Version
+// 1 byte Packet Type
+constexpr int32_t BLOB_HEADER_SIZE = 11; // 4+4+2+1 = 11
+
+/// Fixed value used in the protocols checksum field
+/// A checksum is not necessary since error checking is done on lower protocol levels already
+constexpr uint8_t PSEUDO_CHECKSUM = 0x45u;
+
+#pragma pack(push, 1)
+/// Structure of UDP header.
+/// All values are big-endian.
+struct UdpDataHeader
+{
+  uint16_t
+    packetNumber; ///< packet number: current Blob number, incremented by one for each complete Blob
+  uint16_t fragmentNumber; ///< current fragment number, incremented by one for new each fragment,
+                           ///< set to 0 in case of a new Blob
+  uint32_t timeStamp; ///< Time in us when the UDP datagram is generated, increasing monotonically
+                      ///< starting from system initialization.
+  uint32_t sourceIpAddress;  ///< IP address of the sensor
+  uint16_t sourcePortNumber; ///< UDP port number of the sensor
+  uint32_t destIpAddress;    ///< IP address of the target
+  uint16_t destPortNumber;   ///< UDP port number of the target
+  uint16_t protocolVersion;  ///< protocol version of the UDP header
+  uint16_t
+    dataLength; ///< length of the data within the UDP packet: bytes after protocol version
+                ///< (including Packet Type) until end of fragment (including pseudo checksum)
+  uint8_t flags; ///< flags of the fragment: Bit0-Bit6 reserved, Bit7 FIN: Set when this fragment is
+                 ///< the last one of the Blob
+  uint8_t packetType; //< type of the packed, set to 'b' = 0x62: Data packet
+};
+
+/// Structure of Blob header.
+/// All values are big-endian.
+struct BlobDataHeader
+{
+  uint32_t blobStart;  ///< 4 STx bytes, marks the start of Blob data, set to 0x02 0x02 0x02 0x02
+  uint32_t blobLength; ///< length of the Blob data
+  uint16_t protocolVersion;  ///< protocol version of the Blob data
+  uint8_t packetType;        ///< type of the packet, set to 'b' = 0x62: Data packet
+  uint16_t blobId;           ///< ID of the Blob data, set to 1 (3D data)
+  uint16_t numberOfSegments; ///< number of data segments within the Blob data
+};
+#pragma pack(pop)
+
+/// Version of UDP protocol
+constexpr uint8_t UDP_PROTOCOL_VERSION = 0x0001u;
+
+/// Packet type of UDP telegram: 'b' = Blob data
+constexpr uint8_t PACKET_TYPE_DATA = 0x62u;
+
+/// Bitmask for the flag last fragment
+constexpr uint8_t FLAG_LAST_FRAGMENT = (1u << 7);
+
+/// Blob data start bytes
+constexpr uint32_t BLOB_DATA_START = 0x02020202u;
+
+/// Protocol version of Blob data
+constexpr uint8_t BLOB_DATA_PROTOCOL_VERSION = 0x0001u;
+
+/// ID of Blob data (1: 3D data)
+constexpr uint8_t BLOB_DATA_BLOB_ID = 0x0001u;
+
+/// Offsets of the data segments are relative to this position of the Blob data, i.e. the Blob data
+/// begins after the packet type
+constexpr std::size_t BLOB_DATA_SEGMENT_BASE = sizeof(BlobDataHeader) - 2u * sizeof(uint16_t);
+
+/// Payload of a full UDP fragment, leaving room for the UDP header and the CRC
+constexpr std::size_t UDP_FRAGMENT_PAYLOAD_MAX =
+  MAX_UDP_BLOB_PACKET_SIZE - sizeof(UdpDataHeader) - sizeof(uint32_t);
+
+/// Writes one UDP fragment of a Blob as the device sends it: UDP header, payload and CRC32C.
+///
+/// \param[out] datagram buffer of at least payloadSize + sizeof(UdpDataHeader) + 4 bytes
+/// \param[in] blobNumber number of the Blob
+/// \param[in] fragmentNumber number of the fragment within the Blob, starting with 0
+/// \param[in] timestamp time in us when the fragment is sent
+/// \param[in] isLastFragment true for the last fragment of the Blob
+/// \param[in] payload part of the Blob data
+/// \param[in] payloadSize size of the payload, at most UDP_FRAGMENT_PAYLOAD_MAX
+/// \return size of the datagram
+std::size_t writeUdpFragment(uint8_t* datagram,
+                             uint16_t blobNumber,
+                             uint16_t fragmentNumber,
+                             uint32_t timestamp,
+                             bool isLastFragment,
+                             const uint8_t* payload,
+                             std::size_t payloadSize);
+
+} // namespace visionary
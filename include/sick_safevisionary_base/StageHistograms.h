@@ -0,0 +1,193 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace visionary {
+
+namespace InstrumentationStage {
+/// Processing stages measured when the library is built with ENABLE_INSTRUMENTATION
+enum Enum
+{
+  /// SafeVisionaryDataStream: from the first to the last UDP fragment of a Blob, or until the Blob
+  /// is dropped. Over TCP a Blob ends with the header of the next one, so this includes the wait
+  /// for the next Blob.
+  RECEIVE = 0,
+
+  /// SafeVisionaryDataStream: checking the UDP header (and CRC32C, if enabled) of one fragment
+  FRAGMENT,
+
+  /// SafeVisionaryDataStream: copying the Blob into the BlobRecorder
+  RECORD,
+
+  /// SafeVisionaryDataStream: parsing all segments of a Blob
+  PARSE,
+
+  /// SafeVisionaryDataStream: from the return of getNextBlobUdp/Tcp to the next call, i.e. the
+  /// processing of the application
+  APPLICATION,
+
+  /// SafeVisionaryData: parsing the XML segment, including the check of its change counter
+  XML,
+
+  /// SafeVisionaryData: CRC32 check of the depth map segment
+  DEPTHMAP_CRC,
+
+  /// SafeVisionaryData: copying the distance, intensity and state map out of the Blob
+  DEPTHMAP_COPY,
+
+  NUM_STAGES
+};
+
+/// \return name of the stage, e.g. "receive"
+const char* getName(Enum stage);
+} // namespace InstrumentationStage
+
+/// Copy of a LatencyHistogram
+struct HistogramSnapshot
+{
+  uint64_t count;                ///< number of recorded durations
+  uint64_t sum;                  ///< sum of the recorded durations in ns
+  uint64_t max;                  ///< largest recorded duration in ns
+  std::vector<uint64_t> buckets; ///< number of durations per bucket, see LatencyHistogram
+
+  /// \return mean duration in ns, 0 if nothing has been recorded
+  double getMean() const;
+
+  /// \param[in] quantile quantile between 0 and 1, e.g. 0.99
+  /// \return upper bound in ns of the bucket containing the quantile, 0 if nothing has been
+  ///         recorded
+  uint64_t getPercentile(double quantile) const;
+};
+
+/// Histogram of durations in ns with log-linear buckets: each power of 2 is split into
+/// 2^SUB_BUCKET_BITS linear buckets, so the relative error is below 12.5% from 1 ns up to 68 s.
+/// Recording is lock-free and may happen concurrently with snapshot and reset.
+class LatencyHistogram
+{
+public:
+  static constexpr int SUB_BUCKET_BITS     = 3;
+  static constexpr int MAX_EXPONENT        = 36;
+  static constexpr std::size_t NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1)
+                                             << SUB_BUCKET_BITS;
+
+  LatencyHistogram();
+
+  /// Adds one duration
+  void record(uint64_t nanoseconds);
+
+  /// \return copy of the current counts; concurrent recordings may be partially contained
+  HistogramSnapshot snapshot() const;
+
+  /// Clears all counts
+  void reset();
+
+  /// \return index of the bucket of the given duration
+  static std::size_t getBucketIndex(uint64_t nanoseconds);
+
+  /// \return smallest duration in ns belonging to the bucket
+  static uint64_t getBucketLowerBound(std::size_t index);
+
+  /// \return smallest duration in ns belonging to the next bucket
+  static uint64_t getBucketUpperBound(std::size_t index);
+
+private:
+  std::atomic<uint64_t> m_buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_sum;
+  std::atomic<uint64_t> m_max;
+};
+
+/// One LatencyHistogram per InstrumentationStage with a runtime switch. Measuring is disabled by
+/// default; while disabled, a StageTimer costs a single relaxed load.
+class StageHistograms
+{
+public:
+  StageHistograms();
+
+  /// Enables or disables recording. It has no effect unless the library has been built with
+  /// ENABLE_INSTRUMENTATION.
+  void setEnabled(bool enabled);
+
+  /// \return true if recording is enabled
+  bool isEnabled() const;
+
+  /// Adds one duration to the histogram of the stage
+  void record(InstrumentationStage::Enum stage, std::chrono::steady_clock::duration duration);
+
+  /// \return copy of the histogram of the stage
+  HistogramSnapshot snapshot(InstrumentationStage::Enum stage) const;
+
+  /// Clears the histograms of all stages
+  void reset();
+
+private:
+  std::atomic<bool> m_enabled;
+  LatencyHistogram m_histograms[InstrumentationStage::NUM_STAGES];
+};
+
+/// Measures the duration of its scope and records it on destruction, if recording was enabled on
+/// construction
+class StageTimer
+{
+public:
+  StageTimer(StageHistograms& histograms, InstrumentationStage::Enum stage)
+    : m_histograms(histograms.isEnabled() ? &histograms : nullptr)
+    , m_stage(stage)
+  {
+    if (nullptr != m_histograms)
+    {
+      m_start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~StageTimer()
+  {
+    if (nullptr != m_histograms)
+    {
+      m_histograms->record(m_stage, std::chrono::steady_clock::now() - m_start);
+    }
+  }
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+  StageHistograms* m_histograms;
+  InstrumentationStage::Enum m_stage;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace visionary
+
+/// Declares a StageTimer measuring the rest of the current scope. Compiles to nothing unless
+/// ENABLE_INSTRUMENTATION is defined.
+#ifdef ENABLE_INSTRUMENTATION
+#  define VISIONARY_STAGE_TIMER(name, histograms, stage) \
+    ::visionary::StageTimer name(histograms, ::visionary::InstrumentationStage::stage)
+#else
+#  define VISIONARY_STAGE_TIMER(name, histograms, stage)
+#endif
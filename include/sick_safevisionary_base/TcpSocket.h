@@ -50,11 +50,21 @@ namespace visionary {
 class TcpSocket : public ITransport
 {
 public:
+  TcpSocket();
+
   int connect(const std::string& hostname, uint16_t port);
   int openServer(uint16_t port);
   int openTcp(uint16_t port);
   bool WaitForConnection();
-  int shutdown();
+  int shutdown() override;
+
+  /// Shuts down the connection accepted by WaitForConnection in both directions, so that a
+  /// blocking recv or read returns. The socket itself is closed by closeConnection.
+  int shutdownConnection();
+
+  /// Closes the connection accepted by WaitForConnection. The server socket stays open to wait for
+  /// the next client.
+  int closeConnection();
 
   int send(const std::vector<std::uint8_t>& buffer) override;
   int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override;
@@ -0,0 +1,103 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace visionary {
+
+/// Temporal filter for the uint16 distance map to suppress flicker of single pixels.
+///
+/// The filter keeps a per-pixel history of the previous frames: either the state of an
+/// exponential moving average or a ring of the last N distance maps for a median. The invalid
+/// values 0 and 0xFFFF never enter the average or the median, an invalid input pixel results in
+/// an invalid (0) output pixel. The history of a pixel is restarted when its new value differs
+/// from the filtered value by more than the jump threshold, so real motion is not smeared.
+///
+/// The filtered map has the layout of the input and can be passed to
+/// SafeVisionaryData::generatePointCloud(distanceMap, pointCloud).
+class TemporalDepthFilter
+{
+public:
+  enum class Mode
+  {
+    EMA,   ///< exponential moving average
+    MEDIAN ///< median of the last historySize frames
+  };
+
+  /// Largest supported number of frames for the median
+  static const int MAX_HISTORY_SIZE = 9;
+
+  /// \param[in] mode filter applied to each pixel
+  /// \param[in] historySize number of frames for the median, 1 up to MAX_HISTORY_SIZE
+  explicit TemporalDepthFilter(Mode mode = Mode::EMA, int historySize = 5);
+  ~TemporalDepthFilter();
+
+  /// Sets the filter mode and restarts the history.
+  void setMode(Mode mode);
+  Mode getMode() const;
+
+  /// Sets the number of frames for the median and restarts the history.
+  void setHistorySize(int historySize);
+  int getHistorySize() const;
+
+  /// Sets the weight of a new value in the moving average, between 0 and 1. Default is 0.3.
+  void setSmoothingFactor(float alpha);
+
+  /// Sets the jump threshold relative to the filtered distance, e.g. 0.05 restarts the history
+  /// of a pixel at 2 m distance if the new value differs by more than 10 cm. Default is 0.05.
+  void setJumpThreshold(float relativeThreshold);
+
+  /// Restarts the history of all pixels.
+  void reset();
+
+  /// Filters the next distance map. The history is (re-)allocated on the first call and whenever
+  /// the size of the map changes, so memory is only allocated once for a running stream.
+  ///
+  /// \param[in] distanceMap distance map of the current frame
+  /// \param[out] filteredMap filtered distance map, resized to the size of the input. May be the
+  ///             same vector as the input.
+  void apply(const std::vector<uint16_t>& distanceMap, std::vector<uint16_t>& filteredMap);
+
+private:
+  void applyEma(const uint16_t* input, uint16_t* output, std::size_t count);
+  void applyMedian(const uint16_t* input, uint16_t* output, std::size_t count);
+
+  Mode m_mode;
+  int m_historySize;
+  float m_alpha;
+  float m_jumpThreshold;
+
+  /// Moving average of each pixel, 0 if the pixel has no history
+  std::vector<float> m_emaState;
+
+  /// Ring of the last historySize distance maps, one map after the other
+  std::vector<uint16_t> m_ring;
+  /// Map in the ring the next frame is written to
+  int m_ringIndex;
+  /// Last output of the median, used to detect jumps
+  std::vector<uint16_t> m_lastOutput;
+};
+
+} // namespace visionary
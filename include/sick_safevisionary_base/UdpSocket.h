@@ -50,11 +50,24 @@ namespace visionary {
 class UdpSocket : public ITransport
 {
 public:
+  /// Receive buffer size requested by bindPort unless specified otherwise
+  static constexpr int DEFAULT_RECEIVE_BUFFER_SIZE = 512 * 1024;
+
   UdpSocket();
 
   int connect(const std::string& hostname, uint16_t port);
-  int bindPort(std::uint16_t port);
-  int shutdown();
+
+  /// Opens the socket for receiving on the given port.
+  ///
+  /// \param[in] port              port in network byte order
+  /// \param[in] receiveBufferSize requested SO_RCVBUF size in bytes, the operating system may
+  ///                              adjust it (e.g. limited by net.core.rmem_max on Linux)
+  /// \return 0 on success
+  int bindPort(std::uint16_t port, int receiveBufferSize = DEFAULT_RECEIVE_BUFFER_SIZE);
+
+  /// \return the receive buffer size granted by the operating system, -1 on error
+  int getReceiveBufferSize() const;
+  int shutdown() override;
 
   int send(const std::vector<std::uint8_t>& buffer) override;
   int recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive) override;
@@ -22,11 +22,13 @@
 #pragma once
 
 #include <iostream>
+#include <limits>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
 #include "PointXYZ.h"
+#include "QuantizedPointCloud.h"
 #define TOTAL_SEGMENT_NUMBER 9
 
 namespace visionary {
@@ -61,6 +63,81 @@ struct DataSetsActive
   bool hasDataSetIMU;
 };
 
+/// Reduction applied to each pixel block when generating a decimated point cloud
+enum class PixelBinning
+{
+  STRIDE, ///< Take the center pixel of each block, the other pixels are not touched
+  MIN,    ///< Take the smallest valid distance of each block
+  MEDIAN  ///< Take the median of the valid distances of each block
+};
+
+/// Options to restrict a point cloud to a volume of interest while it is generated
+struct PointCloudGating
+{
+  PointCloudGating()
+    : minRange(0.f)
+    , maxRange(std::numeric_limits<float>::max())
+    , useCropBox(false)
+    , world2boxMatrix{1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1.}
+    , boxMin{-std::numeric_limits<float>::max(),
+             -std::numeric_limits<float>::max(),
+             -std::numeric_limits<float>::max()}
+    , boxMax{std::numeric_limits<float>::max(),
+             std::numeric_limits<float>::max(),
+             std::numeric_limits<float>::max()}
+    , removeRejected(false)
+  {
+  }
+
+  /// Minimal radial distance of a point in [m]. Tested on the raw distance map value.
+  float minRange;
+  /// Maximal radial distance of a point in [m]. Tested on the raw distance map value.
+  float maxRange;
+  /// Reject points outside of the crop box
+  bool useCropBox;
+  /// Transformation from world coordinates into the crop box frame, row major with the
+  /// translation in [m]. Keep the identity for an axis-aligned crop box.
+  double world2boxMatrix[4 * 4];
+  /// Lower x, y, z bounds of the crop box in box coordinates in [m]
+  float boxMin[3];
+  /// Upper x, y, z bounds of the crop box in box coordinates in [m]
+  float boxMax[3];
+  /// Remove rejected points from the point cloud instead of setting them to NaN. The point cloud
+  /// is not organized any more in this case.
+  bool removeRejected;
+};
+
+/// Options to project the distance map onto a 2D laser scan in the x-y plane of the world
+/// coordinate system given by the Cam2World matrix
+struct LaserScanConfig
+{
+  LaserScanConfig()
+    : angleMin(-3.14159265f)
+    , angleMax(3.14159265f)
+    , angleIncrement(3.14159265f / 360.f)
+    , minHeight(-std::numeric_limits<float>::max())
+    , maxHeight(std::numeric_limits<float>::max())
+    , rangeMin(0.f)
+    , rangeMax(std::numeric_limits<float>::max())
+  {
+  }
+
+  /// Start angle of the first bin in [rad], measured from the world x axis towards the y axis
+  float angleMin;
+  /// End angle of the last bin in [rad]
+  float angleMax;
+  /// Angular width of each bin in [rad]
+  float angleIncrement;
+  /// Lower bound of the height band, i.e. of the world z coordinate, in [m]
+  float minHeight;
+  /// Upper bound of the height band in [m]
+  float maxHeight;
+  /// Minimal range in the x-y plane of a point to be used in [m]
+  float rangeMin;
+  /// Maximal range in the x-y plane of a point to be used in [m]
+  float rangeMax;
+};
+
 struct PointXYZC
 {
   float x;
@@ -81,6 +158,9 @@ public:
   // Calculate and return the Point Cloud in the camera perspective. Units are in meters.
   virtual void generatePointCloud(std::vector<PointXYZ>& pointCloud) = 0;
 
+  // Largest supported edge length of a pixel block for the decimated point cloud
+  static const int MAX_BIN_SIZE = 8;
+
   // Transform the XYZ point cloud with the Cam2World matrix got from device
   // IN/OUT pointCloud  - Reference to the point cloud to be transformed. Contains the transformed
   // point cloud afterwards.
@@ -106,6 +186,13 @@ public:
   // Returns a reference to the camera parameter struct
   const CameraParameters& getCameraParameters() const;
 
+  /// Gets the upper three rows of the Cam2World matrix with the translation turned from [mm] to
+  /// [m], the frame of the point clouds.
+  ///
+  /// \param[in] cameraParams camera parameters, e.g. from getCameraParameters()
+  /// \param[out] matrix row-major 3x4 matrix
+  static void getCam2WorldMatrix(const CameraParameters& cameraParams, float (&matrix)[12]);
+
   //-----------------------------------------------
   // functions for parsing received blob
 
@@ -218,6 +305,79 @@ protected:
                           const ImageType& imgType,
                           std::vector<PointXYZ>& pointCloud);
 
+  // Recalculate the points of a rectangular region of an existing organized point cloud, e.g. for
+  // the parts of the map which have changed since the last frame. The whole point cloud is
+  // generated in case its size does not match the map.
+  // IN  map         - Image to be transformed
+  // IN  imgType     - Type of the image (needed for correct transformation)
+  // IN  colBegin, rowBegin, colEnd, rowEnd - Region of pixels [begin, end) to recalculate
+  // IN/OUT pointCloud - Organized point cloud of the map
+  void generatePointCloudRegion(const std::vector<uint16_t>& map,
+                                const ImageType& imgType,
+                                int colBegin,
+                                int rowBegin,
+                                int colEnd,
+                                int rowEnd,
+                                std::vector<PointXYZ>& pointCloud);
+
+  // Pre-calculate the lookup table for a decimated point cloud. Each entry belongs to the center
+  // of a binSize x binSize pixel block (STRIDE) or to the geometric center of the block (MIN,
+  // MEDIAN).
+  void preCalcCamInfoBinned(const ImageType& type, PixelBinning binning, int binSize);
+
+  // Calculate and return a decimated point cloud in the camera perspective. Units are in meters.
+  // Each binSize x binSize pixel block of the map is reduced to a single point. Invalid pixels
+  // are ignored by the MIN and MEDIAN binning, a block without any valid pixel results in an
+  // invalid (NaN) point. The point cloud stays organized with
+  // (width / binSize) x (height / binSize) points, remaining pixels at the right and bottom
+  // border are dropped.
+  // IN  map         - Image to be transformed
+  // IN  imgType     - Type of the image (needed for correct transformation)
+  // IN  binning     - Reduction applied to each pixel block
+  // IN  binSize     - Edge length of the pixel blocks, 1 up to MAX_BIN_SIZE
+  // OUT pointCloud  - Reference to pass back the point cloud. Will be resized and only contain new
+  // point cloud.
+  void generatePointCloud(const std::vector<uint16_t>& map,
+                          const ImageType& imgType,
+                          PixelBinning binning,
+                          int binSize,
+                          std::vector<PointXYZ>& pointCloud);
+
+  // Calculate and return the point cloud in world coordinates, restricted to a volume of
+  // interest. The range gate is applied on the raw distance values before any floating point
+  // computation, the crop box after the transformation with the Cam2World matrix.
+  // IN  map         - Image to be transformed
+  // IN  imgType     - Type of the image (needed for correct transformation)
+  // IN  gating      - Range gate and crop box
+  // OUT pointCloud  - Reference to pass back the point cloud. Will be resized and only contain new
+  // point cloud.
+  void generateCroppedPointCloud(const std::vector<uint16_t>& map,
+                                 const ImageType& imgType,
+                                 const PointCloudGating& gating,
+                                 std::vector<PointXYZ>& pointCloud);
+
+  // Calculate and return the quantized point cloud in the camera perspective, without an
+  // intermediate floating point cloud. The unit of the given point cloud is kept.
+  // IN  map         - Image to be transformed
+  // IN  imgType     - Type of the image (needed for correct transformation)
+  // OUT pointCloud  - Reference to pass back the point cloud. Will be resized to the image size.
+  void generateQuantizedPointCloud(const std::vector<uint16_t>& map,
+                                   const ImageType& imgType,
+                                   QuantizedPointCloud& pointCloud);
+
+  // Calculate a 2D laser scan from the map without generating the point cloud. Each pixel is
+  // transformed into world coordinates, pixels within the height band are sorted into angular bins
+  // around the world z axis, and each bin keeps the smallest range in the x-y plane.
+  // IN  map         - Image to be transformed
+  // IN  imgType     - Type of the image (needed for correct transformation)
+  // IN  config      - Angular bins, height band and range limits
+  // OUT ranges      - Smallest range of each bin in [m], infinity for bins without a point.
+  // Resized to the number of bins.
+  void generateLaserScan(const std::vector<uint16_t>& map,
+                         const ImageType& imgType,
+                         const LaserScanConfig& config,
+                         std::vector<float>& ranges);
+
   //-----------------------------------------------
   // Camera parameters to be read from XML Metadata part
   CameraParameters m_cameraParams;
@@ -248,6 +408,14 @@ protected:
   // The look-up-tables containing pre-calculations
   std::vector<PointXYZ> m_preCalcCamInfo;
 
+  // Image type, binning and block size the decimated look-up-table has been generated for.
+  // UNKNOWN if it has to be (re-)generated.
+  ImageType m_preCalcCamInfoBinnedType;
+  PixelBinning m_preCalcCamInfoBinning;
+  int m_preCalcCamInfoBinSize;
+  // The decimated look-up-table, one entry per pixel block
+  std::vector<PointXYZ> m_preCalcCamInfoBinned;
+
 private:
   // Bitmasks to calculate the timestamp in milliseconds
   // Bits of the devices timestamp: 5 unused - 12 Year - 4 Month - 5 Day - 11 Timezone - 5 Hour - 6
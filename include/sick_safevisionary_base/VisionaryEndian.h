@@ -213,6 +213,20 @@ inline T readUnalignLittleEndian(const void* ptr)
   return littleEndianToNative<T>(readUnaligned<T>(ptr));
 }
 
+template <typename T>
+inline void writeUnalignBigEndian(void* ptr, T value)
+{
+  value = nativeToBigEndian<T>(value);
+  memcpy(ptr, &value, sizeof(T));
+}
+
+template <typename T>
+inline void writeUnalignLittleEndian(void* ptr, T value)
+{
+  value = nativeToLittleEndian<T>(value);
+  memcpy(ptr, &value, sizeof(T));
+}
+
 #if defined COLA_BYTE_ORDER_ENDIAN_LITTLE
 template <typename T>
 inline T nativeToColaByteOrder(T x)
@@ -0,0 +1,89 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PointXYZ.h"
+
+namespace visionary {
+
+/// Voxel grid downsampling for point clouds as returned by generatePointCloud() or
+/// transformPointCloud().
+///
+/// All points falling into the same cubic voxel are reduced to a single point. Like in PCL the
+/// voxel grid is anchored at the origin, so a static point falls into the same voxel in every
+/// frame. The voxels are found by sorting the points by their voxel key with a radix sort instead
+/// of hashing, using internal buffers which are kept between calls. After the first call (or a
+/// call to reserve()) with the sensor resolution no further memory allocations take place, as long
+/// as the output vector is reused as well.
+class VoxelGridFilter
+{
+public:
+  /// Representative point of a voxel
+  enum class Mode
+  {
+    CENTROID,   ///< Average of all points within the voxel
+    FIRST_POINT ///< First point within the voxel in the order of the input point cloud
+  };
+
+  /// \param[in] leafSize edge length of the voxels in the units of the point cloud (meters)
+  /// \param[in] mode representative point of a voxel
+  /// \param[in] maxPoints number of points to preallocate the internal buffers for, e.g. the
+  ///            pixel count of the sensor
+  VoxelGridFilter(float leafSize, Mode mode = Mode::CENTROID, std::size_t maxPoints = 0u);
+  ~VoxelGridFilter();
+
+  /// Preallocates the internal buffers for point clouds with up to maxPoints points
+  void reserve(std::size_t maxPoints);
+
+  void setLeafSize(float leafSize);
+  float getLeafSize() const;
+
+  void setMode(Mode mode);
+  Mode getMode() const;
+
+  /// Downsamples the point cloud. Invalid (NaN or infinite) points are ignored.
+  ///
+  /// \param[in] input point cloud to be downsampled
+  /// \param[out] output downsampled point cloud, one point per occupied voxel in the order of
+  ///             their voxel keys. Must not be the same vector as the input.
+  void filter(const std::vector<PointXYZ>& input, std::vector<PointXYZ>& output);
+
+private:
+  /// Sorts m_keys/m_indices by key with a stable LSD radix sort over keyBits bits
+  void sortByKey(std::size_t numPoints, uint32_t keyBits);
+
+  float m_leafSize;
+  Mode m_mode;
+
+  /// Voxel key and point index of each valid input point, plus the scratch buffers of the sort
+  std::vector<uint64_t> m_keys;
+  std::vector<uint64_t> m_keysScratch;
+  std::vector<uint32_t> m_indices;
+  std::vector<uint32_t> m_indicesScratch;
+  std::vector<uint32_t> m_histogram;
+};
+
+} // namespace visionary
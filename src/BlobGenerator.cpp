@@ -0,0 +1,333 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobGenerator.h"
+#include "sick_safevisionary_base/CRC.h"
+#include "sick_safevisionary_base/SafeVisionaryData.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+
+namespace visionary {
+
+namespace {
+/// Data segments in the order of the Blob, following the XML segment
+enum DataSegment
+{
+  SEGMENT_DEPTHMAP,
+  SEGMENT_DEVICESTATUS,
+  SEGMENT_ROI,
+  SEGMENT_LOCALIOS,
+  SEGMENT_FIELDINFORMATION,
+  SEGMENT_LOGICSIGNALS,
+  SEGMENT_IMU,
+  NUM_DATA_SEGMENTS
+};
+
+/// Segment versions as sent by the device firmware supported by SafeVisionaryData
+constexpr uint16_t SEGMENT_VERSIONS[NUM_DATA_SEGMENTS] = {2u, 1u, 1u, 1u, 1u, 1u, 1u};
+
+constexpr uint16_t NUM_SEGMENTS = NUM_DATA_SEGMENTS + 1u;
+
+/// Length, timestamp and version before the payload of a data segment
+constexpr std::size_t SEGMENT_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t);
+
+/// CRC32 and copy of the length after the payload of a data segment
+constexpr std::size_t SEGMENT_TRAILER_SIZE = 2u * sizeof(uint32_t);
+
+/// Frame number, device status and flags before the maps of the depth map segment
+constexpr std::size_t DEPTHMAP_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+
+/// Change counter of the static data segments
+constexpr uint32_t STATIC_CHANGE_COUNTER = 1u;
+
+uint16_t toMapUnit(double distance)
+{
+  const double value = distance / SafeVisionaryData::DISTANCE_MAP_UNIT;
+  return static_cast<uint16_t>(std::min(std::max(value, 1.0), 65534.0));
+}
+} // namespace
+
+BlobGenerator::BlobGenerator()
+  : m_wallDistance(3000.0)
+  , m_xmlChangeCounter(0u)
+{
+  setResolution(512, 424);
+}
+
+void BlobGenerator::setResolution(int width, int height)
+{
+  CameraParameters params{};
+  params.width  = width;
+  params.height = height;
+  for (int idx = 0; idx < 4; ++idx)
+  {
+    params.cam2worldMatrix[idx * 5] = 1.0;
+  }
+  const double pi = std::acos(-1.0);
+  params.fx       = (width / 2.0) / std::tan(35.0 * pi / 180.0);
+  params.fy       = params.fx;
+  params.cx       = (width - 1) / 2.0;
+  params.cy       = (height - 1) / 2.0;
+  setCameraParameters(params);
+}
+
+void BlobGenerator::setCameraParameters(const CameraParameters& params)
+{
+  m_cameraParams = params;
+  update();
+}
+
+const CameraParameters& BlobGenerator::getCameraParameters() const
+{
+  return m_cameraParams;
+}
+
+void BlobGenerator::setWallDistance(double distance)
+{
+  m_wallDistance = distance;
+  update();
+}
+
+std::size_t BlobGenerator::getBlobSize() const
+{
+  return BLOB_DATA_SEGMENT_BASE + m_segmentOffsets.back();
+}
+
+uint64_t BlobGenerator::toDeviceTimestamp(std::chrono::system_clock::time_point time)
+{
+  const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+  std::tm local;
+#ifdef _WIN32
+  localtime_s(&local, &seconds);
+#else
+  localtime_r(&seconds, &local);
+#endif
+  const int64_t milliseconds =
+    std::chrono::duration_cast<std::chrono::milliseconds>(
+      time - std::chrono::system_clock::from_time_t(seconds))
+      .count();
+
+  // bits: 5 unused, 12 year, 4 month, 5 day, 11 time zone, 5 hour, 6 minute, 6 second, 10 ms
+  return (static_cast<uint64_t>(local.tm_year + 1900) << 47u) |
+         (static_cast<uint64_t>(local.tm_mon + 1) << 43u) |
+         (static_cast<uint64_t>(local.tm_mday) << 38u) |
+         (static_cast<uint64_t>(local.tm_hour) << 22u) |
+         (static_cast<uint64_t>(local.tm_min) << 16u) |
+         (static_cast<uint64_t>(local.tm_sec) << 10u) |
+         static_cast<uint64_t>(std::min<int64_t>(std::max<int64_t>(milliseconds, 0), 999));
+}
+
+void BlobGenerator::update()
+{
+  m_xmlChangeCounter++;
+
+  std::ostringstream xml;
+  xml.precision(17);
+  xml << "<SickRecord><DataSets>"
+      << "<DataSetDepthMap><FormatDescriptionDepthMap><DataStream>"
+      << "<Width>" << m_cameraParams.width << "</Width>"
+      << "<Height>" << m_cameraParams.height << "</Height>"
+      << "<CameraToWorldTransform>";
+  for (double value : m_cameraParams.cam2worldMatrix)
+  {
+    xml << "<value>" << value << "</value>";
+  }
+  xml << "</CameraToWorldTransform>"
+      << "<CameraMatrix><FX>" << m_cameraParams.fx << "</FX><FY>" << m_cameraParams.fy
+      << "</FY><CX>" << m_cameraParams.cx << "</CX><CY>" << m_cameraParams.cy
+      << "</CY></CameraMatrix>"
+      << "<CameraDistortionParams><K1>" << m_cameraParams.k1 << "</K1><K2>" << m_cameraParams.k2
+      << "</K2><P1>" << m_cameraParams.p1 << "</P1><P2>" << m_cameraParams.p2 << "</P2><K3>"
+      << m_cameraParams.k3 << "</K3></CameraDistortionParams>"
+      << "<FocalToRayCross>" << m_cameraParams.f2rc << "</FocalToRayCross>"
+      << "<Distance>uint16</Distance><Intensity>uint16</Intensity>"
+      << "<Confidence>uint8</Confidence>"
+      << "</DataStream></FormatDescriptionDepthMap></DataSetDepthMap>"
+      << "<DataSetDeviceStatus/><DataSetROI/><DataSetLocalIOs/><DataSetFieldInformation/>"
+      << "<DataSetLogicalSignals/><DataSetIMU/>"
+      << "</DataSets></SickRecord>";
+  m_xml = xml.str();
+
+  // radial distances of a wall and of a box at half its distance, seen through a pinhole camera
+  const std::size_t numPixel = static_cast<std::size_t>(m_cameraParams.width) *
+                               static_cast<std::size_t>(m_cameraParams.height);
+  m_wallDistanceMap.resize(numPixel);
+  m_boxDistance.resize(numPixel);
+  m_intensityMap.resize(numPixel);
+  for (int row = 0; row < m_cameraParams.height; ++row)
+  {
+    const double yp = (row - m_cameraParams.cy) / m_cameraParams.fy;
+    for (int col = 0; col < m_cameraParams.width; ++col)
+    {
+      const double xp        = (col - m_cameraParams.cx) / m_cameraParams.fx;
+      const double rayLength = std::sqrt(1.0 + xp * xp + yp * yp);
+      const std::size_t idx  = static_cast<std::size_t>(row * m_cameraParams.width + col);
+      m_wallDistanceMap[idx] = toMapUnit(m_wallDistance * rayLength - m_cameraParams.f2rc);
+      m_boxDistance[idx]     = toMapUnit(m_wallDistance * 0.5 * rayLength - m_cameraParams.f2rc);
+      m_intensityMap[idx]    = static_cast<uint16_t>(1000u + ((row ^ col) & 0xffu));
+    }
+  }
+
+  const std::size_t payloadSizes[NUM_DATA_SEGMENTS] = {
+    DEPTHMAP_HEADER_SIZE + numPixel * (2u * sizeof(uint16_t) + sizeof(uint8_t)),
+    sizeof(DEVICE_STATUS_ELEMENT),
+    sizeof(ROI_DATA),
+    sizeof(LOCALIOS_ELEMENT),
+    sizeof(FIELDINFORMATION_DATA),
+    sizeof(LOGICSIGNALS_DATA),
+    sizeof(IMU_ELEMENT)};
+
+  const std::size_t blobHeaderSize = sizeof(BlobDataHeader) + NUM_SEGMENTS * 2u * sizeof(uint32_t);
+  m_segmentOffsets.clear();
+  m_segmentOffsets.push_back(static_cast<uint32_t>(blobHeaderSize - BLOB_DATA_SEGMENT_BASE));
+  m_segmentOffsets.push_back(static_cast<uint32_t>(m_segmentOffsets.back() + m_xml.size()));
+  for (std::size_t payloadSize : payloadSizes)
+  {
+    m_segmentOffsets.push_back(static_cast<uint32_t>(
+      m_segmentOffsets.back() + SEGMENT_HEADER_SIZE + payloadSize + SEGMENT_TRAILER_SIZE));
+  }
+}
+
+void BlobGenerator::drawBox(uint32_t frameNumber, uint8_t* distanceMap) const
+{
+  const int width    = m_cameraParams.width;
+  const int boxWidth = std::max(width / 4, 1);
+  const int rowBegin = m_cameraParams.height * 3 / 8;
+  const int rowEnd   = m_cameraParams.height * 5 / 8;
+  const int colBegin = static_cast<int>((frameNumber * 4u) % static_cast<uint32_t>(width));
+  const int colEnd   = std::min(colBegin + boxWidth, width);
+
+  for (int row = rowBegin; row < rowEnd; ++row)
+  {
+    for (int col = colBegin; col < colEnd; ++col)
+    {
+      const std::size_t idx = static_cast<std::size_t>(row * width + col);
+      writeUnalignLittleEndian<uint16_t>(distanceMap + idx * sizeof(uint16_t), m_boxDistance[idx]);
+    }
+  }
+}
+
+void BlobGenerator::generate(uint32_t frameNumber, uint64_t timestamp, std::vector<uint8_t>& blob)
+{
+  const std::size_t blobSize = getBlobSize();
+  blob.resize(blobSize);
+  uint8_t* const data = blob.data();
+
+  // Blob header, the length counts all bytes after the length field
+  writeUnalignBigEndian<uint32_t>(data + offsetof(BlobDataHeader, blobStart), BLOB_DATA_START);
+  writeUnalignBigEndian<uint32_t>(data + offsetof(BlobDataHeader, blobLength),
+                                  static_cast<uint32_t>(blobSize - 2u * sizeof(uint32_t)));
+  writeUnalignBigEndian<uint16_t>(data + offsetof(BlobDataHeader, protocolVersion),
+                                  BLOB_DATA_PROTOCOL_VERSION);
+  data[offsetof(BlobDataHeader, packetType)] = PACKET_TYPE_DATA;
+  writeUnalignBigEndian<uint16_t>(data + offsetof(BlobDataHeader, blobId), BLOB_DATA_BLOB_ID);
+  writeUnalignBigEndian<uint16_t>(data + offsetof(BlobDataHeader, numberOfSegments), NUM_SEGMENTS);
+
+  uint8_t* segmentTable = data + sizeof(BlobDataHeader);
+  for (uint16_t segment = 0u; segment < NUM_SEGMENTS; ++segment)
+  {
+    uint32_t changeCounter = STATIC_CHANGE_COUNTER;
+    if (0u == segment)
+    {
+      changeCounter = m_xmlChangeCounter;
+    }
+    else if (DEPTHMAP_SEGMENT == segment)
+    {
+      changeCounter = frameNumber;
+    }
+    writeUnalignBigEndian<uint32_t>(segmentTable, m_segmentOffsets[segment]);
+    writeUnalignBigEndian<uint32_t>(segmentTable + sizeof(uint32_t), changeCounter);
+    segmentTable += 2u * sizeof(uint32_t);
+  }
+
+  std::memcpy(data + BLOB_DATA_SEGMENT_BASE + m_segmentOffsets[0], m_xml.data(), m_xml.size());
+
+  for (std::size_t segment = 0u; segment < NUM_DATA_SEGMENTS; ++segment)
+  {
+    uint8_t* const begin = data + BLOB_DATA_SEGMENT_BASE + m_segmentOffsets[segment + 1u];
+    const uint32_t length =
+      m_segmentOffsets[segment + 2u] - m_segmentOffsets[segment + 1u] - sizeof(uint32_t);
+    const uint32_t dataSize = length - static_cast<uint32_t>(SEGMENT_TRAILER_SIZE);
+
+    writeUnalignLittleEndian<uint32_t>(begin, length);
+    writeUnalignLittleEndian<uint64_t>(begin + sizeof(uint32_t), timestamp);
+    writeUnalignLittleEndian<uint16_t>(begin + sizeof(uint32_t) + sizeof(uint64_t),
+                                       SEGMENT_VERSIONS[segment]);
+    uint8_t* const payload = begin + SEGMENT_HEADER_SIZE;
+
+    switch (segment)
+    {
+      case SEGMENT_DEPTHMAP: {
+        const std::size_t numPixel = m_wallDistanceMap.size();
+        writeUnalignLittleEndian<uint32_t>(payload, frameNumber);
+        payload[sizeof(uint32_t)] =
+          static_cast<uint8_t>(DEVICE_STATUS::DEVICE_STATUS_NORMAL_OPERATION);
+        writeUnalignLittleEndian<uint16_t>(payload + sizeof(uint32_t) + sizeof(uint8_t), 0u);
+
+        uint8_t* const distanceMap  = payload + DEPTHMAP_HEADER_SIZE;
+        uint8_t* const intensityMap = distanceMap + numPixel * sizeof(uint16_t);
+        uint8_t* const stateMap     = intensityMap + numPixel * sizeof(uint16_t);
+        for (std::size_t idx = 0u; idx < numPixel; ++idx)
+        {
+          writeUnalignLittleEndian<uint16_t>(distanceMap + idx * sizeof(uint16_t),
+                                             m_wallDistanceMap[idx]);
+          writeUnalignLittleEndian<uint16_t>(intensityMap + idx * sizeof(uint16_t),
+                                             m_intensityMap[idx]);
+        }
+        std::memset(stateMap, 0, numPixel);
+        drawBox(frameNumber, distanceMap);
+        break;
+      }
+      case SEGMENT_DEVICESTATUS: {
+        DEVICE_STATUS_ELEMENT deviceStatus;
+        std::memset(&deviceStatus, 0, sizeof(deviceStatus));
+        deviceStatus.generalStatus.runModeActive = 1u;
+        std::memcpy(payload, &deviceStatus, sizeof(deviceStatus));
+        break;
+      }
+      case SEGMENT_IMU: {
+        IMU_ELEMENT imu;
+        std::memset(&imu, 0, sizeof(imu));
+        imu.acceleration.Z = 9.81f;
+        imu.orientation.W  = 1.0f;
+        std::memcpy(payload, &imu, sizeof(imu));
+        break;
+      }
+      default:
+        // ROI, I/Os, fields and logic signals stay inactive
+        std::memset(payload, 0, dataSize - (SEGMENT_HEADER_SIZE - sizeof(uint32_t)));
+        break;
+    }
+
+    uint8_t* const trailer = begin + sizeof(uint32_t) + dataSize;
+    writeUnalignLittleEndian<uint32_t>(
+      trailer, ~CRC_calcCrc32Block(begin + sizeof(uint32_t), dataSize, CRC_DEFAULT_INIT_VALUE32));
+    writeUnalignLittleEndian<uint32_t>(trailer + sizeof(uint32_t), length);
+  }
+}
+
+} // namespace visionary
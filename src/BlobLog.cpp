@@ -0,0 +1,59 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobLog.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+namespace visionary {
+
+void getBlobFrameInfo(const uint8_t* blob,
+                      std::size_t size,
+                      uint32_t& frameNumber,
+                      uint64_t& deviceTimestamp)
+{
+  frameNumber     = 0u;
+  deviceTimestamp = 0u;
+  if (size < sizeof(BlobDataHeader))
+  {
+    return;
+  }
+  const BlobDataHeader* pBlobHeader = reinterpret_cast<const BlobDataHeader*>(blob);
+  const uint16_t numSegments = readUnalignBigEndian<uint16_t>(&pBlobHeader->numberOfSegments);
+
+  // the segment table holds offset and change counter of each segment
+  const std::size_t segmentEntry = sizeof(BlobDataHeader) + 2u * sizeof(uint32_t);
+  if ((numSegments < 2u) || (size < segmentEntry + 2u * sizeof(uint32_t)))
+  {
+    return;
+  }
+  const uint32_t offset = readUnalignBigEndian<uint32_t>(blob + segmentEntry);
+  frameNumber           = readUnalignBigEndian<uint32_t>(blob + segmentEntry + sizeof(uint32_t));
+
+  // each data segment starts with its length followed by the timestamp
+  const std::size_t timestampPos = BLOB_DATA_SEGMENT_BASE + offset + sizeof(uint32_t);
+  if (timestampPos + sizeof(uint64_t) <= size)
+  {
+    deviceTimestamp = readUnalignLittleEndian<uint64_t>(blob + timestampPos);
+  }
+}
+
+} // namespace visionary
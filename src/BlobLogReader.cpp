@@ -0,0 +1,311 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobLogReader.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace visionary {
+
+namespace {
+inline uint64_t alignRecord(uint64_t size)
+{
+  const uint64_t mask = BLOB_LOG_ALIGNMENT - 1u;
+  return (size + mask) & ~mask;
+}
+
+bool checkFileHeader(const MappedFile& file, const char (&magic)[8], uint32_t& headerSize)
+{
+  BlobLogFileHeader header;
+  if (file.size() < sizeof(header))
+  {
+    return false;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  headerSize = littleEndianToNative(header.headerSize);
+  return (0 == std::memcmp(header.magic, magic, sizeof(header.magic))) &&
+         (littleEndianToNative(header.version) == BLOB_LOG_VERSION) &&
+         (headerSize >= sizeof(header)) && (headerSize <= file.size());
+}
+
+/// Reads the record header at the given offset of the log
+///
+/// \return true if there is a complete record
+bool readRecordHeader(const MappedFile& log, uint64_t offset, BlobLogRecordHeader& header)
+{
+  if ((offset + sizeof(header) > log.size()) || (0u != offset % BLOB_LOG_ALIGNMENT))
+  {
+    return false;
+  }
+  std::memcpy(&header, log.data() + offset, sizeof(header));
+  header.magic         = littleEndianToNative(header.magic);
+  header.length        = littleEndianToNative(header.length);
+  header.hostTimestamp = littleEndianToNative(header.hostTimestamp);
+  return (BLOB_LOG_RECORD_MAGIC == header.magic) &&
+         (offset + sizeof(header) + header.length <= log.size());
+}
+
+uint64_t getFrameNumberKey(const BlobLogIndexEntry& entry)
+{
+  return littleEndianToNative(entry.frameNumber);
+}
+
+uint64_t getHostTimestampKey(const BlobLogIndexEntry& entry)
+{
+  return littleEndianToNative(entry.hostTimestamp);
+}
+
+uint64_t getDeviceTimestampKey(const BlobLogIndexEntry& entry)
+{
+  return littleEndianToNative(entry.deviceTimestamp);
+}
+
+/// Binary search for the first entry whose key is not less than the given value
+bool lowerBound(const BlobLogIndexEntry* entries,
+                std::size_t numEntries,
+                uint64_t (*getKey)(const BlobLogIndexEntry&),
+                uint64_t value,
+                std::size_t& index)
+{
+  std::size_t first = 0u;
+  std::size_t count = numEntries;
+  while (count > 0u)
+  {
+    const std::size_t step = count / 2u;
+    if (getKey(entries[first + step]) < value)
+    {
+      first += step + 1u;
+      count -= step + 1u;
+    }
+    else
+    {
+      count = step;
+    }
+  }
+  index = first;
+  return first < numEntries;
+}
+
+/// Linear search for the entry with the smallest key not less than the given value, the first one
+/// in the log if several entries share it. Same result as lowerBound for non-decreasing keys.
+bool findClosest(const BlobLogIndexEntry* entries,
+                 std::size_t numEntries,
+                 uint64_t (*getKey)(const BlobLogIndexEntry&),
+                 uint64_t value,
+                 std::size_t& index)
+{
+  bool found = false;
+  uint64_t closestKey{0u};
+  for (std::size_t i = 0u; i < numEntries; ++i)
+  {
+    const uint64_t key = getKey(entries[i]);
+    if ((key >= value) && (!found || (key < closestKey)))
+    {
+      found      = true;
+      closestKey = key;
+      index      = i;
+    }
+  }
+  if (!found)
+  {
+    index = numEntries;
+  }
+  return found;
+}
+
+bool isNonDecreasing(const BlobLogIndexEntry* entries,
+                     std::size_t numEntries,
+                     uint64_t (*getKey)(const BlobLogIndexEntry&))
+{
+  for (std::size_t i = 1u; i < numEntries; ++i)
+  {
+    if (getKey(entries[i]) < getKey(entries[i - 1u]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+BlobLogReader::BlobLogReader()
+  : m_index(nullptr)
+  , m_numBlobs(0u)
+  , m_frameNumbersSorted(true)
+  , m_hostTimestampsSorted(true)
+  , m_deviceTimestampsSorted(true)
+{
+}
+
+BlobLogReader::~BlobLogReader() {}
+
+bool BlobLogReader::open(const std::string& fileName)
+{
+  close();
+
+  uint32_t logHeaderSize{0u};
+  if (!m_logFile.open(fileName) || !checkFileHeader(m_logFile, BLOB_LOG_MAGIC, logHeaderSize))
+  {
+    std::printf("%s is no Blob log\n", fileName.c_str());
+    close();
+    return false;
+  }
+
+  // use the mapped index as far as it is consistent with the log
+  uint32_t indexHeaderSize{0u};
+  uint64_t nextOffset = logHeaderSize;
+  if (m_indexFile.open(fileName + ".idx") &&
+      checkFileHeader(m_indexFile, BLOB_LOG_INDEX_MAGIC, indexHeaderSize) &&
+      (0u == indexHeaderSize % sizeof(uint64_t)))
+  {
+    m_index    = reinterpret_cast<const BlobLogIndexEntry*>(m_indexFile.data() + indexHeaderSize);
+    m_numBlobs = (m_indexFile.size() - indexHeaderSize) / sizeof(BlobLogIndexEntry);
+    // drop entries of records which did not make it into the log
+    BlobLogRecordHeader header;
+    while (m_numBlobs > 0u)
+    {
+      const uint64_t lastOffset = littleEndianToNative(m_index[m_numBlobs - 1u].offset);
+      if (readRecordHeader(m_logFile, lastOffset, header))
+      {
+        nextOffset = lastOffset + sizeof(header) + alignRecord(header.length);
+        break;
+      }
+      --m_numBlobs;
+    }
+  }
+  else
+  {
+    std::printf("Index of Blob log %s is missing, scanning the log\n", fileName.c_str());
+  }
+
+  BlobLogRecordHeader header;
+  if (readRecordHeader(m_logFile, nextOffset, header))
+  {
+    // the index misses records at the end of the log
+    m_rebuiltIndex.assign(m_index, m_index + m_numBlobs);
+    scanLog(nextOffset);
+    m_index    = m_rebuiltIndex.data();
+    m_numBlobs = m_rebuiltIndex.size();
+  }
+
+  // e.g. a device restart resets the frame numbers, the find functions then search linearly
+  m_frameNumbersSorted     = isNonDecreasing(m_index, m_numBlobs, &getFrameNumberKey);
+  m_hostTimestampsSorted   = isNonDecreasing(m_index, m_numBlobs, &getHostTimestampKey);
+  m_deviceTimestampsSorted = isNonDecreasing(m_index, m_numBlobs, &getDeviceTimestampKey);
+  if (!m_frameNumbersSorted || !m_hostTimestampsSorted || !m_deviceTimestampsSorted)
+  {
+    std::printf("Frame numbers or timestamps of Blob log %s decrease, seeking is slower\n",
+                fileName.c_str());
+  }
+  return true;
+}
+
+void BlobLogReader::close()
+{
+  m_logFile.close();
+  m_indexFile.close();
+  m_index                  = nullptr;
+  m_numBlobs               = 0u;
+  m_frameNumbersSorted     = true;
+  m_hostTimestampsSorted   = true;
+  m_deviceTimestampsSorted = true;
+  std::vector<BlobLogIndexEntry>().swap(m_rebuiltIndex);
+}
+
+std::size_t BlobLogReader::getNumBlobs() const
+{
+  return m_numBlobs;
+}
+
+BlobLogIndexEntry BlobLogReader::getIndexEntry(std::size_t index) const
+{
+  BlobLogIndexEntry entry = m_index[index];
+  entry.frameNumber       = littleEndianToNative(entry.frameNumber);
+  entry.length            = littleEndianToNative(entry.length);
+  entry.deviceTimestamp   = littleEndianToNative(entry.deviceTimestamp);
+  entry.hostTimestamp     = littleEndianToNative(entry.hostTimestamp);
+  entry.offset            = littleEndianToNative(entry.offset);
+  return entry;
+}
+
+bool BlobLogReader::getBlob(std::size_t index, const uint8_t*& data, std::size_t& size) const
+{
+  data = nullptr;
+  size = 0u;
+  if (index >= m_numBlobs)
+  {
+    return false;
+  }
+  const uint64_t offset = littleEndianToNative(m_index[index].offset);
+  BlobLogRecordHeader header;
+  if (!readRecordHeader(m_logFile, offset, header))
+  {
+    std::printf("Damaged record %zu in Blob log\n", index);
+    return false;
+  }
+  data = m_logFile.data() + offset + sizeof(header);
+  size = header.length;
+  return true;
+}
+
+bool BlobLogReader::findFrame(uint32_t frameNumber, std::size_t& index) const
+{
+  return m_frameNumbersSorted
+           ? lowerBound(m_index, m_numBlobs, &getFrameNumberKey, frameNumber, index)
+           : findClosest(m_index, m_numBlobs, &getFrameNumberKey, frameNumber, index);
+}
+
+bool BlobLogReader::findHostTimestamp(uint64_t hostTimestamp, std::size_t& index) const
+{
+  return m_hostTimestampsSorted
+           ? lowerBound(m_index, m_numBlobs, &getHostTimestampKey, hostTimestamp, index)
+           : findClosest(m_index, m_numBlobs, &getHostTimestampKey, hostTimestamp, index);
+}
+
+bool BlobLogReader::findDeviceTimestamp(uint64_t deviceTimestamp, std::size_t& index) const
+{
+  return m_deviceTimestampsSorted
+           ? lowerBound(m_index, m_numBlobs, &getDeviceTimestampKey, deviceTimestamp, index)
+           : findClosest(m_index, m_numBlobs, &getDeviceTimestampKey, deviceTimestamp, index);
+}
+
+void BlobLogReader::scanLog(uint64_t offset)
+{
+  BlobLogRecordHeader header;
+  while (readRecordHeader(m_logFile, offset, header))
+  {
+    const uint8_t* pBlob = m_logFile.data() + offset + sizeof(header);
+    BlobLogIndexEntry entry;
+    getBlobFrameInfo(pBlob, header.length, entry.frameNumber, entry.deviceTimestamp);
+    entry.frameNumber     = nativeToLittleEndian(entry.frameNumber);
+    entry.length          = nativeToLittleEndian(header.length);
+    entry.deviceTimestamp = nativeToLittleEndian(entry.deviceTimestamp);
+    entry.hostTimestamp   = nativeToLittleEndian(header.hostTimestamp);
+    entry.offset          = nativeToLittleEndian(offset);
+    m_rebuiltIndex.push_back(entry);
+
+    offset += sizeof(header) + alignRecord(header.length);
+  }
+}
+
+} // namespace visionary
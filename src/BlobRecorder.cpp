@@ -0,0 +1,370 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobRecorder.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace visionary {
+
+namespace {
+constexpr std::size_t DEFAULT_RING_BUFFER_SIZE = 64u * 1024u * 1024u;
+constexpr uint64_t DEFAULT_CHUNK_SIZE          = 64u * 1024u * 1024u;
+
+/// Time the writer thread sleeps at most when the ring buffer is empty
+constexpr std::chrono::milliseconds WRITER_IDLE_TIMEOUT(10);
+
+inline uint64_t alignRecord(uint64_t size)
+{
+  const uint64_t mask = BLOB_LOG_ALIGNMENT - 1u;
+  return (size + mask) & ~mask;
+}
+
+bool truncateFile(std::FILE* file, uint64_t size)
+{
+#ifdef _WIN32
+  return 0 == _chsize_s(_fileno(file), static_cast<__int64>(size));
+#else
+  return 0 == ftruncate(fileno(file), static_cast<off_t>(size));
+#endif
+}
+
+bool writeFileHeader(std::FILE* file, const char (&magic)[8])
+{
+  BlobLogFileHeader header;
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.version    = nativeToLittleEndian(BLOB_LOG_VERSION);
+  header.headerSize = nativeToLittleEndian(static_cast<uint32_t>(sizeof(header)));
+  return 1u == std::fwrite(&header, sizeof(header), 1u, file);
+}
+} // namespace
+
+BlobRecorder::BlobRecorder()
+  : m_ringBufferSize(DEFAULT_RING_BUFFER_SIZE)
+  , m_chunkSize(DEFAULT_CHUNK_SIZE)
+  , m_blockWhenFull(false)
+  , m_head(0u)
+  , m_tail(0u)
+  , m_logFile(nullptr)
+  , m_indexFile(nullptr)
+  , m_fileSize(0u)
+  , m_allocatedSize(0u)
+  , m_running(false)
+  , m_numRecorded(0u)
+  , m_numDropped(0u)
+  , m_numBytesWritten(0u)
+{
+}
+
+BlobRecorder::~BlobRecorder()
+{
+  close();
+}
+
+void BlobRecorder::setRingBufferSize(std::size_t numBytes)
+{
+  // a record may have to skip the end of the buffer, with room for two of the largest records
+  // every Blob fits once the writer has caught up
+  const uint64_t minSize = 2u * (sizeof(BlobLogRecordHeader) + alignRecord(BLOB_SIZE_MAX));
+  m_ringBufferSize = static_cast<std::size_t>(std::max<uint64_t>(alignRecord(numBytes), minSize));
+}
+
+void BlobRecorder::setChunkSize(uint64_t numBytes)
+{
+  m_chunkSize = numBytes;
+}
+
+void BlobRecorder::setBlockWhenFull(bool blockWhenFull)
+{
+  m_blockWhenFull = blockWhenFull;
+}
+
+void BlobRecorder::setClock(std::function<uint64_t()> clock)
+{
+  m_clock = clock;
+}
+
+bool BlobRecorder::open(const std::string& fileName)
+{
+  close();
+
+  m_logFile   = std::fopen(fileName.c_str(), "wb");
+  m_indexFile = std::fopen((fileName + ".idx").c_str(), "wb");
+  if ((nullptr == m_logFile) || (nullptr == m_indexFile) ||
+      !writeFileHeader(m_logFile, BLOB_LOG_MAGIC) ||
+      !writeFileHeader(m_indexFile, BLOB_LOG_INDEX_MAGIC))
+  {
+    std::printf("Could not create Blob log %s\n", fileName.c_str());
+    if (nullptr != m_logFile)
+    {
+      std::fclose(m_logFile);
+      m_logFile = nullptr;
+    }
+    if (nullptr != m_indexFile)
+    {
+      std::fclose(m_indexFile);
+      m_indexFile = nullptr;
+    }
+    return false;
+  }
+
+  m_fileSize      = sizeof(BlobLogFileHeader);
+  m_allocatedSize = m_fileSize;
+  reserveFileSize(m_fileSize);
+
+  m_ringBuffer.assign(m_ringBufferSize, 0u);
+  m_head.store(0u);
+  m_tail.store(0u);
+  m_numRecorded.store(0u);
+  m_numDropped.store(0u);
+  m_numBytesWritten.store(m_fileSize);
+
+  m_running.store(true);
+  m_writerThread = std::thread(&BlobRecorder::writerLoop, this);
+  return true;
+}
+
+void BlobRecorder::close()
+{
+  if (!m_writerThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.store(false);
+  }
+  m_wakeUp.notify_one();
+  m_writerThread.join();
+
+  // give back the unused part of the last extent
+  std::fflush(m_logFile);
+  truncateFile(m_logFile, m_fileSize);
+  std::fclose(m_logFile);
+  std::fclose(m_indexFile);
+  m_logFile   = nullptr;
+  m_indexFile = nullptr;
+  std::vector<uint8_t>().swap(m_ringBuffer);
+}
+
+bool BlobRecorder::isOpen() const
+{
+  return m_running.load(std::memory_order_relaxed);
+}
+
+bool BlobRecorder::record(const uint8_t* data, std::size_t size)
+{
+  if (!m_running.load(std::memory_order_relaxed))
+  {
+    return false;
+  }
+  const uint64_t hostTimestamp =
+    m_clock ? m_clock()
+            : static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::system_clock::now().time_since_epoch())
+                                      .count());
+
+  const uint64_t capacity   = m_ringBuffer.size();
+  const uint64_t recordSize = sizeof(BlobLogRecordHeader) + alignRecord(size);
+  const uint64_t head       = m_head.load(std::memory_order_relaxed);
+
+  // records are stored contiguously, skip the end of the buffer if the record does not fit
+  uint64_t position        = head % capacity;
+  const uint64_t skipBytes = (capacity - position < recordSize) ? capacity - position : 0u;
+  const bool fits          = (size <= UINT32_MAX) && (skipBytes + recordSize <= capacity);
+  while (fits && m_blockWhenFull && m_running.load(std::memory_order_relaxed) &&
+         (head - m_tail.load(std::memory_order_acquire) + skipBytes + recordSize > capacity))
+  {
+    m_wakeUp.notify_one();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  const uint64_t used = head - m_tail.load(std::memory_order_acquire);
+  if (!fits || (used + skipBytes + recordSize > capacity))
+  {
+    m_numDropped.fetch_add(1u, std::memory_order_relaxed);
+    return false;
+  }
+  if (skipBytes >= sizeof(BlobLogRecordHeader))
+  {
+    // mark the skipped bytes, the writer skips anything but a record header
+    std::memset(&m_ringBuffer[position], 0, sizeof(BlobLogRecordHeader));
+  }
+  position = (position + skipBytes) % capacity;
+
+  BlobLogRecordHeader header;
+  header.magic         = nativeToLittleEndian(BLOB_LOG_RECORD_MAGIC);
+  header.length        = nativeToLittleEndian(static_cast<uint32_t>(size));
+  header.hostTimestamp = nativeToLittleEndian(hostTimestamp);
+  uint8_t* pRecord     = &m_ringBuffer[position];
+  std::memcpy(pRecord, &header, sizeof(header));
+  std::memcpy(pRecord + sizeof(header), data, size);
+  std::memset(pRecord + sizeof(header) + size, 0, recordSize - sizeof(header) - size);
+
+  m_head.store(head + skipBytes + recordSize, std::memory_order_release);
+  m_numRecorded.fetch_add(1u, std::memory_order_relaxed);
+  m_wakeUp.notify_one();
+  return true;
+}
+
+uint64_t BlobRecorder::getNumRecorded() const
+{
+  return m_numRecorded.load(std::memory_order_relaxed);
+}
+
+uint64_t BlobRecorder::getNumDropped() const
+{
+  return m_numDropped.load(std::memory_order_relaxed);
+}
+
+uint64_t BlobRecorder::getNumBytesWritten() const
+{
+  return m_numBytesWritten.load(std::memory_order_relaxed);
+}
+
+void BlobRecorder::writerLoop()
+{
+  bool writeOk = true;
+  while (true)
+  {
+    const bool running = m_running.load();
+    if (!writePending() && writeOk)
+    {
+      std::printf("Writing to the Blob log failed, records are dropped\n");
+      writeOk = false;
+    }
+    if (!running)
+    {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // record() notifies without locking, the timeout catches a missed notification
+    m_wakeUp.wait_for(lock, WRITER_IDLE_TIMEOUT, [this]() {
+      return !m_running.load() || (m_head.load() != m_tail.load(std::memory_order_relaxed));
+    });
+  }
+}
+
+bool BlobRecorder::writePending()
+{
+  const uint64_t capacity = m_ringBuffer.size();
+  const uint64_t head     = m_head.load(std::memory_order_acquire);
+  uint64_t tail           = m_tail.load(std::memory_order_relaxed);
+  bool result             = true;
+
+  while (tail != head)
+  {
+    const uint64_t position = tail % capacity;
+    BlobLogRecordHeader header;
+    if (capacity - position >= sizeof(header))
+    {
+      std::memcpy(&header, &m_ringBuffer[position], sizeof(header));
+    }
+    if ((capacity - position < sizeof(header)) ||
+        (littleEndianToNative(header.magic) != BLOB_LOG_RECORD_MAGIC))
+    {
+      // skipped end of the ring buffer
+      tail += capacity - position;
+      continue;
+    }
+    const uint32_t length     = littleEndianToNative(header.length);
+    const uint64_t recordSize = sizeof(header) + alignRecord(length);
+    const uint8_t* pRecord    = &m_ringBuffer[position];
+
+    BlobLogIndexEntry entry;
+    getBlobFrameInfo(pRecord + sizeof(header), length, entry.frameNumber, entry.deviceTimestamp);
+    entry.frameNumber     = nativeToLittleEndian(entry.frameNumber);
+    entry.length          = header.length;
+    entry.deviceTimestamp = nativeToLittleEndian(entry.deviceTimestamp);
+    entry.hostTimestamp   = header.hostTimestamp;
+    entry.offset          = nativeToLittleEndian(m_fileSize);
+
+    reserveFileSize(m_fileSize + recordSize);
+    if (result && (1u == std::fwrite(pRecord, static_cast<std::size_t>(recordSize), 1u, m_logFile)))
+    {
+      m_fileSize += recordSize;
+      m_indexEntries.push_back(entry);
+    }
+    else
+    {
+      result = false;
+      m_numDropped.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    // hand the space back to record() as early as possible
+    tail += recordSize;
+    m_tail.store(tail, std::memory_order_release);
+  }
+  m_tail.store(tail, std::memory_order_release);
+
+  if (!m_indexEntries.empty())
+  {
+    result = result && (m_indexEntries.size() == std::fwrite(m_indexEntries.data(),
+                                                             sizeof(BlobLogIndexEntry),
+                                                             m_indexEntries.size(),
+                                                             m_indexFile));
+    m_indexEntries.clear();
+  }
+  // hand the data to the operating system, so a crash of the process does not lose it
+  result = (0 == std::fflush(m_logFile)) && result;
+  result = (0 == std::fflush(m_indexFile)) && result;
+  m_numBytesWritten.store(m_fileSize, std::memory_order_relaxed);
+  return result;
+}
+
+void BlobRecorder::reserveFileSize(uint64_t size)
+{
+  if ((0u == m_chunkSize) || (size <= m_allocatedSize))
+  {
+    return;
+  }
+  const uint64_t newSize = ((size + m_chunkSize - 1u) / m_chunkSize) * m_chunkSize;
+#ifdef _WIN32
+  // extending the file allocates the extent, the write position is not changed
+  std::fflush(m_logFile);
+  const bool allocated = truncateFile(m_logFile, newSize);
+#else
+  const bool allocated = 0 == posix_fallocate(fileno(m_logFile),
+                                              static_cast<off_t>(m_allocatedSize),
+                                              static_cast<off_t>(newSize - m_allocatedSize));
+#endif
+  if (allocated)
+  {
+    m_allocatedSize = newSize;
+  }
+  else
+  {
+    // the file system does not support preallocation, just append
+    m_chunkSize = 0u;
+  }
+}
+
+} // namespace visionary
@@ -0,0 +1,294 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/BlobReplayTransport.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace visionary {
+
+BlobReplayTransport::BlobReplayTransport(std::shared_ptr<BlobLogReader> reader, Mode mode)
+  : m_reader(reader)
+  , m_mode(mode)
+  , m_speed(1.)
+  , m_loop(false)
+  , m_dropProbability(0.)
+  , m_reorderProbability(0.)
+  , m_randomState(0x12345678u)
+  , m_nextBlob(0u)
+  , m_blobData(nullptr)
+  , m_blobSize(0u)
+  , m_blobTimestamp(0u)
+  , m_blobNumber(0u)
+  , m_nextPacket(0u)
+  , m_timingValid(false)
+  , m_firstTimestamp(0u)
+  , m_shutdown(false)
+  , m_numBlobsSent(0u)
+  , m_numFragmentsDropped(0u)
+  , m_numFragmentsReordered(0u)
+{
+}
+
+BlobReplayTransport::~BlobReplayTransport() {}
+
+void BlobReplayTransport::setSpeed(double speed)
+{
+  m_speed       = std::max(0., speed);
+  m_timingValid = false;
+}
+
+void BlobReplayTransport::setLoop(bool loop)
+{
+  m_loop = loop;
+}
+
+void BlobReplayTransport::seek(std::size_t index)
+{
+  m_nextBlob    = index;
+  m_nextPacket  = m_packets.size();
+  m_timingValid = false;
+}
+
+void BlobReplayTransport::setFragmentDropProbability(double probability)
+{
+  m_dropProbability = probability;
+}
+
+void BlobReplayTransport::setFragmentReorderProbability(double probability)
+{
+  m_reorderProbability = probability;
+}
+
+void BlobReplayTransport::setRandomSeed(uint32_t seed)
+{
+  // xorshift must not start with 0
+  m_randomState = (0u != seed) ? seed : 0x12345678u;
+}
+
+uint64_t BlobReplayTransport::getNumBlobsSent() const
+{
+  return m_numBlobsSent.load(std::memory_order_relaxed);
+}
+
+uint64_t BlobReplayTransport::getNumFragmentsDropped() const
+{
+  return m_numFragmentsDropped.load(std::memory_order_relaxed);
+}
+
+uint64_t BlobReplayTransport::getNumFragmentsReordered() const
+{
+  return m_numFragmentsReordered.load(std::memory_order_relaxed);
+}
+
+int BlobReplayTransport::send(const std::vector<std::uint8_t>& buffer)
+{
+  return static_cast<int>(buffer.size());
+}
+
+int BlobReplayTransport::recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive)
+{
+  while (m_nextPacket >= m_packets.size())
+  {
+    if (!nextBlob())
+    {
+      // end of the recording, like a closed connection
+      buffer.clear();
+      return 0;
+    }
+  }
+  return writePacket(buffer, maxBytesToReceive);
+}
+
+int BlobReplayTransport::read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive)
+{
+  std::vector<std::uint8_t> packet;
+  buffer.clear();
+  buffer.reserve(nBytesToReceive);
+  while (buffer.size() < nBytesToReceive)
+  {
+    const int receiveSize = recv(packet, nBytesToReceive - buffer.size());
+    if (receiveSize <= 0)
+    {
+      return -1;
+    }
+    buffer.insert(buffer.end(), packet.begin(), packet.begin() + receiveSize);
+  }
+  return static_cast<int>(buffer.size());
+}
+
+int BlobReplayTransport::shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+  }
+  m_shutdownSignal.notify_all();
+  return 0;
+}
+
+bool BlobReplayTransport::nextBlob()
+{
+  m_packets.clear();
+  m_nextPacket = 0u;
+
+  const BlobLogReader& reader = *m_reader;
+  if ((m_nextBlob >= reader.getNumBlobs()) && m_loop)
+  {
+    m_nextBlob    = 0u;
+    m_timingValid = false;
+  }
+  if (m_nextBlob >= reader.getNumBlobs())
+  {
+    return false;
+  }
+
+  const std::size_t index = m_nextBlob++;
+  if (!reader.getBlob(index, m_blobData, m_blobSize))
+  {
+    // skip damaged records, the caller asks for the next Blob
+    return true;
+  }
+  m_blobTimestamp = reader.getIndexEntry(index).hostTimestamp;
+
+  // wait until the Blob is due
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_timingValid)
+  {
+    m_replayStart    = std::chrono::steady_clock::now();
+    m_firstTimestamp = m_blobTimestamp;
+    m_timingValid    = true;
+  }
+  if ((m_speed > 0.) && (m_blobTimestamp > m_firstTimestamp))
+  {
+    const std::chrono::nanoseconds delay(
+      static_cast<int64_t>(static_cast<double>(m_blobTimestamp - m_firstTimestamp) / m_speed));
+    m_shutdownSignal.wait_until(lock, m_replayStart + delay, [this]() { return m_shutdown; });
+  }
+  if (m_shutdown)
+  {
+    return false;
+  }
+  lock.unlock();
+
+  buildPackets();
+  m_blobNumber++;
+  m_numBlobsSent.fetch_add(1u, std::memory_order_relaxed);
+  return true;
+}
+
+void BlobReplayTransport::buildPackets()
+{
+  if (Mode::TCP_STREAM == m_mode)
+  {
+    // the device sends the first bytes of the Blob header as separate packet
+    const std::size_t headerSize = std::min<std::size_t>(BLOB_HEADER_SIZE, m_blobSize);
+    for (std::size_t offset = 0u; offset < m_blobSize;)
+    {
+      const std::size_t length =
+        (0u == offset) ? headerSize : std::min(MAX_TCP_BLOB_PACKET_SIZE, m_blobSize - offset);
+      const Packet packet = {
+        static_cast<uint32_t>(offset), static_cast<uint32_t>(length), 0u, false};
+      m_packets.push_back(packet);
+      offset += length;
+    }
+    return;
+  }
+
+  uint16_t fragmentNumber = 0u;
+  for (std::size_t offset = 0u; offset < m_blobSize; offset += UDP_FRAGMENT_PAYLOAD_MAX)
+  {
+    const std::size_t length = std::min(UDP_FRAGMENT_PAYLOAD_MAX, m_blobSize - offset);
+    const bool isLast        = (offset + length == m_blobSize);
+    if ((m_dropProbability > 0.) && (nextRandom() < m_dropProbability))
+    {
+      m_numFragmentsDropped.fetch_add(1u, std::memory_order_relaxed);
+    }
+    else
+    {
+      m_packets.push_back(
+        {static_cast<uint32_t>(offset), static_cast<uint32_t>(length), fragmentNumber, isLast});
+    }
+    fragmentNumber++;
+  }
+
+  if (m_reorderProbability > 0.)
+  {
+    for (std::size_t i = 0u; i + 1u < m_packets.size(); i++)
+    {
+      if (nextRandom() < m_reorderProbability)
+      {
+        std::swap(m_packets[i], m_packets[i + 1u]);
+        m_numFragmentsReordered.fetch_add(1u, std::memory_order_relaxed);
+        i++;
+      }
+    }
+  }
+}
+
+int BlobReplayTransport::writePacket(std::vector<std::uint8_t>& buffer,
+                                     std::size_t maxBytesToReceive)
+{
+  Packet& packet = m_packets[m_nextPacket];
+
+  if (Mode::TCP_STREAM == m_mode)
+  {
+    // a stream may be read in smaller pieces than it has been sent
+    const std::size_t length = std::min<std::size_t>(packet.length, maxBytesToReceive);
+    buffer.resize(length);
+    std::memcpy(buffer.data(), m_blobData + packet.offset, length);
+    packet.offset += static_cast<uint32_t>(length);
+    packet.length -= static_cast<uint32_t>(length);
+    if (0u == packet.length)
+    {
+      m_nextPacket++;
+    }
+    return static_cast<int>(length);
+  }
+
+  buffer.resize(sizeof(UdpDataHeader) + packet.length + sizeof(uint32_t));
+  const std::size_t datagramSize = writeUdpFragment(buffer.data(),
+                                                    m_blobNumber,
+                                                    packet.fragmentNumber,
+                                                    static_cast<uint32_t>(m_blobTimestamp / 1000u),
+                                                    packet.isLastFragment,
+                                                    m_blobData + packet.offset,
+                                                    packet.length);
+  m_nextPacket++;
+
+  // like a datagram socket, the rest of a datagram which does not fit is discarded
+  const std::size_t receiveSize = std::min(datagramSize, maxBytesToReceive);
+  buffer.resize(receiveSize);
+  return static_cast<int>(receiveSize);
+}
+
+double BlobReplayTransport::nextRandom()
+{
+  // xorshift32
+  m_randomState ^= m_randomState << 13;
+  m_randomState ^= m_randomState >> 17;
+  m_randomState ^= m_randomState << 5;
+  return static_cast<double>(m_randomState) / 4294967296.;
+}
+
+} // namespace visionary
@@ -0,0 +1,307 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/ChangeDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace visionary {
+
+namespace {
+/// Weight of a new deviation in the learned noise
+constexpr float NOISE_LEARNING_RATE = 1.f / 16.f;
+
+inline bool isValid(uint16_t value)
+{
+  return value != 0 && value != uint16_t(0xFFFF);
+}
+} // namespace
+
+ChangeDetector::ChangeDetector(int tileSize)
+  : m_tileSize(std::max(1, tileSize))
+  , m_relativeThreshold(0.f)
+  , m_offsetThreshold(0.f)
+  , m_noiseFactor(4.f)
+  , m_collectChangedPixels(false)
+  , m_referenceMode(Reference::PREVIOUS)
+  , m_hasReference(false)
+  , m_width(0)
+  , m_height(0)
+  , m_tilesX(0)
+  , m_tilesY(0)
+{
+  setThreshold(0.01f, 0.01f);
+}
+
+ChangeDetector::~ChangeDetector() {}
+
+void ChangeDetector::setThreshold(float relative, float offset)
+{
+  m_relativeThreshold = relative;
+  m_offsetThreshold   = offset * 1000.f / SafeVisionaryData::DISTANCE_MAP_UNIT;
+}
+
+void ChangeDetector::setNoiseFactor(float factor)
+{
+  m_noiseFactor = factor;
+}
+
+void ChangeDetector::setCollectChangedPixels(bool collect)
+{
+  m_collectChangedPixels = collect;
+  m_changedPixels.clear();
+}
+
+void ChangeDetector::setReference(const std::vector<uint16_t>& distanceMap)
+{
+  m_referenceMode = Reference::FIXED;
+  m_reference     = distanceMap;
+  m_previous      = distanceMap;
+  m_noise.assign(distanceMap.size(), 0.f);
+  m_hasReference = true;
+}
+
+void ChangeDetector::usePreviousFrameAsReference()
+{
+  m_referenceMode = Reference::PREVIOUS;
+}
+
+void ChangeDetector::reset()
+{
+  m_hasReference = false;
+}
+
+std::size_t ChangeDetector::detect(const SafeVisionaryData& data)
+{
+  return detect(data.getDistanceMap(), data.getWidth(), data.getHeight());
+}
+
+std::size_t ChangeDetector::detect(const std::vector<uint16_t>& distanceMap, int width, int height)
+{
+  if ((width <= 0) || (height <= 0) ||
+      (distanceMap.size() != static_cast<std::size_t>(width) * height))
+  {
+    m_dirtyTiles.clear();
+    m_changedPixels.clear();
+    std::fill(m_dirtyTileBitmap.begin(), m_dirtyTileBitmap.end(), 0u);
+    return 0u;
+  }
+
+  if ((width != m_width) || (height != m_height))
+  {
+    m_width  = width;
+    m_height = height;
+    m_tilesX = (width + m_tileSize - 1) / m_tileSize;
+    m_tilesY = (height + m_tileSize - 1) / m_tileSize;
+
+    const std::size_t numTiles = static_cast<std::size_t>(m_tilesX) * m_tilesY;
+    m_dirtyTileBitmap.resize((numTiles + 63u) / 64u);
+    m_dirtyTiles.reserve(numTiles);
+  }
+  // checked on every frame, setReference accepts a map of any size
+  m_hasReference = m_hasReference && (m_reference.size() == distanceMap.size());
+  if (m_collectChangedPixels)
+  {
+    m_changedPixels.reserve(distanceMap.size());
+  }
+  m_dirtyTiles.clear();
+  m_changedPixels.clear();
+  std::fill(m_dirtyTileBitmap.begin(), m_dirtyTileBitmap.end(), 0u);
+
+  const uint16_t* map = distanceMap.data();
+  if (!m_hasReference)
+  {
+    // everything is new
+    m_reference = distanceMap;
+    m_previous  = distanceMap;
+    m_noise.assign(distanceMap.size(), 0.f);
+    m_hasReference = true;
+    for (uint32_t tile = 0u; tile < static_cast<uint32_t>(m_tilesX * m_tilesY); tile++)
+    {
+      m_dirtyTiles.push_back(tile);
+      m_dirtyTileBitmap[tile / 64u] |= uint64_t(1) << (tile % 64u);
+    }
+    if (m_collectChangedPixels)
+    {
+      for (uint32_t i = 0u; i < static_cast<uint32_t>(distanceMap.size()); i++)
+      {
+        m_changedPixels.push_back(i);
+      }
+    }
+    return m_dirtyTiles.size();
+  }
+
+  // Process the map row by row, so the changed pixels are collected in ascending order, and
+  // update the reference of a band of tiles after all its rows have been compared.
+  std::vector<uint64_t>::iterator itBitmap = m_dirtyTileBitmap.begin();
+  for (int tileY = 0; tileY < m_tilesY; tileY++)
+  {
+    const int rowBegin = tileY * m_tileSize;
+    const int rowEnd   = std::min(rowBegin + m_tileSize, m_height);
+    for (int row = rowBegin; row < rowEnd; row++)
+    {
+      for (int tileX = 0; tileX < m_tilesX; tileX++)
+      {
+        const int colBegin = tileX * m_tileSize;
+        const int colEnd   = std::min(colBegin + m_tileSize, m_width);
+        if (compareRow(map, row, colBegin, colEnd))
+        {
+          const uint32_t tile = static_cast<uint32_t>(tileY * m_tilesX + tileX);
+          itBitmap[tile / 64u] |= uint64_t(1) << (tile % 64u);
+        }
+      }
+    }
+
+    for (int tileX = 0; tileX < m_tilesX; tileX++)
+    {
+      const uint32_t tile = static_cast<uint32_t>(tileY * m_tilesX + tileX);
+      if ((itBitmap[tile / 64u] & (uint64_t(1) << (tile % 64u))) == 0u)
+      {
+        continue;
+      }
+      m_dirtyTiles.push_back(tile);
+      if (Reference::PREVIOUS == m_referenceMode)
+      {
+        const int colBegin = tileX * m_tileSize;
+        const int colEnd   = std::min(colBegin + m_tileSize, m_width);
+        updateReference(map, colBegin, rowBegin, colEnd, rowEnd);
+      }
+    }
+  }
+  return m_dirtyTiles.size();
+}
+
+bool ChangeDetector::compareRow(const uint16_t* map, int row, int colBegin, int colEnd)
+{
+  const std::size_t rowOffset = static_cast<std::size_t>(row) * m_width;
+  const uint16_t* itMap       = map + rowOffset;
+  const uint16_t* itReference = m_reference.data() + rowOffset;
+  uint16_t* itPrevious        = m_previous.data() + rowOffset;
+  float* itNoise              = m_noise.data() + rowOffset;
+
+  bool changed = false;
+  for (int col = colBegin; col < colEnd; col++)
+  {
+    const uint16_t value     = itMap[col];
+    const uint16_t reference = itReference[col];
+    const bool valid         = isValid(value);
+    bool pixelChanged        = (valid != isValid(reference));
+    if (valid && !pixelChanged)
+    {
+      const float deviation = std::fabs(static_cast<float>(value) - static_cast<float>(reference));
+      const float threshold = std::max(m_offsetThreshold + m_relativeThreshold * reference,
+                                       m_noiseFactor * itNoise[col]);
+      pixelChanged = deviation > threshold;
+
+      // learn from consecutive frames, a deviation from the reference may be a slow drift
+      const uint16_t previous = itPrevious[col];
+      if (!pixelChanged && isValid(previous))
+      {
+        const float difference =
+          std::fabs(static_cast<float>(value) - static_cast<float>(previous));
+        itNoise[col] += (difference - itNoise[col]) * NOISE_LEARNING_RATE;
+      }
+    }
+    itPrevious[col] = value;
+
+    if (pixelChanged)
+    {
+      changed = true;
+      if (m_collectChangedPixels)
+      {
+        m_changedPixels.push_back(static_cast<uint32_t>(rowOffset + col));
+      }
+    }
+  }
+  return changed;
+}
+
+void ChangeDetector::updateReference(
+  const uint16_t* map, int colBegin, int rowBegin, int colEnd, int rowEnd)
+{
+  for (int row = rowBegin; row < rowEnd; row++)
+  {
+    const std::size_t offset = static_cast<std::size_t>(row) * m_width + colBegin;
+    std::memcpy(m_reference.data() + offset, map + offset, (colEnd - colBegin) * sizeof(uint16_t));
+  }
+}
+
+void ChangeDetector::updatePointCloud(SafeVisionaryData& data,
+                                      std::vector<PointXYZ>& pointCloud) const
+{
+  if (pointCloud.size() != data.getDistanceMap().size())
+  {
+    data.generatePointCloud(pointCloud);
+    return;
+  }
+  for (std::vector<uint32_t>::const_iterator it = m_dirtyTiles.begin(); it != m_dirtyTiles.end();
+       ++it)
+  {
+    const int colBegin = static_cast<int>(*it % m_tilesX) * m_tileSize;
+    const int rowBegin = static_cast<int>(*it / m_tilesX) * m_tileSize;
+    data.generatePointCloudRegion(
+      pointCloud, colBegin, rowBegin, colBegin + m_tileSize, rowBegin + m_tileSize);
+  }
+}
+
+const std::vector<uint64_t>& ChangeDetector::getDirtyTileBitmap() const
+{
+  return m_dirtyTileBitmap;
+}
+
+const std::vector<uint32_t>& ChangeDetector::getDirtyTiles() const
+{
+  return m_dirtyTiles;
+}
+
+const std::vector<uint32_t>& ChangeDetector::getChangedPixels() const
+{
+  return m_changedPixels;
+}
+
+bool ChangeDetector::isTileDirty(int tileX, int tileY) const
+{
+  if ((tileX < 0) || (tileX >= m_tilesX) || (tileY < 0) || (tileY >= m_tilesY))
+  {
+    return false;
+  }
+  const uint32_t tile = static_cast<uint32_t>(tileY * m_tilesX + tileX);
+  return (m_dirtyTileBitmap[tile / 64u] & (uint64_t(1) << (tile % 64u))) != 0u;
+}
+
+int ChangeDetector::getTileSize() const
+{
+  return m_tileSize;
+}
+
+int ChangeDetector::getTilesX() const
+{
+  return m_tilesX;
+}
+
+int ChangeDetector::getTilesY() const
+{
+  return m_tilesY;
+}
+
+} // namespace visionary
@@ -0,0 +1,532 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/CoLa2Emulator.h"
+#include "sick_safevisionary_base/CoLaParameterWriter.h"
+#include "sick_safevisionary_base/SHA256.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace visionary {
+
+namespace {
+/// Size of the CoLa2 header after magic bytes and length: HubCntr, NoC, SessionID and ReqID
+constexpr std::size_t COLA2_HEADER_SIZE = 8u;
+
+/// Requests larger than this are considered a broken stream
+constexpr uint32_t COLA2_REQUEST_SIZE_MAX = 1024u * 1024u;
+
+/// Results of GetChallenge and SetUserLevel, see AuthenticationSecure
+enum class ChallengeResponseResult : std::uint8_t
+{
+  SUCCESS           = 0u,
+  INVALID_CLIENT    = 1u,
+  NOT_ACCEPTED      = 2u,
+  UNKNOWN_CHALLENGE = 3u
+};
+
+const char* getPasswordPrefix(IAuthentication::UserLevel userLevel)
+{
+  switch (userLevel)
+  {
+    case IAuthentication::UserLevel::RUN:
+      return "Run";
+    case IAuthentication::UserLevel::OPERATOR:
+      return "Operator";
+    case IAuthentication::UserLevel::MAINTENANCE:
+      return "Maintenance";
+    case IAuthentication::UserLevel::AUTHORIZED_CLIENT:
+      return "AuthorizedClient";
+    case IAuthentication::UserLevel::SERVICE:
+      return "Service";
+    default:
+      return nullptr;
+  }
+}
+
+/// Appends the response to a command without the leading 's', which is not used in CoLa2
+void appendCommand(const CoLaCommand& command, std::vector<uint8_t>& response)
+{
+  std::vector<uint8_t> buffer = CoLaCommand(command).getBuffer();
+  response.insert(response.end(), buffer.begin() + 1, buffer.end());
+}
+
+void appendError(CoLaError::Enum error, std::vector<uint8_t>& response)
+{
+  const uint16_t errorCode = nativeToColaByteOrder(static_cast<uint16_t>(error));
+  response.push_back('F');
+  response.push_back('A');
+  response.insert(response.end(),
+                  reinterpret_cast<const uint8_t*>(&errorCode),
+                  reinterpret_cast<const uint8_t*>(&errorCode) + sizeof(errorCode));
+}
+} // namespace
+
+CoLa2Emulator::CoLa2Emulator()
+  : m_port(2122u)
+  , m_running(false)
+  , m_clientConnected(false)
+  , m_responseDelay(0)
+  , m_sessionId(0u)
+  , m_userLevel(IAuthentication::UserLevel::RUN)
+  , m_challengeValid(false)
+  , m_challengeUserLevel(IAuthentication::UserLevel::RUN)
+  , m_challenge()
+  , m_salt()
+  , m_randomState(static_cast<uint32_t>(
+                    std::chrono::steady_clock::now().time_since_epoch().count()) |
+                  1u)
+  , m_numRequests(0u)
+  , m_numSessions(0u)
+{
+  // flex string: length and characters
+  const std::string deviceIdent = "safeVisionary2 Emulator";
+  std::vector<uint8_t> value(sizeof(uint16_t) + deviceIdent.size());
+  const uint16_t length = nativeToColaByteOrder(static_cast<uint16_t>(deviceIdent.size()));
+  std::memcpy(value.data(), &length, sizeof(length));
+  std::memcpy(value.data() + sizeof(length), deviceIdent.data(), deviceIdent.size());
+  setVariable("DeviceIdent", value, false);
+
+  for (uint8_t& byte : m_salt)
+  {
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    byte = static_cast<uint8_t>(m_randomState);
+  }
+
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  setMethod("GetChallenge", std::bind(&CoLa2Emulator::methodGetChallenge, this, _1, _2));
+  setMethod("SetUserLevel", std::bind(&CoLa2Emulator::methodSetUserLevel, this, _1, _2));
+  setMethod("Run", std::bind(&CoLa2Emulator::methodRun, this, _1, _2));
+}
+
+CoLa2Emulator::~CoLa2Emulator()
+{
+  stop();
+}
+
+void CoLa2Emulator::setPort(uint16_t port)
+{
+  m_port = port;
+}
+
+void CoLa2Emulator::setResponseDelay(std::chrono::microseconds delay)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_responseDelay = delay;
+}
+
+void CoLa2Emulator::setResponseDelay(const std::string& name, std::chrono::microseconds delay)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_responseDelays[name] = delay;
+}
+
+void CoLa2Emulator::setVariable(const std::string& name,
+                                const std::vector<uint8_t>& value,
+                                bool writable)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Variable& variable = m_variables[name];
+  variable.value     = value;
+  variable.writable  = writable;
+}
+
+bool CoLa2Emulator::getVariable(const std::string& name, std::vector<uint8_t>& value) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_variables.find(name);
+  if (it == m_variables.end())
+  {
+    return false;
+  }
+  value = it->second.value;
+  return true;
+}
+
+void CoLa2Emulator::setMethod(const std::string& name, MethodHandler handler)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_methods[name] = handler;
+}
+
+void CoLa2Emulator::setPassword(IAuthentication::UserLevel userLevel, const std::string& password)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_passwords[userLevel] = password;
+}
+
+uint64_t CoLa2Emulator::getNumRequests() const
+{
+  return m_numRequests;
+}
+
+uint64_t CoLa2Emulator::getNumSessions() const
+{
+  return m_numSessions;
+}
+
+IAuthentication::UserLevel CoLa2Emulator::getUserLevel() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_userLevel;
+}
+
+bool CoLa2Emulator::start()
+{
+  if (m_thread.joinable())
+  {
+    return false;
+  }
+  if (m_socket.openServer(htons(m_port)) != 0)
+  {
+    std::printf("Failed to listen on TCP port %u\n", static_cast<unsigned int>(m_port));
+    m_socket.shutdown();
+    return false;
+  }
+
+  m_running = true;
+  m_thread  = std::thread(&CoLa2Emulator::runServer, this);
+  return true;
+}
+
+void CoLa2Emulator::stop()
+{
+  if (!m_thread.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    if (m_clientConnected)
+    {
+      m_socket.shutdownConnection();
+    }
+  }
+
+  // the thread may wait for a client, connect to let the accept call return
+  TcpSocket wakeUp;
+  wakeUp.connect("127.0.0.1", htons(m_port));
+  wakeUp.shutdown();
+
+  m_thread.join();
+  m_socket.shutdown();
+}
+
+void CoLa2Emulator::runServer()
+{
+  while (true)
+  {
+    const bool connected = m_socket.WaitForConnection();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_running)
+      {
+        m_socket.closeConnection();
+        return;
+      }
+      if (!connected)
+      {
+        continue;
+      }
+      m_clientConnected = true;
+      m_sessionId       = 0u;
+      m_userLevel       = IAuthentication::UserLevel::RUN;
+      m_challengeValid  = false;
+    }
+
+    serveClient();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clientConnected = false;
+    m_socket.closeConnection();
+    if (!m_running)
+    {
+      return;
+    }
+  }
+}
+
+void CoLa2Emulator::serveClient()
+{
+  const std::vector<uint8_t> magicBytes = {0x02, 0x02, 0x02, 0x02};
+  std::vector<uint8_t> buffer;
+  std::vector<uint8_t> response;
+
+  while (true)
+  {
+    if ((m_socket.read(buffer, magicBytes.size()) < 0) || (buffer != magicBytes))
+    {
+      return;
+    }
+    if (m_socket.read(buffer, sizeof(uint32_t)) < 0)
+    {
+      return;
+    }
+    const uint32_t length = readUnalignBigEndian<uint32_t>(buffer.data());
+    if ((length < COLA2_HEADER_SIZE) || (length > COLA2_REQUEST_SIZE_MAX) ||
+        (m_socket.read(buffer, length) < 0))
+    {
+      return;
+    }
+
+    response.assign(magicBytes.begin(), magicBytes.end());
+    response.insert(response.end(), sizeof(uint32_t), 0u);
+    const std::string name = handleRequest(buffer, response);
+    writeUnalignBigEndian<uint32_t>(&response[sizeof(uint32_t)],
+                                    static_cast<uint32_t>(response.size() - 2u * sizeof(uint32_t)));
+
+    std::chrono::microseconds delay;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto it = m_responseDelays.find(name);
+      delay         = (it != m_responseDelays.end()) ? it->second : m_responseDelay;
+    }
+    if (delay.count() > 0)
+    {
+      std::this_thread::sleep_for(delay);
+    }
+
+    if (m_socket.send(response) != static_cast<int>(response.size()))
+    {
+      return;
+    }
+    m_numRequests++;
+  }
+}
+
+std::string CoLa2Emulator::handleRequest(const std::vector<uint8_t>& request,
+                                         std::vector<uint8_t>& response)
+{
+  // echo HubCntr, NoC and ReqID, the session ID is assigned when a session is opened
+  response.insert(response.end(), request.begin(), request.begin() + COLA2_HEADER_SIZE);
+  uint8_t* const responseHeader = &response[response.size() - COLA2_HEADER_SIZE];
+
+  if ((request.size() >= COLA2_HEADER_SIZE + 2u) && (request[COLA2_HEADER_SIZE] == 'O') &&
+      (request[COLA2_HEADER_SIZE + 1u] == 'x'))
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_sessionId++;
+      writeUnalignBigEndian<uint32_t>(responseHeader + 2u, m_sessionId);
+    }
+    m_numSessions++;
+    response.push_back('O');
+    response.push_back('A');
+    return "";
+  }
+  if ((request.size() >= COLA2_HEADER_SIZE + 2u) && (request[COLA2_HEADER_SIZE] == 'C') &&
+      (request[COLA2_HEADER_SIZE + 1u] == 'X'))
+  {
+    response.push_back('C');
+    response.push_back('A');
+    return "";
+  }
+
+  // the remaining commands are CoLa commands without the leading 's'
+  std::vector<uint8_t> buffer(1u, 's');
+  buffer.insert(buffer.end(), request.begin() + COLA2_HEADER_SIZE, request.end());
+  CoLaCommand command(buffer);
+  handleCommand(command, response);
+  return command.getName();
+}
+
+void CoLa2Emulator::handleCommand(CoLaCommand& command, std::vector<uint8_t>& response)
+{
+  const std::string name             = command.getName();
+  const std::vector<uint8_t>& buffer = command.getBuffer();
+  std::vector<uint8_t> parameters;
+  if (command.getParameterOffset() > 0u)
+  {
+    parameters.assign(buffer.begin() + command.getParameterOffset(), buffer.end());
+  }
+
+  switch (command.getType())
+  {
+    case CoLaCommandType::READ_VARIABLE: {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto it = m_variables.find(name);
+      if (it == m_variables.end())
+      {
+        appendError(CoLaError::VARIABLE_UNKNOWN_INDEX, response);
+        return;
+      }
+      appendCommand(
+        CoLaParameterWriter(CoLaCommandType::READ_VARIABLE_RESPONSE, name.c_str()).build(),
+        response);
+      response.insert(response.end(), it->second.value.begin(), it->second.value.end());
+      return;
+    }
+    case CoLaCommandType::WRITE_VARIABLE: {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto it = m_variables.find(name);
+      if (it == m_variables.end())
+      {
+        appendError(CoLaError::VARIABLE_UNKNOWN_INDEX, response);
+        return;
+      }
+      if (!it->second.writable)
+      {
+        appendError(CoLaError::VARIABLE_WRITE_ACCESS_DENIED, response);
+        return;
+      }
+      it->second.value = parameters;
+      appendCommand(
+        CoLaParameterWriter(CoLaCommandType::WRITE_VARIABLE_RESPONSE, name.c_str()).build(),
+        response);
+      return;
+    }
+    case CoLaCommandType::METHOD_INVOCATION: {
+      MethodHandler handler;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_methods.find(name);
+        if (it != m_methods.end())
+        {
+          handler = it->second;
+        }
+      }
+      if (!handler)
+      {
+        appendError(CoLaError::METHOD_IN_UNKNOWN_INDEX, response);
+        return;
+      }
+
+      // the handler is called without lock, it may access the emulator
+      std::vector<uint8_t> returnValues;
+      const CoLaError::Enum error = handler(parameters, returnValues);
+      if (error != CoLaError::OK)
+      {
+        appendError(error, response);
+        return;
+      }
+      appendCommand(
+        CoLaParameterWriter(CoLaCommandType::METHOD_RETURN_VALUE, name.c_str()).build(),
+        response);
+      response.insert(response.end(), returnValues.begin(), returnValues.end());
+      return;
+    }
+    default:
+      appendError(CoLaError::UNKNOWN_COLA_COMMAND, response);
+      return;
+  }
+}
+
+CoLaError::Enum CoLa2Emulator::methodGetChallenge(const std::vector<uint8_t>& parameters,
+                                                  std::vector<uint8_t>& returnValues)
+{
+  if (parameters.size() < sizeof(uint8_t))
+  {
+    return CoLaError::BUFFER_UNDERFLOW;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (uint8_t& byte : m_challenge)
+  {
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    byte = static_cast<uint8_t>(m_randomState);
+  }
+  m_challengeValid     = true;
+  m_challengeUserLevel = static_cast<IAuthentication::UserLevel>(parameters[0]);
+
+  returnValues.push_back(static_cast<uint8_t>(ChallengeResponseResult::SUCCESS));
+  returnValues.insert(returnValues.end(), m_challenge.begin(), m_challenge.end());
+  returnValues.insert(returnValues.end(), m_salt.begin(), m_salt.end());
+  return CoLaError::OK;
+}
+
+CoLaError::Enum CoLa2Emulator::methodSetUserLevel(const std::vector<uint8_t>& parameters,
+                                                  std::vector<uint8_t>& returnValues)
+{
+  std::array<uint8_t, 32> challengeResponse;
+  if (parameters.size() < challengeResponse.size() + sizeof(uint8_t))
+  {
+    return CoLaError::BUFFER_UNDERFLOW;
+  }
+  std::copy(parameters.begin(),
+            parameters.begin() + challengeResponse.size(),
+            challengeResponse.begin());
+  const IAuthentication::UserLevel userLevel =
+    static_cast<IAuthentication::UserLevel>(parameters[challengeResponse.size()]);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const bool challengeValid = m_challengeValid && (m_challengeUserLevel == userLevel);
+  m_challengeValid          = false;
+  if (!challengeValid)
+  {
+    returnValues.push_back(static_cast<uint8_t>(ChallengeResponseResult::UNKNOWN_CHALLENGE));
+    return CoLaError::OK;
+  }
+
+  const auto password      = m_passwords.find(userLevel);
+  const char* const prefix = getPasswordPrefix(userLevel);
+  if ((password == m_passwords.end()) || (nullptr == prefix))
+  {
+    returnValues.push_back(static_cast<uint8_t>(ChallengeResponseResult::NOT_ACCEPTED));
+    return CoLaError::OK;
+  }
+
+  // expected response: SHA256(SHA256("<level>:SICK Sensor:<password>:" salt) challenge)
+  const std::string passwordWithPrefix =
+    std::string(prefix) + ":SICK Sensor:" + password->second + ":";
+  std::array<uint8_t, 32> passwordHash;
+  hash_state hashState{};
+  sha256_init(&hashState);
+  sha256_process(&hashState,
+                 reinterpret_cast<const uint8_t*>(passwordWithPrefix.c_str()),
+                 static_cast<std::uint32_t>(passwordWithPrefix.size()));
+  sha256_process(&hashState, m_salt.data(), static_cast<std::uint32_t>(m_salt.size()));
+  sha256_done(&hashState, passwordHash.data());
+
+  std::array<uint8_t, 32> expectedResponse;
+  sha256_init(&hashState);
+  sha256_process(&hashState, passwordHash.data(), static_cast<std::uint32_t>(passwordHash.size()));
+  sha256_process(&hashState, m_challenge.data(), static_cast<std::uint32_t>(m_challenge.size()));
+  sha256_done(&hashState, expectedResponse.data());
+
+  if (expectedResponse != challengeResponse)
+  {
+    returnValues.push_back(static_cast<uint8_t>(ChallengeResponseResult::NOT_ACCEPTED));
+    return CoLaError::OK;
+  }
+  m_userLevel = userLevel;
+  returnValues.push_back(static_cast<uint8_t>(ChallengeResponseResult::SUCCESS));
+  return CoLaError::OK;
+}
+
+CoLaError::Enum CoLa2Emulator::methodRun(const std::vector<uint8_t>& /*parameters*/,
+                                         std::vector<uint8_t>& returnValues)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_userLevel = IAuthentication::UserLevel::RUN;
+  returnValues.push_back(1u);
+  return CoLaError::OK;
+}
+
+} // namespace visionary
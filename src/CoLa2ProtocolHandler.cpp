@@ -63,21 +63,9 @@ bool CoLa2ProtocolHandler::openSession(uint8_t sessionTimeout /*secs*/)
   // get response
   //
 
-  m_rTransport.read(buffer, sizeof(uint32_t));
-  // check for magic bytes
-  const std::vector<uint8_t> MagicBytes = {0x02, 0x02, 0x02, 0x02};
-  bool result = std::equal(MagicBytes.begin(), MagicBytes.end(), buffer.begin());
-  if (result)
-  {
-    // get length
-    m_rTransport.read(buffer, sizeof(uint32_t));
-    const uint32_t length = readUnalignBigEndian<uint32_t>(buffer.data());
-    m_rTransport.read(buffer, length);
-  }
-  else
+  if (!receiveResponse(buffer))
   {
-    // drop invalid data
-    buffer.clear();
+    return false;
   }
   CoLaCommand response(buffer);
 
@@ -158,26 +146,41 @@ CoLaCommand CoLa2ProtocolHandler::send(CoLaCommand cmd)
   // get response
   //
 
-  m_rTransport.read(buffer, sizeof(uint32_t));
+  if (!receiveResponse(buffer))
+  {
+    return CoLaCommand::networkErrorCommand();
+  }
+  buffer.erase(buffer.begin(), buffer.begin() + 8); // drop header
+  buffer.insert(buffer.begin(), 's');               // insert 's'
+  CoLaCommand response(buffer);
+  return response;
+}
+
+bool CoLa2ProtocolHandler::receiveResponse(std::vector<std::uint8_t>& buffer)
+{
   // check for magic bytes
   const std::vector<uint8_t> MagicBytes = {0x02, 0x02, 0x02, 0x02};
-  bool result = std::equal(MagicBytes.begin(), MagicBytes.end(), buffer.begin());
-  if (result)
+  if ((m_rTransport.read(buffer, sizeof(uint32_t)) < 0) ||
+      !std::equal(MagicBytes.begin(), MagicBytes.end(), buffer.begin()))
   {
-    // get length
-    m_rTransport.read(buffer, sizeof(uint32_t));
-    const uint32_t length = readUnalignBigEndian<uint32_t>(buffer.data());
-    m_rTransport.read(buffer, length);
+    // connection closed or invalid data
+    buffer.clear();
+    return false;
   }
-  else
+
+  // get length, the response contains at least the CoLa2 header
+  if (m_rTransport.read(buffer, sizeof(uint32_t)) < 0)
   {
-    // drop invalid data
     buffer.clear();
+    return false;
   }
-  buffer.erase(buffer.begin(), buffer.begin() + 8); // drop header
-  buffer.insert(buffer.begin(), 's');               // insert 's'
-  CoLaCommand response(buffer);
-  return response;
+  const uint32_t length = readUnalignBigEndian<uint32_t>(buffer.data());
+  if ((length < 8u) || (m_rTransport.read(buffer, length) < 0))
+  {
+    buffer.clear();
+    return false;
+  }
+  return true;
 }
 
 uint8_t CoLa2ProtocolHandler::calculateChecksum(const std::vector<uint8_t>& buffer)
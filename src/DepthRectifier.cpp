@@ -0,0 +1,291 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/DepthRectifier.h"
+#include "sick_safevisionary_base/ParallelRows.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visionary {
+
+namespace {
+/// Number of fixed point iterations to invert the distortion model
+constexpr int UNDISTORT_ITERATIONS = 20;
+
+inline bool isValid(uint16_t value)
+{
+  return value != 0 && value != uint16_t(0xFFFF);
+}
+
+bool isSameCamera(const CameraParameters& a, const CameraParameters& b)
+{
+  return (a.width == b.width) && (a.height == b.height) && (a.fx == b.fx) && (a.fy == b.fy) &&
+         (a.cx == b.cx) && (a.cy == b.cy) && (a.k1 == b.k1) && (a.k2 == b.k2) && (a.p1 == b.p1) &&
+         (a.p2 == b.p2) && (a.k3 == b.k3) && (a.f2rc == b.f2rc);
+}
+} // namespace
+
+DepthRectifier::DepthRectifier()
+  : m_interpolation(Interpolation::NEAREST)
+  , m_depthType(DepthType::RADIAL)
+  , m_numThreads(1u)
+  , m_cameraParams()
+  , m_tablesValid(false)
+  , m_f2rc(0u)
+{
+}
+
+DepthRectifier::~DepthRectifier() {}
+
+void DepthRectifier::setInterpolation(Interpolation interpolation)
+{
+  m_interpolation = interpolation;
+}
+
+void DepthRectifier::setDepthType(DepthType depthType)
+{
+  m_depthType = depthType;
+}
+
+void DepthRectifier::setNumThreads(unsigned numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+bool DepthRectifier::update(const CameraParameters& cameraParams)
+{
+  if (m_tablesValid && isSameCamera(cameraParams, m_cameraParams))
+  {
+    return true;
+  }
+  m_tablesValid  = false;
+  m_cameraParams = cameraParams;
+
+  const int width  = cameraParams.width;
+  const int height = cameraParams.height;
+  if ((width <= 0) || (height <= 0) || (cameraParams.fx == 0.) || (cameraParams.fy == 0.))
+  {
+    return false;
+  }
+
+  m_remapTable.resize(static_cast<size_t>(width) * height);
+  m_planarFactor.resize(m_remapTable.size());
+  m_f2rc = static_cast<uint32_t>(
+    std::max(0., std::round(cameraParams.f2rc / SafeVisionaryData::DISTANCE_MAP_UNIT)));
+
+  const double k1 = cameraParams.k1;
+  const double k2 = cameraParams.k2;
+  const double k3 = cameraParams.k3;
+  const double p1 = cameraParams.p1;
+  const double p2 = cameraParams.p2;
+
+  std::vector<RemapEntry>::iterator itEntry = m_remapTable.begin();
+  std::vector<uint32_t>::iterator itFactor  = m_planarFactor.begin();
+  for (int row = 0; row < height; row++)
+  {
+    for (int col = 0; col < width; col++, ++itEntry, ++itFactor)
+    {
+      // undistorted position of the rectified pixel, same convention as the point cloud
+      const double xu = (cameraParams.cx - col) / cameraParams.fx;
+      const double yu = (cameraParams.cy - row) / cameraParams.fy;
+
+      // invert the distortion model by fixed point iteration
+      double xd = xu;
+      double yd = yu;
+      for (int i = 0; i < UNDISTORT_ITERATIONS; i++)
+      {
+        const double r2 = xd * xd + yd * yd;
+        const double k  = 1. + r2 * (k1 + r2 * (k2 + r2 * k3));
+        const double dx = 2. * p1 * xd * yd + p2 * (r2 + 2. * xd * xd);
+        const double dy = p1 * (r2 + 2. * yd * yd) + 2. * p2 * xd * yd;
+        xd              = (xu - dx) / k;
+        yd              = (yu - dy) / k;
+      }
+      const double srcCol = cameraParams.cx - xd * cameraParams.fx;
+      const double srcRow = cameraParams.cy - yd * cameraParams.fy;
+
+      RemapEntry entry = {-1, -1, 0u, 0u, 0u, 0u};
+      const double nearestCol = std::floor(srcCol + 0.5);
+      const double nearestRow = std::floor(srcRow + 0.5);
+      if ((nearestCol >= 0.) && (nearestCol < width) && (nearestRow >= 0.) && (nearestRow < height))
+      {
+        entry.index = static_cast<int32_t>(nearestRow) * width + static_cast<int32_t>(nearestCol);
+
+        // upper left source pixel and weights, clamped to the image
+        const double clampedCol = std::max(0., std::min(srcCol, width - 1.));
+        const double clampedRow = std::max(0., std::min(srcRow, height - 1.));
+        int col0                = static_cast<int>(clampedCol);
+        int row0                = static_cast<int>(clampedRow);
+        int weightX             = static_cast<int>(std::round((clampedCol - col0) * 256.));
+        int weightY             = static_cast<int>(std::round((clampedRow - row0) * 256.));
+        if (weightX == 256)
+        {
+          ++col0;
+          weightX = 0;
+        }
+        if (weightY == 256)
+        {
+          ++row0;
+          weightY = 0;
+        }
+        entry.index00 = row0 * width + col0;
+        entry.weightX = static_cast<uint8_t>(weightX);
+        entry.weightY = static_cast<uint8_t>(weightY);
+        entry.stepX   = (col0 + 1 < width) ? 1u : 0u;
+        entry.stepY   = (row0 + 1 < height) ? 1u : 0u;
+      }
+      *itEntry = entry;
+
+      // the ray through the rectified pixel has the direction (xu, yu, 1)
+      *itFactor =
+        static_cast<uint32_t>(std::round(65536. / std::sqrt(1. + xu * xu + yu * yu)));
+    }
+  }
+  m_tablesValid = true;
+  return true;
+}
+
+bool DepthRectifier::rectify(const SafeVisionaryData& data,
+                             std::vector<uint16_t>& distanceMap,
+                             std::vector<uint16_t>& intensityMap,
+                             std::vector<uint8_t>& stateMap)
+{
+  if (!update(data.getCameraParameters()))
+  {
+    return false;
+  }
+  return rectifyDistanceMap(data.getDistanceMap(), distanceMap) &&
+         rectifyIntensityMap(data.getIntensityMap(), intensityMap) &&
+         rectifyStateMap(data.getStateMap(), stateMap);
+}
+
+bool DepthRectifier::rectifyDistanceMap(const std::vector<uint16_t>& input,
+                                        std::vector<uint16_t>& output)
+{
+  if (!m_tablesValid || (input.size() != m_remapTable.size()))
+  {
+    return false;
+  }
+  output.resize(input.size());
+  parallelForRows(m_cameraParams.height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    remapRows(input.data(), output.data(), true, rowBegin, rowEnd);
+  });
+  return true;
+}
+
+bool DepthRectifier::rectifyIntensityMap(const std::vector<uint16_t>& input,
+                                         std::vector<uint16_t>& output)
+{
+  if (!m_tablesValid || (input.size() != m_remapTable.size()))
+  {
+    return false;
+  }
+  output.resize(input.size());
+  parallelForRows(m_cameraParams.height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    remapRows(input.data(), output.data(), false, rowBegin, rowEnd);
+  });
+  return true;
+}
+
+bool DepthRectifier::rectifyStateMap(const std::vector<uint8_t>& input,
+                                     std::vector<uint8_t>& output)
+{
+  if (!m_tablesValid || (input.size() != m_remapTable.size()))
+  {
+    return false;
+  }
+  output.resize(input.size());
+  parallelForRows(m_cameraParams.height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    const size_t begin = static_cast<size_t>(rowBegin) * m_cameraParams.width;
+    const size_t end   = static_cast<size_t>(rowEnd) * m_cameraParams.width;
+    for (size_t i = begin; i < end; ++i)
+    {
+      // flags can not be interpolated, pixels outside of the source image have no state
+      const int32_t index = m_remapTable[i].index;
+      output[i]           = (index >= 0) ? input[index] : 0u;
+    }
+  });
+  return true;
+}
+
+void DepthRectifier::remapRows(
+  const uint16_t* input, uint16_t* output, bool isDistance, int rowBegin, int rowEnd) const
+{
+  const int width    = m_cameraParams.width;
+  const bool planar  = isDistance && (DepthType::PLANAR == m_depthType);
+  const size_t begin = static_cast<size_t>(rowBegin) * width;
+  const size_t end   = static_cast<size_t>(rowEnd) * width;
+
+  for (size_t i = begin; i < end; ++i)
+  {
+    const RemapEntry& entry = m_remapTable[i];
+    if (entry.index < 0)
+    {
+      output[i] = 0u;
+      continue;
+    }
+
+    uint32_t value = input[entry.index];
+    if (Interpolation::BILINEAR == m_interpolation)
+    {
+      const uint16_t* src      = input + entry.index00;
+      const uint32_t weightX   = entry.weightX;
+      const uint32_t weightY   = entry.weightY;
+      const uint32_t stepY     = entry.stepY * static_cast<uint32_t>(width);
+      const uint32_t values[4] = {src[0], src[entry.stepX], src[stepY], src[stepY + entry.stepX]};
+      uint32_t weights[4]      = {(256u - weightX) * (256u - weightY),
+                                  weightX * (256u - weightY),
+                                  (256u - weightX) * weightY,
+                                  weightX * weightY};
+
+      // leave out invalid distances and renormalize the weights of the others
+      uint32_t weightSum = 0u;
+      uint32_t valueSum  = 0u;
+      for (int j = 0; j < 4; j++)
+      {
+        weights[j] = (!isDistance || isValid(static_cast<uint16_t>(values[j]))) ? weights[j] : 0u;
+        weightSum += weights[j];
+        valueSum += values[j] * weights[j];
+      }
+      // the sums do not overflow as the weights add up to at most 65536
+      if (weightSum >= 32768u)
+      {
+        value = (valueSum + weightSum / 2u) / weightSum;
+      }
+      else if (isDistance)
+      {
+        // mostly invalid neighborhood
+        value = 0u;
+      }
+    }
+
+    if (planar && isValid(static_cast<uint16_t>(value)))
+    {
+      const uint32_t z = static_cast<uint32_t>(
+        (static_cast<uint64_t>(value) * m_planarFactor[i] + 32768u) >> 16);
+      value = (z > m_f2rc) ? std::min<uint32_t>(z - m_f2rc, 0xFFFEu) : 1u;
+    }
+    output[i] = static_cast<uint16_t>(value);
+  }
+}
+
+} // namespace visionary
@@ -0,0 +1,320 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/DeviceEmulator.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace visionary {
+
+DeviceEmulator::DeviceEmulator()
+  : m_protocol(Protocol::UDP)
+  , m_ipAddress("127.0.0.1")
+  , m_port(6060u)
+  , m_width(512)
+  , m_height(424)
+  , m_framesPerSecond(30.0)
+  , m_numCameras(1u)
+  , m_linkRate(1e9)
+  , m_running(false)
+  , m_numBlobsSent(0u)
+  , m_numBytesSent(0u)
+{
+}
+
+DeviceEmulator::~DeviceEmulator()
+{
+  stop();
+}
+
+void DeviceEmulator::setProtocol(Protocol protocol)
+{
+  m_protocol = protocol;
+}
+
+void DeviceEmulator::setDestination(const std::string& ipAddress)
+{
+  m_ipAddress = ipAddress;
+}
+
+void DeviceEmulator::setPort(uint16_t port)
+{
+  m_port = port;
+}
+
+void DeviceEmulator::setResolution(int width, int height)
+{
+  m_width  = width;
+  m_height = height;
+}
+
+void DeviceEmulator::setFrameRate(double framesPerSecond)
+{
+  m_framesPerSecond = framesPerSecond;
+}
+
+void DeviceEmulator::setNumCameras(unsigned int numCameras)
+{
+  m_numCameras = numCameras;
+}
+
+void DeviceEmulator::setLinkRate(double bitsPerSecond)
+{
+  m_linkRate = bitsPerSecond;
+}
+
+bool DeviceEmulator::isRunning() const
+{
+  return m_running;
+}
+
+uint64_t DeviceEmulator::getNumBlobsSent() const
+{
+  return m_numBlobsSent;
+}
+
+uint64_t DeviceEmulator::getNumBytesSent() const
+{
+  return m_numBytesSent;
+}
+
+bool DeviceEmulator::start()
+{
+  if (m_running)
+  {
+    return false;
+  }
+
+  for (unsigned int camera = 0u; camera < m_numCameras; ++camera)
+  {
+    const uint16_t port = htons(static_cast<uint16_t>(m_port + camera));
+    if (Protocol::UDP == m_protocol)
+    {
+      std::unique_ptr<UdpSocket> socket(new UdpSocket());
+      if (socket->connect(m_ipAddress, port) != 0)
+      {
+        std::printf("Failed to open UDP socket of emulated camera %u\n", camera);
+        stop();
+        return false;
+      }
+      m_udpSockets.push_back(std::move(socket));
+    }
+    else
+    {
+      std::unique_ptr<TcpSocket> socket(new TcpSocket());
+      if (socket->openServer(port) != 0)
+      {
+        std::printf("Failed to listen on TCP port %u of emulated camera %u\n",
+                    static_cast<unsigned int>(m_port + camera),
+                    camera);
+        socket->shutdown();
+        stop();
+        return false;
+      }
+      m_tcpSockets.push_back(std::move(socket));
+    }
+  }
+
+  m_running = true;
+  for (unsigned int camera = 0u; camera < m_numCameras; ++camera)
+  {
+    m_threads.emplace_back(&DeviceEmulator::runCamera, this, camera);
+  }
+  return true;
+}
+
+void DeviceEmulator::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_stopSignal.notify_all();
+
+  // a camera may still wait for its client, connect to let the accept call return
+  for (std::size_t camera = 0u; camera < m_tcpSockets.size(); ++camera)
+  {
+    TcpSocket wakeUp;
+    wakeUp.connect("127.0.0.1", htons(static_cast<uint16_t>(m_port + camera)));
+    wakeUp.shutdown();
+  }
+
+  for (std::thread& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+
+  for (std::unique_ptr<UdpSocket>& socket : m_udpSockets)
+  {
+    socket->shutdown();
+  }
+  m_udpSockets.clear();
+  for (std::unique_ptr<TcpSocket>& socket : m_tcpSockets)
+  {
+    socket->shutdown();
+  }
+  m_tcpSockets.clear();
+}
+
+bool DeviceEmulator::waitUntil(std::chrono::steady_clock::time_point time)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_stopSignal.wait_until(lock, time, [this] { return !m_running; });
+  return m_running;
+}
+
+void DeviceEmulator::runCamera(unsigned int index)
+{
+  ITransport* transport = nullptr;
+  if (Protocol::UDP == m_protocol)
+  {
+    transport = m_udpSockets[index].get();
+  }
+  else
+  {
+    if (!m_tcpSockets[index]->WaitForConnection() || !m_running)
+    {
+      return;
+    }
+    transport = m_tcpSockets[index].get();
+  }
+
+  BlobGenerator generator;
+  generator.setResolution(m_width, m_height);
+
+  std::vector<uint8_t> blob;
+  std::vector<uint8_t> packet;
+  uint32_t frameNumber = 1u;
+  uint16_t blobNumber  = 0u;
+
+  const std::chrono::steady_clock::duration period =
+    (m_framesPerSecond > 0.0)
+      ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / m_framesPerSecond))
+      : std::chrono::steady_clock::duration::zero();
+  std::chrono::steady_clock::time_point nextFrame = std::chrono::steady_clock::now();
+
+  while (m_running)
+  {
+    // the Blob is generated ahead and stamped with the time it is due
+    const uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 nextFrame.time_since_epoch())
+                                 .count();
+    const std::chrono::system_clock::time_point dueTime =
+      std::chrono::system_clock::now() +
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        nextFrame - std::chrono::steady_clock::now());
+    generator.generate(frameNumber, BlobGenerator::toDeviceTimestamp(dueTime), blob);
+
+    if (!waitUntil(nextFrame))
+    {
+      break;
+    }
+
+    const bool sent = (Protocol::UDP == m_protocol)
+                        ? sendUdp(*transport,
+                                  blob,
+                                  blobNumber,
+                                  static_cast<uint32_t>(timestamp),
+                                  packet)
+                        : sendTcp(*transport, blob, packet);
+    if (!sent)
+    {
+      std::printf("Emulated camera %u stopped, sending failed\n", index);
+      break;
+    }
+    m_numBlobsSent++;
+    m_numBytesSent += blob.size();
+
+    frameNumber++;
+    blobNumber++;
+
+    // do not try to catch up on frames which are already late
+    nextFrame += period;
+    nextFrame = std::max(nextFrame, std::chrono::steady_clock::now() - period);
+  }
+}
+
+bool DeviceEmulator::sendUdp(ITransport& transport,
+                             const std::vector<uint8_t>& blob,
+                             uint16_t blobNumber,
+                             uint32_t timestamp,
+                             std::vector<uint8_t>& datagram)
+{
+  datagram.resize(MAX_UDP_BLOB_PACKET_SIZE);
+
+  const std::chrono::steady_clock::time_point blobStart = std::chrono::steady_clock::now();
+  std::size_t bytesSent                                 = 0u;
+
+  uint16_t fragmentNumber = 0u;
+  for (std::size_t offset = 0u; offset < blob.size(); offset += UDP_FRAGMENT_PAYLOAD_MAX)
+  {
+    const std::size_t payloadSize = std::min(UDP_FRAGMENT_PAYLOAD_MAX, blob.size() - offset);
+    const bool isLastFragment     = (offset + payloadSize) == blob.size();
+    datagram.resize(writeUdpFragment(datagram.data(),
+                                     blobNumber,
+                                     fragmentNumber,
+                                     timestamp,
+                                     isLastFragment,
+                                     blob.data() + offset,
+                                     payloadSize));
+    if (transport.send(datagram) != static_cast<int>(datagram.size()))
+    {
+      return false;
+    }
+    bytesSent += datagram.size();
+    datagram.resize(MAX_UDP_BLOB_PACKET_SIZE);
+    fragmentNumber++;
+
+    if (m_linkRate > 0.0)
+    {
+      // sleeping is too coarse for single fragments, so only sleep once well ahead of the link
+      const std::chrono::steady_clock::time_point due =
+        blobStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(bytesSent * 8.0 / m_linkRate));
+      if ((due - std::chrono::steady_clock::now()) > std::chrono::microseconds(200))
+      {
+        std::this_thread::sleep_until(due);
+      }
+    }
+  }
+  return true;
+}
+
+bool DeviceEmulator::sendTcp(ITransport& transport,
+                             const std::vector<uint8_t>& blob,
+                             std::vector<uint8_t>& packet)
+{
+  // the receiver recognizes the start of a Blob by a packet of the Blob header size
+  packet.assign(blob.begin(), blob.begin() + BLOB_HEADER_SIZE);
+  if (transport.send(packet) != static_cast<int>(packet.size()))
+  {
+    return false;
+  }
+  packet.assign(blob.begin() + BLOB_HEADER_SIZE, blob.end());
+  return transport.send(packet) == static_cast<int>(packet.size());
+}
+
+} // namespace visionary
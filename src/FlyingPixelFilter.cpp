@@ -0,0 +1,278 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/FlyingPixelFilter.h"
+#include "sick_safevisionary_base/ParallelRows.h"
+#include "sick_safevisionary_base/SafeVisionaryData.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define FLYING_PIXEL_FILTER_SSE2
+#endif
+
+namespace visionary {
+
+namespace {
+inline bool isValid(uint16_t value)
+{
+  return value != 0 && value != uint16_t(0xFFFF);
+}
+
+#ifdef FLYING_PIXEL_FILTER_SSE2
+/// All bits set in lanes holding a valid distance
+inline __m128i validMask(__m128i values)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi32(-1);
+  const __m128i invalid =
+    _mm_or_si128(_mm_cmpeq_epi16(values, zero), _mm_cmpeq_epi16(values, ones));
+  return _mm_andnot_si128(invalid, ones);
+}
+
+/// All bits set in lanes whose state has none of the mask bits set
+inline __m128i stateOkMask(const uint8_t* state, __m128i mask)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i state16 =
+    _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(state)), zero);
+  return _mm_cmpeq_epi16(_mm_and_si128(state16, mask), zero);
+}
+#endif
+} // namespace
+
+FlyingPixelFilter::FlyingPixelFilter()
+  : m_relativeThreshold(0u)
+  , m_offsetThreshold(0u)
+  , m_minDiscontinuities(2)
+  , m_stateMask(0u)
+  , m_numThreads(1u)
+  , m_numRejected(0u)
+{
+  setThreshold(0.03f, 0.02f);
+}
+
+FlyingPixelFilter::~FlyingPixelFilter() {}
+
+void FlyingPixelFilter::setThreshold(float relative, float offset)
+{
+  const float offsetRaw = offset * 1000.f / SafeVisionaryData::DISTANCE_MAP_UNIT;
+  m_relativeThreshold =
+    static_cast<uint16_t>(std::max(0.f, std::min(65535.f, std::round(relative * 65536.f))));
+  m_offsetThreshold =
+    static_cast<uint16_t>(std::max(0.f, std::min(65535.f, std::round(offsetRaw))));
+}
+
+void FlyingPixelFilter::setMinDiscontinuities(int count)
+{
+  m_minDiscontinuities = std::max(1, std::min(count, 4));
+}
+
+void FlyingPixelFilter::setStateMask(uint8_t mask)
+{
+  m_stateMask = mask;
+}
+
+void FlyingPixelFilter::setNumThreads(unsigned numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+std::size_t FlyingPixelFilter::getNumRejected() const
+{
+  return m_numRejected;
+}
+
+bool FlyingPixelFilter::apply(std::vector<uint16_t>& distanceMap,
+                              int width,
+                              int height,
+                              const std::vector<uint8_t>* stateMap)
+{
+  // the neighbors of the pixels have to stay unchanged until all rows are done
+  if (!apply(distanceMap, width, height, m_buffer, stateMap))
+  {
+    return false;
+  }
+  std::memcpy(distanceMap.data(), m_buffer.data(), distanceMap.size() * sizeof(uint16_t));
+  return true;
+}
+
+bool FlyingPixelFilter::apply(const std::vector<uint16_t>& distanceMap,
+                              int width,
+                              int height,
+                              std::vector<uint16_t>& filteredMap,
+                              const std::vector<uint8_t>* stateMap)
+{
+  m_numRejected = 0u;
+  if ((width <= 0) || (height <= 0) ||
+      (distanceMap.size() != static_cast<std::size_t>(width) * height) ||
+      ((stateMap != nullptr) && (stateMap->size() != distanceMap.size())))
+  {
+    return false;
+  }
+  if (&distanceMap == &filteredMap)
+  {
+    return apply(filteredMap, width, height, stateMap);
+  }
+  filteredMap.resize(distanceMap.size());
+
+  const uint8_t* state =
+    ((stateMap != nullptr) && (m_stateMask != 0u)) ? stateMap->data() : nullptr;
+  std::atomic<std::size_t> numRejected(0u);
+  parallelForRows(height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    numRejected +=
+      filterRows(distanceMap.data(), state, width, height, filteredMap.data(), rowBegin, rowEnd);
+  });
+  m_numRejected = numRejected;
+  return true;
+}
+
+uint16_t FlyingPixelFilter::filterPixel(
+  const uint16_t* input, const uint8_t* state, int width, int height, int row, int col) const
+{
+  const int index       = row * width + col;
+  const uint16_t center = input[index];
+  if (!isValid(center))
+  {
+    return center;
+  }
+  if ((state != nullptr) && ((state[index] & m_stateMask) != 0u))
+  {
+    return 0;
+  }
+
+  const uint32_t threshold = std::min<uint32_t>(
+    0xFFFFu, m_offsetThreshold + ((static_cast<uint32_t>(center) * m_relativeThreshold) >> 16));
+  const int neighbors[4] = {col > 0 ? index - 1 : -1,
+                            col + 1 < width ? index + 1 : -1,
+                            row > 0 ? index - width : -1,
+                            row + 1 < height ? index + width : -1};
+
+  int numDiscontinuities = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    if (neighbors[i] < 0)
+    {
+      continue;
+    }
+    const uint16_t neighbor = input[neighbors[i]];
+    if (!isValid(neighbor) || ((state != nullptr) && ((state[neighbors[i]] & m_stateMask) != 0u)))
+    {
+      continue;
+    }
+    const uint32_t absDiff = (neighbor > center) ? neighbor - center : center - neighbor;
+    numDiscontinuities += (absDiff > threshold) ? 1 : 0;
+  }
+  return (numDiscontinuities >= m_minDiscontinuities) ? 0 : center;
+}
+
+std::size_t FlyingPixelFilter::filterRows(const uint16_t* input,
+                                          const uint8_t* state,
+                                          int width,
+                                          int height,
+                                          uint16_t* output,
+                                          int rowBegin,
+                                          int rowEnd) const
+{
+  std::size_t numRejected = 0u;
+  for (int row = rowBegin; row < rowEnd; row++)
+  {
+    const int rowOffset = row * width;
+
+    // the first pixel of the row has no left neighbor
+    output[rowOffset] = filterPixel(input, state, width, height, row, 0);
+    numRejected += (output[rowOffset] != input[rowOffset]) ? 1u : 0u;
+    int col = 1;
+
+#ifdef FLYING_PIXEL_FILTER_SSE2
+    // Inner pixels in blocks of 8. A missing upper or lower neighbor is replaced by the pixel
+    // itself, which is never a discontinuity.
+    const int upOffset   = (row > 0) ? rowOffset - width : rowOffset;
+    const int downOffset = (row + 1 < height) ? rowOffset + width : rowOffset;
+
+    const __m128i ones      = _mm_set1_epi32(-1);
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i relative  = _mm_set1_epi16(static_cast<short>(m_relativeThreshold));
+    const __m128i offset    = _mm_set1_epi16(static_cast<short>(m_offsetThreshold));
+    const __m128i minCount  = _mm_set1_epi16(static_cast<short>(m_minDiscontinuities - 1));
+    const __m128i stateMask = _mm_set1_epi16(static_cast<short>(m_stateMask));
+    __m128i rejectedLanes   = zero;
+    for (; col + 8 < width; col += 8)
+    {
+      const int index      = rowOffset + col;
+      const int offsets[4] = {index - 1, index + 1, upOffset + col, downOffset + col};
+
+      const __m128i center    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index));
+      const __m128i threshold = _mm_adds_epu16(offset, _mm_mulhi_epu16(center, relative));
+
+      __m128i removed = zero;
+      if (state != nullptr)
+      {
+        removed = _mm_andnot_si128(stateOkMask(state + index, stateMask), ones);
+      }
+
+      __m128i numDiscontinuities = zero;
+      for (int i = 0; i < 4; i++)
+      {
+        const __m128i neighbor =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + offsets[i]));
+        __m128i usable = validMask(neighbor);
+        if (state != nullptr)
+        {
+          usable = _mm_and_si128(usable, stateOkMask(state + offsets[i], stateMask));
+        }
+        // |center - neighbor| > threshold, with unsigned saturation instead of unsigned compares
+        const __m128i absDiff =
+          _mm_or_si128(_mm_subs_epu16(center, neighbor), _mm_subs_epu16(neighbor, center));
+        const __m128i exceeds =
+          _mm_andnot_si128(_mm_cmpeq_epi16(_mm_subs_epu16(absDiff, threshold), zero), ones);
+        numDiscontinuities = _mm_sub_epi16(numDiscontinuities, _mm_and_si128(usable, exceeds));
+      }
+      removed = _mm_or_si128(removed, _mm_cmpgt_epi16(numDiscontinuities, minCount));
+      removed = _mm_and_si128(removed, validMask(center));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index),
+                       _mm_andnot_si128(removed, center));
+      rejectedLanes = _mm_sub_epi16(rejectedLanes, removed);
+    }
+
+    int16_t laneCounts[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneCounts), rejectedLanes);
+    for (int i = 0; i < 8; i++)
+    {
+      numRejected += static_cast<std::size_t>(laneCounts[i]);
+    }
+#endif
+    for (; col < width; col++)
+    {
+      const int index = rowOffset + col;
+      output[index]   = filterPixel(input, state, width, height, row, col);
+      numRejected += (output[index] != input[index]) ? 1u : 0u;
+    }
+  }
+  return numRejected;
+}
+
+} // namespace visionary
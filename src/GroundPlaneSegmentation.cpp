@@ -0,0 +1,347 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/GroundPlaneSegmentation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visionary {
+
+namespace {
+inline bool isValid(const PointXYZ& point)
+{
+  return !std::isnan(point.z);
+}
+
+inline float signedDistance(const PlaneCoefficients& plane, const PointXYZ& point)
+{
+  return plane.a * point.x + plane.b * point.y + plane.c * point.z + plane.d;
+}
+
+/// Small and fast pseudo random number generator (xorshift32), deterministic for each frame
+inline uint32_t nextRandom(uint32_t& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+} // namespace
+
+GroundPlaneSegmentation::GroundPlaneSegmentation()
+  : m_prior{0.f, 0.f, 1.f, 0.f}
+  , m_priorDistance(0.15f)
+  , m_minCosAngle(std::cos(0.17f))
+  , m_distanceThreshold(0.03f)
+  , m_maxIterations(64)
+  , m_minInlierRatio(0.2f)
+  , m_numInliers(0u)
+  , m_numCandidates(0u)
+{
+  setMaxSamples(2048);
+}
+
+GroundPlaneSegmentation::~GroundPlaneSegmentation() {}
+
+void GroundPlaneSegmentation::setPrior(const CameraParameters& cameraParams, float floorHeight)
+{
+  // the world z coordinate of a point in camera coordinates is given by the third row of the
+  // Cam2World matrix, the translation is in [mm]
+  PlaneCoefficients prior;
+  prior.a = static_cast<float>(cameraParams.cam2worldMatrix[8]);
+  prior.b = static_cast<float>(cameraParams.cam2worldMatrix[9]);
+  prior.c = static_cast<float>(cameraParams.cam2worldMatrix[10]);
+  prior.d = static_cast<float>(cameraParams.cam2worldMatrix[11] / 1000.) - floorHeight;
+  setPrior(prior);
+}
+
+void GroundPlaneSegmentation::setPrior(const PlaneCoefficients& prior)
+{
+  const float norm = std::sqrt(prior.a * prior.a + prior.b * prior.b + prior.c * prior.c);
+  if (!(norm > 0.f))
+  {
+    return;
+  }
+  m_prior.a = prior.a / norm;
+  m_prior.b = prior.b / norm;
+  m_prior.c = prior.c / norm;
+  m_prior.d = prior.d / norm;
+}
+
+const PlaneCoefficients& GroundPlaneSegmentation::getPrior() const
+{
+  return m_prior;
+}
+
+void GroundPlaneSegmentation::setPriorTolerance(float distance, float angle)
+{
+  m_priorDistance = distance;
+  m_minCosAngle   = std::cos(angle);
+}
+
+void GroundPlaneSegmentation::setDistanceThreshold(float distance)
+{
+  m_distanceThreshold = distance;
+}
+
+float GroundPlaneSegmentation::getDistanceThreshold() const
+{
+  return m_distanceThreshold;
+}
+
+void GroundPlaneSegmentation::setMaxIterations(int iterations)
+{
+  m_maxIterations = std::max(1, iterations);
+}
+
+void GroundPlaneSegmentation::setMaxSamples(int samples)
+{
+  m_candidates.resize(static_cast<size_t>(std::max(3, samples)));
+}
+
+void GroundPlaneSegmentation::setMinInlierRatio(float ratio)
+{
+  m_minInlierRatio = ratio;
+}
+
+size_t GroundPlaneSegmentation::getNumInliers() const
+{
+  return m_numInliers;
+}
+
+bool GroundPlaneSegmentation::segment(const std::vector<PointXYZ>& pointCloud,
+                                      int width,
+                                      int height,
+                                      std::vector<uint8_t>& inlierMask,
+                                      PlaneCoefficients& plane)
+{
+  inlierMask.resize(pointCloud.size());
+  std::fill(inlierMask.begin(), inlierMask.end(), 0u);
+  m_numInliers = 0u;
+  plane        = m_prior;
+
+  if ((width <= 0) || (height <= 0) || (pointCloud.size() != static_cast<size_t>(width * height)))
+  {
+    return false;
+  }
+
+  sampleCandidates(pointCloud, width, height);
+  if (m_numCandidates < 3u)
+  {
+    return false;
+  }
+
+  PlaneCoefficients bestPlane;
+  const size_t numCandidateInliers = findBestPlane(bestPlane);
+  if ((numCandidateInliers < 3u) ||
+      (static_cast<float>(numCandidateInliers) < m_minInlierRatio * m_numCandidates))
+  {
+    return false;
+  }
+  refinePlane(bestPlane);
+
+  // label all points of the cloud
+  const PointXYZ* itPoint = pointCloud.data();
+  uint8_t* itMask         = inlierMask.data();
+  size_t numInliers       = 0u;
+  for (size_t i = 0u; i < pointCloud.size(); ++i)
+  {
+    // NaN points fail the comparison and are never inliers
+    const uint8_t isInlier =
+      (std::fabs(signedDistance(bestPlane, itPoint[i])) <= m_distanceThreshold) ? 1u : 0u;
+    itMask[i] = isInlier;
+    numInliers += isInlier;
+  }
+
+  m_numInliers = numInliers;
+  plane        = bestPlane;
+  return true;
+}
+
+void GroundPlaneSegmentation::sampleCandidates(const std::vector<PointXYZ>& pointCloud,
+                                               int width,
+                                               int height)
+{
+  const size_t maxSamples = m_candidates.size();
+
+  // grid step which results in at most maxSamples grid points
+  int step = static_cast<int>(
+    std::ceil(std::sqrt(static_cast<double>(width) * height / static_cast<double>(maxSamples))));
+  step = std::max(1, step);
+
+  m_numCandidates = 0u;
+  for (int row = step / 2; row < height; row += step)
+  {
+    const PointXYZ* itRow = pointCloud.data() + row * width;
+    for (int col = step / 2; col < width; col += step)
+    {
+      const PointXYZ& point = itRow[col];
+      if (isValid(point) && (std::fabs(signedDistance(m_prior, point)) <= m_priorDistance) &&
+          (m_numCandidates < maxSamples))
+      {
+        m_candidates[m_numCandidates++] = point;
+      }
+    }
+  }
+}
+
+size_t GroundPlaneSegmentation::findBestPlane(PlaneCoefficients& plane)
+{
+  // start with the prior as hypothesis, so a perfectly placed sensor needs no lucky sample
+  plane            = m_prior;
+  size_t bestCount = 0u;
+  for (size_t i = 0u; i < m_numCandidates; ++i)
+  {
+    bestCount += (std::fabs(signedDistance(m_prior, m_candidates[i])) <= m_distanceThreshold);
+  }
+
+  uint32_t randomState = 0x9E3779B9u;
+  for (int iteration = 0; iteration < m_maxIterations; ++iteration)
+  {
+    if (bestCount == m_numCandidates)
+    {
+      break;
+    }
+
+    const PointXYZ& p0 = m_candidates[nextRandom(randomState) % m_numCandidates];
+    const PointXYZ& p1 = m_candidates[nextRandom(randomState) % m_numCandidates];
+    const PointXYZ& p2 = m_candidates[nextRandom(randomState) % m_numCandidates];
+
+    const float ux = p1.x - p0.x;
+    const float uy = p1.y - p0.y;
+    const float uz = p1.z - p0.z;
+    const float vx = p2.x - p0.x;
+    const float vy = p2.y - p0.y;
+    const float vz = p2.z - p0.z;
+
+    PlaneCoefficients hypothesis;
+    hypothesis.a     = uy * vz - uz * vy;
+    hypothesis.b     = uz * vx - ux * vz;
+    hypothesis.c     = ux * vy - uy * vx;
+    const float norm = std::sqrt(hypothesis.a * hypothesis.a + hypothesis.b * hypothesis.b +
+                                 hypothesis.c * hypothesis.c);
+    if (!(norm > 1e-9f))
+    {
+      // degenerated sample, e.g. the same point drawn twice
+      continue;
+    }
+
+    // orient like the prior and reject planes tilted too much
+    float cosAngle =
+      (hypothesis.a * m_prior.a + hypothesis.b * m_prior.b + hypothesis.c * m_prior.c) / norm;
+    const float scale = (cosAngle < 0.f ? -1.f : 1.f) / norm;
+    cosAngle          = std::fabs(cosAngle);
+    if (cosAngle < m_minCosAngle)
+    {
+      continue;
+    }
+    hypothesis.a *= scale;
+    hypothesis.b *= scale;
+    hypothesis.c *= scale;
+    hypothesis.d = -(hypothesis.a * p0.x + hypothesis.b * p0.y + hypothesis.c * p0.z);
+
+    size_t count = 0u;
+    for (size_t i = 0u; i < m_numCandidates; ++i)
+    {
+      count += (std::fabs(signedDistance(hypothesis, m_candidates[i])) <= m_distanceThreshold);
+    }
+    if (count > bestCount)
+    {
+      bestCount = count;
+      plane     = hypothesis;
+    }
+  }
+  return bestCount;
+}
+
+void GroundPlaneSegmentation::refinePlane(PlaneCoefficients& plane) const
+{
+  // centroid and covariance of the candidate inliers
+  double sum[3] = {0., 0., 0.};
+  double cov[6] = {0., 0., 0., 0., 0., 0.}; // xx, xy, xz, yy, yz, zz
+  size_t count  = 0u;
+  for (size_t i = 0u; i < m_numCandidates; ++i)
+  {
+    const PointXYZ& point = m_candidates[i];
+    if (std::fabs(signedDistance(plane, point)) > m_distanceThreshold)
+    {
+      continue;
+    }
+    sum[0] += point.x;
+    sum[1] += point.y;
+    sum[2] += point.z;
+    cov[0] += static_cast<double>(point.x) * point.x;
+    cov[1] += static_cast<double>(point.x) * point.y;
+    cov[2] += static_cast<double>(point.x) * point.z;
+    cov[3] += static_cast<double>(point.y) * point.y;
+    cov[4] += static_cast<double>(point.y) * point.z;
+    cov[5] += static_cast<double>(point.z) * point.z;
+    ++count;
+  }
+  if (count < 3u)
+  {
+    return;
+  }
+
+  const double cx = sum[0] / count;
+  const double cy = sum[1] / count;
+  const double cz = sum[2] / count;
+  const double xx = cov[0] / count - cx * cx;
+  const double xy = cov[1] / count - cx * cy;
+  const double xz = cov[2] / count - cx * cz;
+  const double yy = cov[3] / count - cy * cy;
+  const double yz = cov[4] / count - cy * cz;
+  const double zz = cov[5] / count - cz * cz;
+
+  // The normal is the eigenvector of the smallest eigenvalue of the covariance, i.e. of the
+  // largest eigenvalue of trace * I - covariance. The RANSAC normal is already close, so a few
+  // power iterations are sufficient.
+  const double trace = xx + yy + zz;
+  double n[3]        = {plane.a, plane.b, plane.c};
+  for (int iteration = 0; iteration < 16; ++iteration)
+  {
+    const double nx   = (trace - xx) * n[0] - xy * n[1] - xz * n[2];
+    const double ny   = -xy * n[0] + (trace - yy) * n[1] - yz * n[2];
+    const double nz   = -xz * n[0] - yz * n[1] + (trace - zz) * n[2];
+    const double norm = std::sqrt(nx * nx + ny * ny + nz * nz);
+    if (!(norm > 0.))
+    {
+      return;
+    }
+    n[0] = nx / norm;
+    n[1] = ny / norm;
+    n[2] = nz / norm;
+  }
+
+  if (n[0] * plane.a + n[1] * plane.b + n[2] * plane.c < 0.)
+  {
+    n[0] = -n[0];
+    n[1] = -n[1];
+    n[2] = -n[2];
+  }
+  plane.a = static_cast<float>(n[0]);
+  plane.b = static_cast<float>(n[1]);
+  plane.c = static_cast<float>(n[2]);
+  plane.d = static_cast<float>(-(n[0] * cx + n[1] * cy + n[2] * cz));
+}
+
+} // namespace visionary
@@ -0,0 +1,220 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/HeightGridAccumulator.h"
+#include "sick_safevisionary_base/ParallelRows.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace visionary {
+
+namespace {
+const HeightGridCell empty_cell = {-std::numeric_limits<float>::infinity(), 0u, 0u};
+} // namespace
+
+HeightGridAccumulator::HeightGridAccumulator(
+  float originX, float originY, float resolution, int cellsX, int cellsY)
+  : m_originX(originX)
+  , m_originY(originY)
+  , m_resolution(resolution)
+  , m_cellsX(std::max(0, cellsX))
+  , m_cellsY(std::max(0, cellsY))
+  , m_minHeight(-std::numeric_limits<float>::max())
+  , m_maxHeight(std::numeric_limits<float>::max())
+  , m_maxAge(0u)
+  , m_numThreads(1u)
+  , m_lastFrameNumber(0u)
+  , m_cells(static_cast<size_t>(m_cellsX) * m_cellsY, empty_cell)
+{
+}
+
+HeightGridAccumulator::~HeightGridAccumulator() {}
+
+void HeightGridAccumulator::setHeightBand(float minHeight, float maxHeight)
+{
+  m_minHeight = minHeight;
+  m_maxHeight = maxHeight;
+}
+
+void HeightGridAccumulator::setMaxAge(uint32_t frames)
+{
+  m_maxAge = frames;
+}
+
+void HeightGridAccumulator::setNumThreads(unsigned numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+void HeightGridAccumulator::integrate(SafeVisionaryData& data)
+{
+  integrate(data, data.getFrameNum());
+}
+
+void HeightGridAccumulator::integrate(SafeVisionaryData& data, uint32_t frameNumber)
+{
+  const std::vector<uint16_t>& distanceMap = data.getDistanceMap();
+  const std::vector<PointXYZ>& lookUpTable = data.getPointCloudLookUpTable();
+  const CameraParameters& cameraParams     = data.getCameraParameters();
+
+  const int width = data.getWidth();
+  if ((width <= 0) || (distanceMap.size() != lookUpTable.size()) ||
+      (distanceMap.size() % static_cast<size_t>(width) != 0u))
+  {
+    return;
+  }
+  const int height = static_cast<int>(distanceMap.size() / width);
+
+  float cam2world[12];
+  VisionaryData::getCam2WorldMatrix(cameraParams, cam2world);
+  const float f2rc = static_cast<float>(cameraParams.f2rc / 1000.);
+
+  m_pixelCells.resize(distanceMap.size());
+  m_pixelHeights.resize(distanceMap.size());
+  parallelForRows(height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    projectRows(distanceMap, lookUpTable, cam2world, f2rc, width, rowBegin, rowEnd);
+  });
+
+  // Serial update, so several pixels hitting the same cell need no synchronization
+  const int32_t* itCell = m_pixelCells.data();
+  const float* itHeight = m_pixelHeights.data();
+  for (size_t i = 0u; i < distanceMap.size(); ++i)
+  {
+    if (itCell[i] < 0)
+    {
+      continue;
+    }
+    HeightGridCell& cell = m_cells[static_cast<size_t>(itCell[i])];
+    if (isOutdated(cell, frameNumber))
+    {
+      cell = empty_cell;
+    }
+    if (cell.hitCount != std::numeric_limits<uint32_t>::max())
+    {
+      ++cell.hitCount;
+    }
+    cell.maxHeight     = std::max(cell.maxHeight, itHeight[i]);
+    cell.lastSeenFrame = frameNumber;
+  }
+  m_lastFrameNumber = frameNumber;
+}
+
+void HeightGridAccumulator::projectRows(const std::vector<uint16_t>& distanceMap,
+                                        const std::vector<PointXYZ>& lookUpTable,
+                                        const float* cam2world,
+                                        float f2rc,
+                                        int width,
+                                        int rowBegin,
+                                        int rowEnd)
+{
+  const float pixelSizeZ    = SafeVisionaryData::DISTANCE_MAP_UNIT;
+  const float invResolution = 1.f / m_resolution;
+  const float* m            = cam2world;
+
+  const size_t begin = static_cast<size_t>(rowBegin) * width;
+  const size_t end   = static_cast<size_t>(rowEnd) * width;
+  for (size_t i = begin; i < end; ++i)
+  {
+    const uint16_t raw = distanceMap[i];
+    int32_t cellIndex  = -1;
+    if (raw != 0 && raw != uint16_t(0xFFFF))
+    {
+      const PointXYZ& undistorted = lookUpTable[i];
+
+      const float distance = static_cast<float>(raw) * pixelSizeZ;
+      const float cx       = undistorted.x * distance;
+      const float cy       = undistorted.y * distance;
+      const float cz       = undistorted.z * distance - f2rc;
+
+      const float wx = m[0] * cx + m[1] * cy + m[2] * cz + m[3];
+      const float wy = m[4] * cx + m[5] * cy + m[6] * cz + m[7];
+      const float wz = m[8] * cx + m[9] * cy + m[10] * cz + m[11];
+
+      // grid coordinates, compared as float to avoid overflows of the integer conversion
+      const float gx = std::floor((wx - m_originX) * invResolution);
+      const float gy = std::floor((wy - m_originY) * invResolution);
+      if ((wz >= m_minHeight) && (wz <= m_maxHeight) && (gx >= 0.f) &&
+          (gx < static_cast<float>(m_cellsX)) && (gy >= 0.f) && (gy < static_cast<float>(m_cellsY)))
+      {
+        cellIndex         = static_cast<int32_t>(gy) * m_cellsX + static_cast<int32_t>(gx);
+        m_pixelHeights[i] = wz;
+      }
+    }
+    m_pixelCells[i] = cellIndex;
+  }
+}
+
+bool HeightGridAccumulator::isOutdated(const HeightGridCell& cell, uint32_t frameNumber) const
+{
+  // the unsigned difference also handles wrap-arounds of the frame number
+  return (m_maxAge != 0u) && (cell.hitCount != 0u) &&
+         (frameNumber - cell.lastSeenFrame > m_maxAge);
+}
+
+void HeightGridAccumulator::decay()
+{
+  for (std::vector<HeightGridCell>::iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+  {
+    if (isOutdated(*it, m_lastFrameNumber))
+    {
+      *it = empty_cell;
+    }
+  }
+}
+
+void HeightGridAccumulator::clear()
+{
+  std::fill(m_cells.begin(), m_cells.end(), empty_cell);
+}
+
+bool HeightGridAccumulator::getCell(int x, int y, HeightGridCell& cell) const
+{
+  if ((x < 0) || (x >= m_cellsX) || (y < 0) || (y >= m_cellsY))
+  {
+    return false;
+  }
+  cell = m_cells[static_cast<size_t>(y) * m_cellsX + x];
+  return (cell.hitCount != 0u) && !isOutdated(cell, m_lastFrameNumber);
+}
+
+const std::vector<HeightGridCell>& HeightGridAccumulator::getCells() const
+{
+  return m_cells;
+}
+
+int HeightGridAccumulator::getCellsX() const
+{
+  return m_cellsX;
+}
+
+int HeightGridAccumulator::getCellsY() const
+{
+  return m_cellsY;
+}
+
+float HeightGridAccumulator::getResolution() const
+{
+  return m_resolution;
+}
+
+} // namespace visionary
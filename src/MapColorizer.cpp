@@ -0,0 +1,294 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/MapColorizer.h"
+#include "sick_safevisionary_base/ParallelRows.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace visionary {
+
+namespace {
+/// Number of look-up table entries, one per uint16 value
+constexpr std::size_t LUT_SIZE = 0x10000u;
+
+/// The auto-range histogram has bins of 2^HISTOGRAM_SHIFT map values
+constexpr int HISTOGRAM_SHIFT = 4;
+
+inline float clamp01(float value)
+{
+  return std::max(0.f, std::min(value, 1.f));
+}
+
+inline uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+  // keep the memory order r, g, b, a independent of the byte order of the host
+  const uint8_t bytes[4] = {r, g, b, a};
+  uint32_t color;
+  std::memcpy(&color, bytes, sizeof(color));
+  return color;
+}
+
+inline uint8_t toByte(float value)
+{
+  return static_cast<uint8_t>(clamp01(value) * 255.f + 0.5f);
+}
+
+/// Evaluates the colormap at t in [0, 1]
+uint32_t colormapColor(MapColorizer::Colormap colormap, float t)
+{
+  float r, g, b;
+  switch (colormap)
+  {
+    case MapColorizer::Colormap::GRAY:
+      r = g = b = t;
+      break;
+    case MapColorizer::Colormap::JET:
+      r = 1.5f - std::fabs(4.f * t - 3.f);
+      g = 1.5f - std::fabs(4.f * t - 2.f);
+      b = 1.5f - std::fabs(4.f * t - 1.f);
+      break;
+    case MapColorizer::Colormap::HOT:
+      r = 3.f * t;
+      g = 3.f * t - 1.f;
+      b = 3.f * t - 2.f;
+      break;
+    case MapColorizer::Colormap::TURBO:
+    default:
+      // polynomial approximation of the Turbo colormap
+      r = 0.13572138f +
+          t * (4.61539260f +
+               t * (-42.66032258f + t * (132.13108234f + t * (-152.94239396f + t * 59.28637943f))));
+      g = 0.09140261f +
+          t * (2.19418839f +
+               t * (4.84296658f + t * (-14.18503333f + t * (4.27729857f + t * 2.82956604f))));
+      b = 0.10667330f +
+          t * (12.64194608f +
+               t * (-60.58204836f + t * (110.36276771f + t * (-89.90310912f + t * 27.34824973f))));
+      break;
+  }
+  return packColor(toByte(r), toByte(g), toByte(b), 255u);
+}
+} // namespace
+
+MapColorizer::MapColorizer()
+  : m_colormap(Colormap::TURBO)
+  , m_minValue(1u)
+  , m_maxValue(0xFFFEu)
+  , m_autoRange(false)
+  , m_lowPercentile(0.02f)
+  , m_highPercentile(0.98f)
+  , m_gamma(1.f)
+  , m_invalidColor(packColor(0u, 0u, 0u, 0u))
+  , m_numThreads(1u)
+  , m_lookUpTableValid(false)
+{
+}
+
+MapColorizer::~MapColorizer() {}
+
+void MapColorizer::setColormap(Colormap colormap)
+{
+  m_colormap         = colormap;
+  m_lookUpTableValid = false;
+}
+
+void MapColorizer::setRange(uint16_t minValue, uint16_t maxValue)
+{
+  m_minValue         = std::min(minValue, maxValue);
+  m_maxValue         = std::max(minValue, maxValue);
+  m_autoRange        = false;
+  m_lookUpTableValid = false;
+}
+
+void MapColorizer::setAutoRange(float lowPercentile, float highPercentile)
+{
+  m_lowPercentile  = clamp01(std::min(lowPercentile, highPercentile));
+  m_highPercentile = clamp01(std::max(lowPercentile, highPercentile));
+  m_autoRange      = true;
+}
+
+void MapColorizer::setGamma(float gamma)
+{
+  m_gamma            = (gamma > 0.f) ? gamma : 1.f;
+  m_lookUpTableValid = false;
+}
+
+void MapColorizer::setInvalidColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+  m_invalidColor     = packColor(r, g, b, a);
+  m_lookUpTableValid = false;
+}
+
+void MapColorizer::setNumThreads(unsigned numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+uint16_t MapColorizer::getMinValue() const
+{
+  return m_minValue;
+}
+
+uint16_t MapColorizer::getMaxValue() const
+{
+  return m_maxValue;
+}
+
+bool MapColorizer::colorize(const std::vector<uint16_t>& map,
+                            int width,
+                            int height,
+                            std::vector<uint8_t>& rgba)
+{
+  if ((width <= 0) || (height <= 0) || (map.size() != static_cast<std::size_t>(width) * height))
+  {
+    return false;
+  }
+  rgba.resize(map.size() * 4u);
+  return colorize(map, width, height, rgba.data());
+}
+
+bool MapColorizer::colorize(
+  const std::vector<uint16_t>& map, int width, int height, uint8_t* rgba, std::size_t rowStride)
+{
+  if ((width <= 0) || (height <= 0) || (map.size() != static_cast<std::size_t>(width) * height) ||
+      (rgba == nullptr))
+  {
+    return false;
+  }
+  if (rowStride == 0u)
+  {
+    rowStride = static_cast<std::size_t>(width) * 4u;
+  }
+
+  if (m_autoRange)
+  {
+    updateAutoRange(map);
+  }
+  if (!m_lookUpTableValid)
+  {
+    updateLookUpTable();
+  }
+
+  const uint32_t* lut = m_lookUpTable.data();
+  parallelForRows(height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    for (int row = rowBegin; row < rowEnd; row++)
+    {
+      const uint16_t* itMap = map.data() + static_cast<std::size_t>(row) * width;
+      uint8_t* itRgba       = rgba + static_cast<std::size_t>(row) * rowStride;
+      for (int col = 0; col < width; col++)
+      {
+        std::memcpy(itRgba + 4 * col, lut + itMap[col], sizeof(uint32_t));
+      }
+    }
+  });
+  return true;
+}
+
+void MapColorizer::updateAutoRange(const std::vector<uint16_t>& map)
+{
+  m_histogram.assign(LUT_SIZE >> HISTOGRAM_SHIFT, 0u);
+  uint32_t* histogram  = m_histogram.data();
+  std::size_t numValid = 0u;
+  for (std::vector<uint16_t>::const_iterator it = map.begin(); it != map.end(); ++it)
+  {
+    if (*it != 0 && *it != uint16_t(0xFFFF))
+    {
+      ++histogram[*it >> HISTOGRAM_SHIFT];
+      ++numValid;
+    }
+  }
+  if (numValid == 0u)
+  {
+    return;
+  }
+
+  const std::size_t lowCount  = static_cast<std::size_t>(m_lowPercentile * numValid);
+  const std::size_t highCount = static_cast<std::size_t>(m_highPercentile * numValid);
+  std::size_t lowBin          = 0u;
+  std::size_t highBin         = 0u;
+  std::size_t sum             = 0u;
+  for (std::size_t bin = 0u; bin < m_histogram.size(); ++bin)
+  {
+    if (sum <= lowCount)
+    {
+      lowBin = bin;
+    }
+    sum += histogram[bin];
+    highBin = bin;
+    if (sum > highCount)
+    {
+      break;
+    }
+  }
+
+  const int minValue = std::max(1, static_cast<int>(lowBin << HISTOGRAM_SHIFT));
+  const int maxValue =
+    std::min(0xFFFE, static_cast<int>(((highBin + 1u) << HISTOGRAM_SHIFT) - 1u));
+
+  // ignore small changes of the range, so the table is not recalculated on every frame
+  const int tolerance = std::max(1, (maxValue - minValue) / 64);
+  if ((std::abs(minValue - m_minValue) > tolerance) ||
+      (std::abs(maxValue - m_maxValue) > tolerance))
+  {
+    m_minValue         = static_cast<uint16_t>(minValue);
+    m_maxValue         = static_cast<uint16_t>(std::max(minValue, maxValue));
+    m_lookUpTableValid = false;
+  }
+}
+
+void MapColorizer::updateLookUpTable()
+{
+  m_lookUpTable.resize(LUT_SIZE);
+
+  const float minValue  = static_cast<float>(m_minValue);
+  const float span      = std::max(1.f, static_cast<float>(m_maxValue) - minValue);
+  const float invGamma  = 1.f / m_gamma;
+  const bool applyGamma = (m_gamma != 1.f);
+
+  // Colors are evaluated on 1024 steps and shared by neighboring values, which is far below the
+  // visible resolution of any colormap but much cheaper than evaluating every entry.
+  const int numSteps = 1024;
+  uint32_t colors[numSteps + 1];
+  for (int step = 0; step <= numSteps; step++)
+  {
+    float t = static_cast<float>(step) / numSteps;
+    if (applyGamma)
+    {
+      t = std::pow(t, invGamma);
+    }
+    colors[step] = colormapColor(m_colormap, t);
+  }
+
+  for (std::size_t value = 0u; value < LUT_SIZE; ++value)
+  {
+    const float t        = clamp01((static_cast<float>(value) - minValue) / span);
+    m_lookUpTable[value] = colors[static_cast<int>(t * numSteps + 0.5f)];
+  }
+  m_lookUpTable[0]      = m_invalidColor;
+  m_lookUpTable[0xFFFF] = m_invalidColor;
+  m_lookUpTableValid    = true;
+}
+
+} // namespace visionary
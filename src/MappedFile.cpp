@@ -0,0 +1,177 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/MappedFile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace visionary {
+
+MappedFile::MappedFile()
+  : m_data(nullptr)
+  , m_size(0u)
+  , m_isOpen(false)
+#ifdef _WIN32
+  , m_fileHandle(INVALID_HANDLE_VALUE)
+  , m_mappingHandle(nullptr)
+#else
+  , m_fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+  close();
+
+#ifdef _WIN32
+  m_fileHandle = CreateFileA(fileName.c_str(),
+                             GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+  LARGE_INTEGER fileSize;
+  if ((INVALID_HANDLE_VALUE == m_fileHandle) || !GetFileSizeEx(m_fileHandle, &fileSize))
+  {
+    std::printf("Could not open %s\n", fileName.c_str());
+    close();
+    return false;
+  }
+  m_size = static_cast<std::size_t>(fileSize.QuadPart);
+  if (0u != m_size)
+  {
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (nullptr != m_mappingHandle)
+    {
+      m_data =
+        static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (nullptr == m_data)
+    {
+      std::printf("Could not map %s\n", fileName.c_str());
+      close();
+      return false;
+    }
+  }
+#else
+  m_fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+  struct stat fileStatus;
+  if ((m_fileDescriptor < 0) || (0 != fstat(m_fileDescriptor, &fileStatus)))
+  {
+    std::printf("Could not open %s\n", fileName.c_str());
+    close();
+    return false;
+  }
+  m_size = static_cast<std::size_t>(fileStatus.st_size);
+  if (0u != m_size)
+  {
+    void* pMapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fileDescriptor, 0);
+    if (MAP_FAILED == pMapping)
+    {
+      std::printf("Could not map %s\n", fileName.c_str());
+      close();
+      return false;
+    }
+    m_data = static_cast<const uint8_t*>(pMapping);
+  }
+#endif
+  m_isOpen = true;
+  return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+  if (nullptr != m_data)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (nullptr != m_mappingHandle)
+  {
+    CloseHandle(m_mappingHandle);
+    m_mappingHandle = nullptr;
+  }
+  if (INVALID_HANDLE_VALUE != m_fileHandle)
+  {
+    CloseHandle(m_fileHandle);
+    m_fileHandle = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (nullptr != m_data)
+  {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  if (m_fileDescriptor >= 0)
+  {
+    ::close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+  }
+#endif
+  m_data   = nullptr;
+  m_size   = 0u;
+  m_isOpen = false;
+}
+
+bool MappedFile::isOpen() const
+{
+  return m_isOpen;
+}
+
+const uint8_t* MappedFile::data() const
+{
+  return m_data;
+}
+
+std::size_t MappedFile::size() const
+{
+  return m_size;
+}
+
+void MappedFile::adviseSequential() const
+{
+#ifndef _WIN32
+  if (nullptr != m_data)
+  {
+    madvise(const_cast<uint8_t*>(m_data), m_size, MADV_SEQUENTIAL);
+  }
+#endif
+}
+
+} // namespace visionary
@@ -0,0 +1,200 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/OrganizedNormalEstimation.h"
+#include "sick_safevisionary_base/ParallelRows.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace visionary {
+
+namespace {
+const float bad_point = std::numeric_limits<float>::quiet_NaN();
+
+inline bool isValid(const PointXYZ& point)
+{
+  return !std::isnan(point.z);
+}
+
+inline float squaredDistance(const PointXYZ& a, const PointXYZ& b)
+{
+  const float dx = a.x - b.x;
+  const float dy = a.y - b.y;
+  const float dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+/// Tangent at the center point from its two neighbors in one image direction. Uses the central
+/// difference if both neighbors are usable, otherwise the one-sided difference.
+/// Returns false if none of the neighbors is usable.
+inline bool tangent(const PointXYZ& center,
+                    const PointXYZ* before,
+                    const PointXYZ* after,
+                    float maxSquaredDistance,
+                    PointXYZ& result)
+{
+  const bool useBefore =
+    (before != nullptr) && isValid(*before) && squaredDistance(center, *before) <= maxSquaredDistance;
+  const bool useAfter =
+    (after != nullptr) && isValid(*after) && squaredDistance(center, *after) <= maxSquaredDistance;
+  if (!useBefore && !useAfter)
+  {
+    return false;
+  }
+  const PointXYZ& from = useBefore ? *before : center;
+  const PointXYZ& to   = useAfter ? *after : center;
+  result.x             = to.x - from.x;
+  result.y             = to.y - from.y;
+  result.z             = to.z - from.z;
+  return true;
+}
+} // namespace
+
+OrganizedNormalEstimation::OrganizedNormalEstimation()
+  : m_neighborDistance(1)
+  , m_maxDepthChangeFactor(0.05f)
+  , m_viewpoint{0.f, 0.f, 0.f}
+  , m_numThreads(1u)
+{
+}
+
+OrganizedNormalEstimation::~OrganizedNormalEstimation() {}
+
+void OrganizedNormalEstimation::setNeighborDistance(int pixels)
+{
+  m_neighborDistance = std::max(1, pixels);
+}
+
+int OrganizedNormalEstimation::getNeighborDistance() const
+{
+  return m_neighborDistance;
+}
+
+void OrganizedNormalEstimation::setMaxDepthChangeFactor(float factor)
+{
+  m_maxDepthChangeFactor = factor;
+}
+
+float OrganizedNormalEstimation::getMaxDepthChangeFactor() const
+{
+  return m_maxDepthChangeFactor;
+}
+
+void OrganizedNormalEstimation::setViewpoint(float x, float y, float z)
+{
+  m_viewpoint.x = x;
+  m_viewpoint.y = y;
+  m_viewpoint.z = z;
+}
+
+void OrganizedNormalEstimation::setNumThreads(unsigned numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+void OrganizedNormalEstimation::compute(const std::vector<PointXYZ>& pointCloud,
+                                        int width,
+                                        int height,
+                                        std::vector<PointXYZ>& normals) const
+{
+  normals.resize(pointCloud.size());
+  if (pointCloud.size() != static_cast<size_t>(width * height))
+  {
+    // not an organized point cloud of the given size
+    PointXYZ badNormal = {bad_point, bad_point, bad_point};
+    std::fill(normals.begin(), normals.end(), badNormal);
+    return;
+  }
+
+  parallelForRows(height, m_numThreads, [&](int rowBegin, int rowEnd) {
+    computeRows(pointCloud, width, height, normals, rowBegin, rowEnd);
+  });
+}
+
+void OrganizedNormalEstimation::computeRows(const std::vector<PointXYZ>& pointCloud,
+                                            int width,
+                                            int height,
+                                            std::vector<PointXYZ>& normals,
+                                            int rowBegin,
+                                            int rowEnd) const
+{
+  const int k               = m_neighborDistance;
+  const float factorSquared = m_maxDepthChangeFactor * m_maxDepthChangeFactor * k * k;
+  const PointXYZ badNormal  = {bad_point, bad_point, bad_point};
+
+  for (int row = rowBegin; row < rowEnd; row++)
+  {
+    const PointXYZ* itRow  = pointCloud.data() + row * width;
+    const PointXYZ* itUp   = (row - k >= 0) ? itRow - k * width : nullptr;
+    const PointXYZ* itDown = (row + k < height) ? itRow + k * width : nullptr;
+    PointXYZ* itNormal     = normals.data() + row * width;
+
+    for (int col = 0; col < width; col++)
+    {
+      const PointXYZ& point = itRow[col];
+      itNormal[col]         = badNormal;
+      if (!isValid(point))
+      {
+        continue;
+      }
+
+      // neighbors further away than this are behind a depth discontinuity
+      const float rangeSquared       = point.x * point.x + point.y * point.y + point.z * point.z;
+      const float maxSquaredDistance = factorSquared * rangeSquared;
+
+      PointXYZ horizontal;
+      PointXYZ vertical;
+      const PointXYZ* left  = (col - k >= 0) ? &itRow[col - k] : nullptr;
+      const PointXYZ* right = (col + k < width) ? &itRow[col + k] : nullptr;
+      const PointXYZ* up    = (itUp != nullptr) ? &itUp[col] : nullptr;
+      const PointXYZ* down  = (itDown != nullptr) ? &itDown[col] : nullptr;
+      if (!tangent(point, left, right, maxSquaredDistance, horizontal) ||
+          !tangent(point, up, down, maxSquaredDistance, vertical))
+      {
+        continue;
+      }
+
+      PointXYZ normal;
+      normal.x          = horizontal.y * vertical.z - horizontal.z * vertical.y;
+      normal.y          = horizontal.z * vertical.x - horizontal.x * vertical.z;
+      normal.z          = horizontal.x * vertical.y - horizontal.y * vertical.x;
+      const float norm2 = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+      if (!(norm2 > 0.f))
+      {
+        continue;
+      }
+
+      // orient the normal towards the viewpoint
+      const float toViewpoint = (m_viewpoint.x - point.x) * normal.x +
+                                (m_viewpoint.y - point.y) * normal.y +
+                                (m_viewpoint.z - point.z) * normal.z;
+      const float scale = (toViewpoint < 0.f ? -1.f : 1.f) / std::sqrt(norm2);
+      normal.x *= scale;
+      normal.y *= scale;
+      normal.z *= scale;
+      itNormal[col] = normal;
+    }
+  }
+}
+
+} // namespace visionary
@@ -0,0 +1,187 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/ParallelRows.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace visionary {
+
+namespace {
+/// Gets the rows of a band; the remaining rows are distributed on the first bands
+void getBandRows(int band, int numRows, int numBands, int& rowBegin, int& rowEnd)
+{
+  const int rowsPerBand = numRows / numBands;
+  const int remainder   = numRows % numBands;
+  rowBegin              = band * rowsPerBand + std::min(band, remainder);
+  rowEnd                = rowBegin + rowsPerBand + (band < remainder ? 1 : 0);
+}
+
+/// Worker threads shared by all calls of parallelForRows. They are started on first use and kept
+/// until the program exits, so a call only has to wake them instead of starting threads.
+class RowThreadPool
+{
+public:
+  static RowThreadPool& instance()
+  {
+    static RowThreadPool pool;
+    return pool;
+  }
+
+  ~RowThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_jobSignal.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+      worker.join();
+    }
+  }
+
+  /// Processes all bands on the workers and the calling thread.
+  ///
+  /// \return false if the pool is used by another call, nothing has been processed then
+  bool run(int numRows,
+           int numBands,
+           const std::function<void(int rowBegin, int rowEnd)>& rowFunction)
+  {
+    std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+    if (!runLock.owns_lock())
+    {
+      return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_workers.size() + 1u < static_cast<std::size_t>(numBands))
+    {
+      m_workers.push_back(std::thread(&RowThreadPool::work, this));
+    }
+    m_rowFunction  = &rowFunction;
+    m_numRows      = numRows;
+    m_numBands     = numBands;
+    m_nextBand     = 0;
+    m_pendingBands = numBands;
+    m_jobSignal.notify_all();
+
+    // the calling thread processes bands as well
+    processBands(lock);
+    m_doneSignal.wait(lock, [this] { return m_pendingBands == 0; });
+    m_rowFunction = nullptr;
+    m_numBands    = 0;
+    m_nextBand    = 0;
+    return true;
+  }
+
+private:
+  RowThreadPool()
+    : m_rowFunction(nullptr)
+    , m_numRows(0)
+    , m_numBands(0)
+    , m_nextBand(0)
+    , m_pendingBands(0)
+    , m_stop(false)
+  {
+  }
+
+  /// Processes bands until none is left; the lock is held on entry and on return
+  void processBands(std::unique_lock<std::mutex>& lock)
+  {
+    while (m_nextBand < m_numBands)
+    {
+      const int band = m_nextBand++;
+      int rowBegin   = 0;
+      int rowEnd     = 0;
+      getBandRows(band, m_numRows, m_numBands, rowBegin, rowEnd);
+      const std::function<void(int rowBegin, int rowEnd)>& rowFunction = *m_rowFunction;
+
+      lock.unlock();
+      rowFunction(rowBegin, rowEnd);
+      lock.lock();
+
+      if (--m_pendingBands == 0)
+      {
+        m_doneSignal.notify_all();
+      }
+    }
+  }
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+      m_jobSignal.wait(lock, [this] { return m_stop || (m_nextBand < m_numBands); });
+      if (m_stop)
+      {
+        return;
+      }
+      processBands(lock);
+    }
+  }
+
+  /// Held by the call which uses the pool
+  std::mutex m_runMutex;
+
+  /// Protects the job below
+  std::mutex m_mutex;
+  std::condition_variable m_jobSignal;
+  std::condition_variable m_doneSignal;
+  std::vector<std::thread> m_workers;
+
+  const std::function<void(int rowBegin, int rowEnd)>* m_rowFunction;
+  int m_numRows;
+  int m_numBands;
+  int m_nextBand;
+  int m_pendingBands;
+  bool m_stop;
+};
+} // namespace
+
+void parallelForRows(int numRows,
+                     unsigned numThreads,
+                     const std::function<void(int rowBegin, int rowEnd)>& rowFunction)
+{
+  if (numRows <= 0)
+  {
+    return;
+  }
+  if (numThreads == 0u)
+  {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const int numBands = std::min(static_cast<int>(numThreads), numRows);
+  if ((numBands > 1) && RowThreadPool::instance().run(numRows, numBands, rowFunction))
+  {
+    return;
+  }
+
+  // single band, or the pool is busy with a concurrent or nested call
+  rowFunction(0, numRows);
+}
+
+} // namespace visionary
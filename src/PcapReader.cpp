@@ -0,0 +1,438 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/PcapReader.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace visionary {
+
+namespace {
+// magic numbers of pcap files with microsecond and nanosecond timestamps
+constexpr uint32_t PCAP_MAGIC_US              = 0xa1b2c3d4u;
+constexpr uint32_t PCAP_MAGIC_NS              = 0xa1b23c4du;
+constexpr std::size_t PCAP_FILE_HEADER_SIZE   = 24u;
+constexpr std::size_t PCAP_RECORD_HEADER_SIZE = 16u;
+
+// pcapng block types and the byte order magic of the section header
+constexpr uint32_t PCAPNG_SECTION_HEADER_BLOCK        = 0x0a0d0d0au;
+constexpr uint32_t PCAPNG_INTERFACE_BLOCK             = 0x00000001u;
+constexpr uint32_t PCAPNG_SIMPLE_PACKET_BLOCK         = 0x00000003u;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET_BLOCK       = 0x00000006u;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC            = 0x1a2b3c4du;
+constexpr uint16_t PCAPNG_OPTION_END                  = 0u;
+constexpr uint16_t PCAPNG_OPTION_TIMESTAMP_RESOLUTION = 9u;
+
+// link layer types, see https://www.tcpdump.org/linktypes.html
+constexpr uint16_t LINKTYPE_NULL       = 0u;
+constexpr uint16_t LINKTYPE_ETHERNET   = 1u;
+constexpr uint16_t LINKTYPE_RAW_OLD    = 12u;
+constexpr uint16_t LINKTYPE_RAW        = 101u;
+constexpr uint16_t LINKTYPE_LOOP       = 108u;
+constexpr uint16_t LINKTYPE_LINUX_SLL  = 113u;
+constexpr uint16_t LINKTYPE_IPV4       = 228u;
+constexpr uint16_t LINKTYPE_LINUX_SLL2 = 276u;
+
+constexpr uint16_t ETHERTYPE_IPV4   = 0x0800u;
+constexpr uint16_t ETHERTYPE_VLAN   = 0x8100u;
+constexpr uint16_t ETHERTYPE_QINQ   = 0x88a8u;
+constexpr uint32_t LOOPBACK_AF_INET = 2u;
+constexpr uint8_t IP_PROTOCOL_UDP   = 17u;
+
+constexpr uint64_t NANOSECONDS_PER_SECOND = 1000000000u;
+
+/// Converts a timestamp in ticks of the given resolution to ns
+uint64_t ticksToNanoseconds(uint64_t ticks, uint64_t ticksPerSecond)
+{
+  if (NANOSECONDS_PER_SECOND == ticksPerSecond)
+  {
+    return ticks;
+  }
+  // split to avoid an overflow of the multiplication
+  return (ticks / ticksPerSecond) * NANOSECONDS_PER_SECOND +
+         ((ticks % ticksPerSecond) * NANOSECONDS_PER_SECOND) / ticksPerSecond;
+}
+} // namespace
+
+PcapReader::PcapReader()
+  : m_isPcapng(false)
+  , m_swapped(false)
+  , m_position(0u)
+  , m_portFilter(0u)
+  , m_numPackets(0u)
+  , m_numSkipped(0u)
+{
+}
+
+PcapReader::~PcapReader() {}
+
+bool PcapReader::open(const std::string& fileName)
+{
+  close();
+  if (!m_file.open(fileName))
+  {
+    return false;
+  }
+  m_file.adviseSequential();
+
+  uint32_t magic{0u};
+  if (m_file.size() >= sizeof(magic))
+  {
+    std::memcpy(&magic, m_file.data(), sizeof(magic));
+  }
+
+  if ((PCAPNG_SECTION_HEADER_BLOCK == magic) && (m_file.size() >= 12u))
+  {
+    // the section header block sets byte order and interfaces
+    m_isPcapng = true;
+  }
+  else if (((PCAP_MAGIC_US == magic) || (PCAP_MAGIC_NS == magic) ||
+            (PCAP_MAGIC_US == byteswap(magic)) || (PCAP_MAGIC_NS == byteswap(magic))) &&
+           (m_file.size() >= PCAP_FILE_HEADER_SIZE))
+  {
+    m_swapped               = (PCAP_MAGIC_US != magic) && (PCAP_MAGIC_NS != magic);
+    const bool nanoseconds  = (PCAP_MAGIC_NS == magic) || (PCAP_MAGIC_NS == byteswap(magic));
+    const Interface capture = {static_cast<uint16_t>(read32(m_file.data() + 20u) & 0xffffu),
+                               nanoseconds ? NANOSECONDS_PER_SECOND : 1000000u};
+    m_interfaces.push_back(capture);
+  }
+  else
+  {
+    std::printf("%s is no pcap or pcapng file\n", fileName.c_str());
+    close();
+    return false;
+  }
+  rewind();
+  return true;
+}
+
+void PcapReader::close()
+{
+  m_file.close();
+  m_interfaces.clear();
+  m_isPcapng   = false;
+  m_swapped    = false;
+  m_position   = 0u;
+  m_numPackets = 0u;
+  m_numSkipped = 0u;
+}
+
+void PcapReader::setPortFilter(uint16_t port)
+{
+  m_portFilter = port;
+}
+
+bool PcapReader::nextDatagram(PcapUdpDatagram& datagram)
+{
+  const uint8_t* pPacket{nullptr};
+  std::size_t packetSize{0u};
+  uint64_t timestamp{0u};
+  uint16_t linkType{0u};
+  while (nextPacket(pPacket, packetSize, timestamp, linkType))
+  {
+    m_numPackets++;
+    if (decodePacket(pPacket, packetSize, linkType, datagram) &&
+        ((0u == m_portFilter) || (m_portFilter == datagram.destPort)))
+    {
+      datagram.timestamp = timestamp;
+      return true;
+    }
+    m_numSkipped++;
+  }
+  return false;
+}
+
+void PcapReader::rewind()
+{
+  m_position   = m_isPcapng ? 0u : PCAP_FILE_HEADER_SIZE;
+  m_numPackets = 0u;
+  m_numSkipped = 0u;
+  if (m_isPcapng)
+  {
+    m_interfaces.clear();
+  }
+}
+
+uint64_t PcapReader::getNumPackets() const
+{
+  return m_numPackets;
+}
+
+uint64_t PcapReader::getNumSkipped() const
+{
+  return m_numSkipped;
+}
+
+bool PcapReader::nextPacket(const uint8_t*& data,
+                            std::size_t& size,
+                            uint64_t& timestamp,
+                            uint16_t& linkType)
+{
+  return m_isPcapng ? nextPcapngPacket(data, size, timestamp, linkType)
+                    : nextPcapPacket(data, size, timestamp, linkType);
+}
+
+bool PcapReader::nextPcapPacket(const uint8_t*& data,
+                                std::size_t& size,
+                                uint64_t& timestamp,
+                                uint16_t& linkType)
+{
+  if (m_position + PCAP_RECORD_HEADER_SIZE > m_file.size())
+  {
+    return false;
+  }
+  const uint8_t* pRecord      = m_file.data() + m_position;
+  const uint32_t seconds      = read32(pRecord);
+  const uint32_t fraction     = read32(pRecord + 4u);
+  const uint32_t capturedSize = read32(pRecord + 8u);
+  if (m_position + PCAP_RECORD_HEADER_SIZE + capturedSize > m_file.size())
+  {
+    // capture has been cut off
+    return false;
+  }
+  const Interface& capture = m_interfaces.front();
+  data                     = pRecord + PCAP_RECORD_HEADER_SIZE;
+  size                     = capturedSize;
+  timestamp =
+    seconds * NANOSECONDS_PER_SECOND + ticksToNanoseconds(fraction, capture.ticksPerSecond);
+  linkType = capture.linkType;
+  m_position += PCAP_RECORD_HEADER_SIZE + capturedSize;
+  return true;
+}
+
+bool PcapReader::nextPcapngPacket(const uint8_t*& data,
+                                  std::size_t& size,
+                                  uint64_t& timestamp,
+                                  uint16_t& linkType)
+{
+  // block type, block length, body, block length
+  while (m_position + 12u <= m_file.size())
+  {
+    const uint8_t* pBlock = m_file.data() + m_position;
+    uint32_t blockType{0u};
+    std::memcpy(&blockType, pBlock, sizeof(blockType));
+    if (PCAPNG_SECTION_HEADER_BLOCK == blockType)
+    {
+      // a new section, possibly of another byte order
+      uint32_t byteOrderMagic{0u};
+      std::memcpy(&byteOrderMagic, pBlock + 8u, sizeof(byteOrderMagic));
+      m_swapped = (PCAPNG_BYTE_ORDER_MAGIC != byteOrderMagic);
+      m_interfaces.clear();
+    }
+    blockType                  = read32(pBlock);
+    const uint32_t blockLength = read32(pBlock + 4u);
+    if ((blockLength < 12u) || (m_position + blockLength > m_file.size()))
+    {
+      // damaged or cut off capture
+      return false;
+    }
+    const uint8_t* pBody       = pBlock + 8u;
+    const std::size_t bodySize = blockLength - 12u;
+    m_position += blockLength;
+
+    if ((PCAPNG_INTERFACE_BLOCK == blockType) && (bodySize >= 8u))
+    {
+      const Interface capture = {read16(pBody),
+                                 parseTimestampResolution(pBody + 8u, bodySize - 8u)};
+      m_interfaces.push_back(capture);
+    }
+    else if ((PCAPNG_ENHANCED_PACKET_BLOCK == blockType) && (bodySize >= 20u))
+    {
+      // timestamp is split into upper and lower 32 bits
+      const uint32_t interfaceId  = read32(pBody);
+      const uint64_t ticks        = (uint64_t(read32(pBody + 4u)) << 32u) | read32(pBody + 8u);
+      const uint32_t capturedSize = read32(pBody + 12u);
+      if ((interfaceId < m_interfaces.size()) && (20u + capturedSize <= bodySize))
+      {
+        const Interface& capture = m_interfaces[interfaceId];
+        data                     = pBody + 20u;
+        size                     = capturedSize;
+        timestamp                = ticksToNanoseconds(ticks, capture.ticksPerSecond);
+        linkType                 = capture.linkType;
+        return true;
+      }
+    }
+    else if ((PCAPNG_SIMPLE_PACKET_BLOCK == blockType) && (bodySize >= 4u) &&
+             !m_interfaces.empty())
+    {
+      // no timestamp, the captured size is limited by the block
+      data      = pBody + 4u;
+      size      = std::min<std::size_t>(read32(pBody), bodySize - 4u);
+      timestamp = 0u;
+      linkType  = m_interfaces.front().linkType;
+      return true;
+    }
+    // other blocks do not contain packets
+  }
+  return false;
+}
+
+uint64_t PcapReader::parseTimestampResolution(const uint8_t* options, std::size_t size) const
+{
+  std::size_t position = 0u;
+  while (position + 4u <= size)
+  {
+    const uint16_t code   = read16(options + position);
+    const uint16_t length = read16(options + position + 2u);
+    if ((PCAPNG_OPTION_END == code) || (position + 4u + length > size))
+    {
+      break;
+    }
+    if ((PCAPNG_OPTION_TIMESTAMP_RESOLUTION == code) && (1u == length))
+    {
+      // negative power of 10, or of 2 if the most significant bit is set
+      const uint8_t resolution = options[position + 4u];
+      const uint8_t exponent   = resolution & 0x7fu;
+      if (0u != (resolution & 0x80u))
+      {
+        return uint64_t(1u) << std::min<uint8_t>(exponent, 63u);
+      }
+      uint64_t ticksPerSecond = 1u;
+      for (uint8_t i = 0u; i < std::min<uint8_t>(exponent, 19u); i++)
+      {
+        ticksPerSecond *= 10u;
+      }
+      return ticksPerSecond;
+    }
+    // values are padded to 32 bit
+    position += 4u + ((length + 3u) & ~3u);
+  }
+  return 1000000u;
+}
+
+bool PcapReader::decodePacket(const uint8_t* data,
+                              std::size_t size,
+                              uint16_t linkType,
+                              PcapUdpDatagram& datagram) const
+{
+  // link layer
+  std::size_t offset{0u};
+  uint16_t etherType{0u};
+  switch (linkType)
+  {
+    case LINKTYPE_ETHERNET:
+      if (size < 14u)
+      {
+        return false;
+      }
+      etherType = readUnalignBigEndian<uint16_t>(data + 12u);
+      offset    = 14u;
+      while (((ETHERTYPE_VLAN == etherType) || (ETHERTYPE_QINQ == etherType)) &&
+             (offset + 4u <= size))
+      {
+        etherType = readUnalignBigEndian<uint16_t>(data + offset + 2u);
+        offset += 4u;
+      }
+      break;
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+    {
+      if (size < 4u)
+      {
+        return false;
+      }
+      // address family, in the byte order of the capturing host resp. big-endian
+      const uint32_t family =
+        (LINKTYPE_NULL == linkType) ? read32(data) : readUnalignBigEndian<uint32_t>(data);
+      etherType = (LOOPBACK_AF_INET == family) ? ETHERTYPE_IPV4 : 0u;
+      offset    = 4u;
+      break;
+    }
+    case LINKTYPE_RAW_OLD:
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+      etherType = ((size > 0u) && (4u == (data[0] >> 4u))) ? ETHERTYPE_IPV4 : 0u;
+      break;
+    case LINKTYPE_LINUX_SLL:
+      if (size < 16u)
+      {
+        return false;
+      }
+      etherType = readUnalignBigEndian<uint16_t>(data + 14u);
+      offset    = 16u;
+      break;
+    case LINKTYPE_LINUX_SLL2:
+      if (size < 20u)
+      {
+        return false;
+      }
+      etherType = readUnalignBigEndian<uint16_t>(data);
+      offset    = 20u;
+      break;
+    default:
+      return false;
+  }
+  if (ETHERTYPE_IPV4 != etherType)
+  {
+    return false;
+  }
+
+  // IPv4 header
+  const uint8_t* pIp       = data + offset;
+  const std::size_t ipSize = size - offset;
+  if ((ipSize < 20u) || (4u != (pIp[0] >> 4u)))
+  {
+    return false;
+  }
+  const std::size_t headerLength = (pIp[0] & 0x0fu) * 4u;
+  const std::size_t totalLength  = readUnalignBigEndian<uint16_t>(pIp + 2u);
+  const uint16_t fragmentation   = readUnalignBigEndian<uint16_t>(pIp + 6u);
+  // IP fragments (more fragments flag or fragment offset) can not be decoded on their own
+  if ((headerLength < 20u) || (totalLength > ipSize) || (headerLength + 8u > totalLength) ||
+      (0u != (fragmentation & 0x3fffu)) || (IP_PROTOCOL_UDP != pIp[9]))
+  {
+    return false;
+  }
+
+  // UDP header
+  const uint8_t* pUdp      = pIp + headerLength;
+  const std::size_t length = readUnalignBigEndian<uint16_t>(pUdp + 4u);
+  if ((length < 8u) || (headerLength + length > totalLength))
+  {
+    return false;
+  }
+  datagram.data          = pUdp + 8u;
+  datagram.size          = length - 8u;
+  datagram.sourceAddress = readUnalignBigEndian<uint32_t>(pIp + 12u);
+  datagram.destAddress   = readUnalignBigEndian<uint32_t>(pIp + 16u);
+  datagram.sourcePort    = readUnalignBigEndian<uint16_t>(pUdp);
+  datagram.destPort      = readUnalignBigEndian<uint16_t>(pUdp + 2u);
+  return true;
+}
+
+uint16_t PcapReader::read16(const uint8_t* ptr) const
+{
+  uint16_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return m_swapped ? byteswap(value) : value;
+}
+
+uint32_t PcapReader::read32(const uint8_t* ptr) const
+{
+  uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return m_swapped ? byteswap(value) : value;
+}
+
+} // namespace visionary
@@ -0,0 +1,124 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/PcapTransport.h"
+#include "sick_safevisionary_base/BlobRecorder.h"
+#include "sick_safevisionary_base/SafeVisionaryData.h"
+#include "sick_safevisionary_base/SafeVisionaryDataStream.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace visionary {
+
+PcapTransport::PcapTransport(std::shared_ptr<PcapReader> reader)
+  : m_reader(reader)
+  , m_timestamp(0u)
+  , m_shutdown(false)
+{
+}
+
+PcapTransport::~PcapTransport() {}
+
+uint64_t PcapTransport::getTimestamp() const
+{
+  return m_timestamp;
+}
+
+int PcapTransport::send(const std::vector<std::uint8_t>& buffer)
+{
+  return static_cast<int>(buffer.size());
+}
+
+int PcapTransport::recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive)
+{
+  PcapUdpDatagram datagram;
+  do
+  {
+    if (m_shutdown || !m_reader->nextDatagram(datagram))
+    {
+      // end of the capture, like a closed connection
+      buffer.clear();
+      return 0;
+    }
+    // datagrams which can not hold a UDP header are skipped, an empty one would read as the end
+  } while (datagram.size < sizeof(UdpDataHeader) + sizeof(uint32_t));
+  m_timestamp = datagram.timestamp;
+
+  // like a datagram socket, the rest of a datagram which does not fit is discarded
+  const std::size_t receiveSize = std::min(datagram.size, maxBytesToReceive);
+  buffer.resize(receiveSize);
+  std::memcpy(buffer.data(), datagram.data, receiveSize);
+  return static_cast<int>(receiveSize);
+}
+
+int PcapTransport::read(std::vector<std::uint8_t>& buffer, std::size_t nBytesToReceive)
+{
+  return recv(buffer, nBytesToReceive);
+}
+
+int PcapTransport::shutdown()
+{
+  m_shutdown = true;
+  return 0;
+}
+
+bool convertPcapToBlobLog(const std::string& captureFile, uint16_t port, const std::string& logFile)
+{
+  std::shared_ptr<PcapReader> reader = std::make_shared<PcapReader>();
+  if (!reader->open(captureFile))
+  {
+    return false;
+  }
+  reader->setPortFilter(port);
+
+  std::unique_ptr<PcapTransport> transport(new PcapTransport(reader));
+  const PcapTransport* pTransport = transport.get();
+
+  // an offline conversion must not lose Blobs
+  std::shared_ptr<BlobRecorder> recorder = std::make_shared<BlobRecorder>();
+  recorder->setBlockWhenFull(true);
+  recorder->setClock([pTransport]() { return pTransport->getTimestamp(); });
+  if (!recorder->open(logFile))
+  {
+    return false;
+  }
+
+  SafeVisionaryDataStream dataStream(std::make_shared<SafeVisionaryData>());
+  dataStream.setRecorder(recorder);
+  dataStream.openUdpConnection(std::move(transport));
+  while (dataStream.getNextBlobUdp() ||
+         (DataStreamError::CONNECTION_CLOSED != dataStream.getLastError()))
+  {
+  }
+  dataStream.setRecorder(nullptr);
+  recorder->close();
+
+  std::printf("Converted %llu Blobs from %llu packets of %s\n",
+              static_cast<unsigned long long>(recorder->getNumRecorded()),
+              static_cast<unsigned long long>(reader->getNumPackets()),
+              captureFile.c_str());
+  return true;
+}
+
+} // namespace visionary
@@ -0,0 +1,295 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/PixelMask.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define PIXEL_MASK_SSE2
+#endif
+
+namespace visionary {
+
+namespace {
+inline unsigned popCount(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+  word = word - ((word >> 1) & 0x5555555555555555ull);
+  word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return static_cast<unsigned>((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline bool isSizeValid(const std::vector<uint8_t>& stateMap, int width, int height)
+{
+  return (width > 0) && (height > 0) &&
+         (stateMap.size() == static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+}
+} // namespace
+
+PixelMask::PixelMask()
+  : m_width(0)
+  , m_height(0)
+  , m_wordsPerRow(0)
+{
+}
+
+PixelMask::~PixelMask() {}
+
+void PixelMask::resize(int width, int height)
+{
+  m_width       = std::max(0, width);
+  m_height      = std::max(0, height);
+  m_wordsPerRow = (m_width + 63) / 64;
+  m_words.assign(static_cast<std::size_t>(m_wordsPerRow) * m_height, 0u);
+}
+
+int PixelMask::getWidth() const
+{
+  return m_width;
+}
+
+int PixelMask::getHeight() const
+{
+  return m_height;
+}
+
+int PixelMask::getWordsPerRow() const
+{
+  return m_wordsPerRow;
+}
+
+std::vector<uint64_t>& PixelMask::getWords()
+{
+  return m_words;
+}
+
+const std::vector<uint64_t>& PixelMask::getWords() const
+{
+  return m_words;
+}
+
+bool PixelMask::get(int col, int row) const
+{
+  if ((col < 0) || (col >= m_width) || (row < 0) || (row >= m_height))
+  {
+    return false;
+  }
+  return ((m_words[row * m_wordsPerRow + col / 64] >> (col % 64)) & 1u) != 0u;
+}
+
+void PixelMask::set(int col, int row, bool value)
+{
+  if ((col < 0) || (col >= m_width) || (row < 0) || (row >= m_height))
+  {
+    return;
+  }
+  uint64_t& word     = m_words[row * m_wordsPerRow + col / 64];
+  const uint64_t bit = uint64_t(1) << (col % 64);
+  word               = value ? (word | bit) : (word & ~bit);
+}
+
+std::size_t PixelMask::count() const
+{
+  std::size_t numSet = 0u;
+  for (std::vector<uint64_t>::const_iterator it = m_words.begin(); it != m_words.end(); ++it)
+  {
+    numSet += popCount(*it);
+  }
+  return numSet;
+}
+
+std::size_t PixelMask::countRow(int row) const
+{
+  if ((row < 0) || (row >= m_height))
+  {
+    return 0u;
+  }
+  const uint64_t* itRow = m_words.data() + row * m_wordsPerRow;
+  std::size_t numSet    = 0u;
+  for (int i = 0; i < m_wordsPerRow; i++)
+  {
+    numSet += popCount(itRow[i]);
+  }
+  return numSet;
+}
+
+void PixelMask::getRuns(int row, std::vector<PixelRun>& runs) const
+{
+  runs.clear();
+  if ((row < 0) || (row >= m_height))
+  {
+    return;
+  }
+  const uint64_t* itRow = m_words.data() + row * m_wordsPerRow;
+  PixelRun run          = {0, 0};
+  for (int i = 0; i < m_wordsPerRow; i++)
+  {
+    const uint64_t word = itRow[i];
+    // whole words without a change of the state are handled at once
+    if ((word == 0u) && (run.length == 0))
+    {
+      continue;
+    }
+    if ((word == ~uint64_t(0)) && (run.length != 0))
+    {
+      run.length += 64;
+      continue;
+    }
+    for (int bit = 0; bit < 64; bit++)
+    {
+      if (((word >> bit) & 1u) != 0u)
+      {
+        if (run.length == 0)
+        {
+          run.begin = i * 64 + bit;
+        }
+        ++run.length;
+      }
+      else if (run.length != 0)
+      {
+        runs.push_back(run);
+        run.length = 0;
+      }
+    }
+  }
+  if (run.length != 0)
+  {
+    runs.push_back(run);
+  }
+}
+
+void PixelMask::andWith(const PixelMask& other)
+{
+  const std::size_t numWords = std::min(m_words.size(), other.m_words.size());
+  for (std::size_t i = 0u; i < numWords; ++i)
+  {
+    m_words[i] &= other.m_words[i];
+  }
+}
+
+void PixelMask::orWith(const PixelMask& other)
+{
+  const std::size_t numWords = std::min(m_words.size(), other.m_words.size());
+  for (std::size_t i = 0u; i < numWords; ++i)
+  {
+    m_words[i] |= other.m_words[i];
+  }
+}
+
+void PixelMask::andNotWith(const PixelMask& other)
+{
+  const std::size_t numWords = std::min(m_words.size(), other.m_words.size());
+  for (std::size_t i = 0u; i < numWords; ++i)
+  {
+    m_words[i] &= ~other.m_words[i];
+  }
+}
+
+bool PixelMask::decode(const std::vector<uint8_t>& stateMap, int width, int height, uint8_t flags)
+{
+  if (!isSizeValid(stateMap, width, height))
+  {
+    return false;
+  }
+  resize(width, height);
+
+  for (int row = 0; row < height; row++)
+  {
+    const uint8_t* itState = stateMap.data() + static_cast<std::size_t>(row) * width;
+    uint64_t* itWords      = m_words.data() + row * m_wordsPerRow;
+    int col                = 0;
+#ifdef PIXEL_MASK_SSE2
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i flagsMask = _mm_set1_epi8(static_cast<char>(flags));
+    for (; col + 16 <= width; col += 16)
+    {
+      // one bit per byte whose state has none of the flags, inverted afterwards
+      const __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(itState + col));
+      const __m128i clear = _mm_cmpeq_epi8(_mm_and_si128(state, flagsMask), zero);
+      const uint64_t bits = ~static_cast<uint32_t>(_mm_movemask_epi8(clear)) & 0xFFFFu;
+      itWords[col / 64] |= bits << (col % 64);
+    }
+#endif
+    for (; col < width; col++)
+    {
+      if ((itState[col] & flags) != 0u)
+      {
+        itWords[col / 64] |= uint64_t(1) << (col % 64);
+      }
+    }
+  }
+  return true;
+}
+
+bool PixelMask::decodeAll(const std::vector<uint8_t>& stateMap,
+                          int width,
+                          int height,
+                          PixelMask masks[8])
+{
+  if (!isSizeValid(stateMap, width, height))
+  {
+    return false;
+  }
+  for (int bit = 0; bit < 8; bit++)
+  {
+    masks[bit].resize(width, height);
+  }
+  const int wordsPerRow = masks[0].m_wordsPerRow;
+
+  for (int row = 0; row < height; row++)
+  {
+    const uint8_t* itState      = stateMap.data() + static_cast<std::size_t>(row) * width;
+    const std::size_t rowOffset = static_cast<std::size_t>(row) * wordsPerRow;
+    int col                     = 0;
+#ifdef PIXEL_MASK_SSE2
+    for (; col + 16 <= width; col += 16)
+    {
+      __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(itState + col));
+      // Move bit 7 down to bit 0 into the sign bit of each byte. The 16 bit shift moves bits of
+      // the lower byte into the upper byte, but never into its sign bit.
+      for (int bit = 7; bit >= 0; bit--)
+      {
+        const uint64_t bits = static_cast<uint32_t>(_mm_movemask_epi8(state));
+        masks[bit].m_words[rowOffset + col / 64] |= bits << (col % 64);
+        state = _mm_slli_epi16(state, 1);
+      }
+    }
+#endif
+    for (; col < width; col++)
+    {
+      const uint8_t state = itState[col];
+      for (int bit = 0; bit < 8; bit++)
+      {
+        masks[bit].m_words[rowOffset + col / 64] |= static_cast<uint64_t>((state >> bit) & 1u)
+                                                    << (col % 64);
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace visionary
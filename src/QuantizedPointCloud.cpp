@@ -0,0 +1,252 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/QuantizedPointCloud.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define QUANTIZED_POINT_CLOUD_SSE2
+#endif
+
+namespace visionary {
+
+namespace {
+/// Largest representable coordinate, INVALID_VALUE is excluded from the range on purpose
+constexpr float MAX_QUANTIZED = 32767.f;
+
+/// Quantizes count consecutive float values
+void quantizeBlock(const float* src, int16_t* dst, std::size_t count, float invUnit)
+{
+  std::size_t i = 0u;
+#ifdef QUANTIZED_POINT_CLOUD_SSE2
+  const __m128 scale = _mm_set1_ps(invUnit);
+  const __m128 upper = _mm_set1_ps(MAX_QUANTIZED);
+  const __m128 lower = _mm_set1_ps(-MAX_QUANTIZED);
+  for (; i + 8u <= count; i += 8u)
+  {
+    // min/max return their second operand for NaN, so NaN is kept for the conversion, which
+    // turns it into 0x80000000. Saturated packing results in INVALID_VALUE then.
+    __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4u), scale);
+    lo        = _mm_min_ps(upper, _mm_max_ps(lower, lo));
+    hi        = _mm_min_ps(upper, _mm_max_ps(lower, hi));
+    const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+#endif
+  for (; i < count; i++)
+  {
+    dst[i] = QuantizedPointCloud::quantize(src[i], invUnit);
+  }
+}
+
+/// Converts count consecutive quantized values back to floats
+void dequantizeBlock(const int16_t* src, float* dst, std::size_t count, float unit)
+{
+  const float badPoint = std::numeric_limits<float>::quiet_NaN();
+  std::size_t i        = 0u;
+#ifdef QUANTIZED_POINT_CLOUD_SSE2
+  const __m128 scale    = _mm_set1_ps(unit);
+  const __m128 nan      = _mm_set1_ps(badPoint);
+  const __m128i invalid = _mm_set1_epi32(QuantizedPointCloud::INVALID_VALUE);
+  for (; i + 8u <= count; i += 8u)
+  {
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // sign extension to 32 bit
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+
+    const __m128 maskLo = _mm_castsi128_ps(_mm_cmpeq_epi32(lo, invalid));
+    const __m128 maskHi = _mm_castsi128_ps(_mm_cmpeq_epi32(hi, invalid));
+    const __m128 resLo  = _mm_mul_ps(_mm_cvtepi32_ps(lo), scale);
+    const __m128 resHi  = _mm_mul_ps(_mm_cvtepi32_ps(hi), scale);
+    _mm_storeu_ps(dst + i, _mm_or_ps(_mm_and_ps(maskLo, nan), _mm_andnot_ps(maskLo, resLo)));
+    _mm_storeu_ps(dst + i + 4u, _mm_or_ps(_mm_and_ps(maskHi, nan), _mm_andnot_ps(maskHi, resHi)));
+  }
+#endif
+  for (; i < count; i++)
+  {
+    dst[i] = (src[i] == QuantizedPointCloud::INVALID_VALUE) ? badPoint
+                                                            : static_cast<float>(src[i]) * unit;
+  }
+}
+} // namespace
+
+const int16_t QuantizedPointCloud::INVALID_VALUE;
+const uint32_t QuantizedPointCloud::HEADER_MAGIC;
+const uint16_t QuantizedPointCloud::HEADER_VERSION;
+
+QuantizedPointCloud::QuantizedPointCloud(float unit)
+  : m_unit(unit)
+  , m_width(0u)
+  , m_height(0u)
+{
+}
+
+QuantizedPointCloud::~QuantizedPointCloud() {}
+
+void QuantizedPointCloud::setUnit(float unit)
+{
+  m_unit = unit;
+}
+
+float QuantizedPointCloud::getUnit() const
+{
+  return m_unit;
+}
+
+void QuantizedPointCloud::resize(uint32_t width, uint32_t height)
+{
+  m_width  = width;
+  m_height = height;
+  m_points.resize(static_cast<std::size_t>(width) * height);
+}
+
+uint32_t QuantizedPointCloud::getWidth() const
+{
+  return m_width;
+}
+
+uint32_t QuantizedPointCloud::getHeight() const
+{
+  return m_height;
+}
+
+std::vector<PointXYZ16>& QuantizedPointCloud::getPoints()
+{
+  return m_points;
+}
+
+const std::vector<PointXYZ16>& QuantizedPointCloud::getPoints() const
+{
+  return m_points;
+}
+
+int16_t QuantizedPointCloud::quantize(float value, float invUnit)
+{
+  const float scaled = value * invUnit;
+  if (std::isnan(scaled))
+  {
+    return INVALID_VALUE;
+  }
+  return static_cast<int16_t>(
+    std::lrint(std::min(MAX_QUANTIZED, std::max(-MAX_QUANTIZED, scaled))));
+}
+
+void QuantizedPointCloud::fromPointCloud(const std::vector<PointXYZ>& pointCloud,
+                                         uint32_t width,
+                                         uint32_t height)
+{
+  if (static_cast<std::size_t>(width) * height != pointCloud.size())
+  {
+    width  = static_cast<uint32_t>(pointCloud.size());
+    height = 1u;
+  }
+  resize(width, height);
+  if (pointCloud.empty())
+  {
+    return;
+  }
+
+  // PointXYZ and PointXYZ16 are plain arrays of coordinates, so all coordinates can be converted
+  // in one go
+  quantizeBlock(&pointCloud[0].x, &m_points[0].x, 3u * pointCloud.size(), 1.f / m_unit);
+}
+
+void QuantizedPointCloud::toPointCloud(std::vector<PointXYZ>& pointCloud) const
+{
+  pointCloud.resize(m_points.size());
+  if (m_points.empty())
+  {
+    return;
+  }
+  dequantizeBlock(&m_points[0].x, &pointCloud[0].x, 3u * m_points.size(), m_unit);
+}
+
+void QuantizedPointCloud::serialize(std::vector<uint8_t>& buffer) const
+{
+  QuantizedPointCloudHeader header;
+  header.magic     = nativeToLittleEndian(HEADER_MAGIC);
+  header.version   = nativeToLittleEndian(HEADER_VERSION);
+  header.reserved  = 0u;
+  header.width     = nativeToLittleEndian(m_width);
+  header.height    = nativeToLittleEndian(m_height);
+  header.unit      = nativeToLittleEndian(m_unit);
+  header.numPoints = nativeToLittleEndian(static_cast<uint32_t>(m_points.size()));
+
+  const std::size_t numBytesPoints = m_points.size() * sizeof(PointXYZ16);
+  buffer.resize(sizeof(header) + numBytesPoints);
+  memcpy(&buffer[0], &header, sizeof(header));
+  if (numBytesPoints != 0u)
+  {
+    memcpy(&buffer[sizeof(header)], m_points.data(), numBytesPoints);
+  }
+#ifndef ENDIAN_LITTLE
+  for (std::size_t offset = sizeof(header); offset < buffer.size(); offset += sizeof(int16_t))
+  {
+    const int16_t value = nativeToLittleEndian(readUnaligned<int16_t>(&buffer[offset]));
+    memcpy(&buffer[offset], &value, sizeof(value));
+  }
+#endif
+}
+
+bool QuantizedPointCloud::deserialize(const uint8_t* data, std::size_t size)
+{
+  if (size < sizeof(QuantizedPointCloudHeader))
+  {
+    return false;
+  }
+  const QuantizedPointCloudHeader* pHeader =
+    reinterpret_cast<const QuantizedPointCloudHeader*>(data);
+  if (readUnalignLittleEndian<uint32_t>(&pHeader->magic) != HEADER_MAGIC ||
+      readUnalignLittleEndian<uint16_t>(&pHeader->version) != HEADER_VERSION)
+  {
+    return false;
+  }
+
+  const uint32_t width     = readUnalignLittleEndian<uint32_t>(&pHeader->width);
+  const uint32_t height    = readUnalignLittleEndian<uint32_t>(&pHeader->height);
+  const uint32_t numPoints = readUnalignLittleEndian<uint32_t>(&pHeader->numPoints);
+  if ((static_cast<std::size_t>(width) * height != numPoints) ||
+      (size < sizeof(QuantizedPointCloudHeader) + numPoints * sizeof(PointXYZ16)))
+  {
+    return false;
+  }
+
+  m_unit = readUnalignLittleEndian<float>(&pHeader->unit);
+  resize(width, height);
+  for (std::size_t i = 0u; i < m_points.size(); i++)
+  {
+    const uint8_t* pPoint = data + sizeof(QuantizedPointCloudHeader) + i * sizeof(PointXYZ16);
+    m_points[i].x         = readUnalignLittleEndian<int16_t>(pPoint);
+    m_points[i].y         = readUnalignLittleEndian<int16_t>(pPoint + 2);
+    m_points[i].z         = readUnalignLittleEndian<int16_t>(pPoint + 4);
+  }
+  return true;
+}
+
+} // namespace visionary
@@ -36,14 +36,16 @@ SafeVisionaryControl::SafeVisionaryControl() {}
 
 SafeVisionaryControl::~SafeVisionaryControl() {}
 
-bool SafeVisionaryControl::open(const std::string& hostname, uint8_t sessionTimeout_s)
+bool SafeVisionaryControl::open(const std::string& hostname,
+                                uint8_t sessionTimeout_s,
+                                uint16_t port)
 {
   m_pProtocolHandler = nullptr;
   m_pTransport       = nullptr;
 
   std::unique_ptr<TcpSocket> pTransport(new TcpSocket());
 
-  if (pTransport->connect(hostname, htons(COLA_2)) != 0)
+  if (pTransport->connect(hostname, htons(port)) != 0)
   {
     return false;
   }
@@ -19,6 +19,7 @@
 */
 // -- END LICENSE BLOCK ------------------------------------------------
 
+#include <algorithm>
 #include <cstdio>
 
 #include "sick_safevisionary_base/CRC.h"
@@ -63,6 +64,66 @@ constexpr std::uint16_t INTRUDED_PIXEL_STATE_VALID_FLAG = 1u << 1;
 /** Flag whether data stream is throttled or not  */
 constexpr std::uint16_t DATA_STREAM_THROTTLED_FLAG = 1u << 2;
 
+/// Number of pixels copied at once while the statistics are calculated, small enough to keep the
+/// copied values in the L1 cache for the statistics
+constexpr size_t STATISTICS_CHUNK_SIZE = 2048u;
+
+/// Resets the statistics of a map, keeping the size of the histogram
+void resetStatistics(MapStatistics& statistics)
+{
+  statistics.minValue   = 0u;
+  statistics.maxValue   = 0u;
+  statistics.mean       = 0.f;
+  statistics.numValid   = 0u;
+  statistics.numInvalid = 0u;
+  std::fill(statistics.histogram.begin(), statistics.histogram.end(), 0u);
+}
+
+/// Copies a map out of the Blob in chunks and calculates its statistics on each chunk while it is
+/// still in the cache
+void copyMapWithStatistics(const uint8_t* src,
+                           size_t numPixel,
+                           std::vector<uint16_t>& map,
+                           MapStatistics& statistics)
+{
+  resetStatistics(statistics);
+  uint32_t* histogram = statistics.histogram.data();
+  const int shift     = statistics.histogramShift;
+  uint16_t minValue   = 0xFFFFu;
+  uint16_t maxValue   = 0u;
+  uint64_t sum        = 0u;
+  uint32_t numValid   = 0u;
+
+  for (size_t chunkBegin = 0u; chunkBegin < numPixel; chunkBegin += STATISTICS_CHUNK_SIZE)
+  {
+    const size_t chunkSize = std::min(STATISTICS_CHUNK_SIZE, numPixel - chunkBegin);
+    uint16_t* chunk        = &map[chunkBegin];
+    memcpy(chunk, src + chunkBegin * sizeof(uint16_t), chunkSize * sizeof(uint16_t));
+    for (size_t i = 0u; i < chunkSize; ++i)
+    {
+      const uint16_t value = chunk[i];
+      if (value == 0 || value == uint16_t(0xFFFF))
+      {
+        continue;
+      }
+      minValue = std::min(minValue, value);
+      maxValue = std::max(maxValue, value);
+      sum += value;
+      ++numValid;
+      ++histogram[value >> shift];
+    }
+  }
+
+  statistics.numValid   = numValid;
+  statistics.numInvalid = static_cast<uint32_t>(numPixel) - numValid;
+  if (numValid != 0u)
+  {
+    statistics.minValue = minValue;
+    statistics.maxValue = maxValue;
+    statistics.mean     = static_cast<float>(static_cast<double>(sum) / numValid);
+  }
+}
+
 } // namespace
 SafeVisionaryData::SafeVisionaryData()
   : VisionaryData()
@@ -72,13 +133,17 @@ SafeVisionaryData::SafeVisionaryData()
   , m_deviceStatus(DEVICE_STATUS::DEVICE_STATUS_INVALID)
   , m_flags(0u)
   , m_lastDataHandlerError(DataHandlerError::OK)
+  , m_statisticsEnabled(false)
 {
+  setStatisticsEnabled(false);
 }
 
 SafeVisionaryData::~SafeVisionaryData() {}
 
 bool SafeVisionaryData::parseXML(const std::string& xmlString, uint32_t changeCounter)
 {
+  VISIONARY_STAGE_TIMER(xmlTimer, m_stageHistograms, XML);
+
   //-----------------------------------------------
   // Check if the segment data changed since last receive
   if (m_changeCounter == changeCounter)
@@ -86,7 +151,8 @@ bool SafeVisionaryData::parseXML(const std::string& xmlString, uint32_t changeCo
     return true; // Same XML content as on last received blob
   }
 
-  m_preCalcCamInfoType = VisionaryData::UNKNOWN;
+  m_preCalcCamInfoType       = VisionaryData::UNKNOWN;
+  m_preCalcCamInfoBinnedType = VisionaryData::UNKNOWN;
 
   //-----------------------------------------------
   // Parse XML string into DOM
@@ -341,11 +407,24 @@ bool SafeVisionaryData::parseBinaryData(std::vector<uint8_t>::iterator itBuf, si
   const uint32_t length = readUnalignLittleEndian<uint32_t>(&*itBuf);
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf(
+      "Malformed data, length in data segment depth map header does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_DEPTHMAP;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
-  const uint32_t dataSize        = length - 8u;
-  const uint32_t crc32           = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize));
-  const uint32_t crc32Calculated = ~CRC_calcCrc32Block(&*itBuf, dataSize, CRC_DEFAULT_INIT_VALUE32);
+  const uint32_t dataSize = length - 8u;
+  const uint32_t crc32    = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize));
+  uint32_t crc32Calculated;
+  {
+    VISIONARY_STAGE_TIMER(crcTimer, m_stageHistograms, DEPTHMAP_CRC);
+    crc32Calculated = ~CRC_calcCrc32Block(&*itBuf, dataSize, CRC_DEFAULT_INIT_VALUE32);
+  }
 
   if (crc32 != crc32Calculated)
   {
@@ -354,15 +433,6 @@ bool SafeVisionaryData::parseBinaryData(std::vector<uint8_t>::iterator itBuf, si
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf(
-      "Malformed data, length in data segment depth map header does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_DEPTHMAP;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -399,27 +469,56 @@ bool SafeVisionaryData::parseBinaryData(std::vector<uint8_t>::iterator itBuf, si
   m_flags = readUnalignLittleEndian<uint16_t>(&*itBuf);
   itBuf += sizeof(uint16_t);
 
+  // the maps described by the XML must fit between the frame information and the CRC32
+  const size_t frameInfoSize = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t) +
+                               sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+  if ((frameInfoSize + numBytesDistance + numBytesIntensity + numBytesState + 8u) > size)
+  {
+    std::printf("Malformed data, data segment depth map is too short for the image size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_DEPTHMAP;
+    return false;
+  }
+
   //-----------------------------------------------
   // Extract the Images depending on the informations extracted from the XML part
+  VISIONARY_STAGE_TIMER(copyTimer, m_stageHistograms, DEPTHMAP_COPY);
   if (numBytesDistance != 0)
   {
     m_distanceMap.resize(numPixel);
-    memcpy(&m_distanceMap[0], &*itBuf, numBytesDistance);
+    if (m_statisticsEnabled && (m_distanceByteDepth == sizeof(uint16_t)))
+    {
+      copyMapWithStatistics(&*itBuf, numPixel, m_distanceMap, m_statistics.distance);
+    }
+    else
+    {
+      memcpy(&m_distanceMap[0], &*itBuf, numBytesDistance);
+      resetStatistics(m_statistics.distance);
+    }
     itBuf += numBytesDistance;
   }
   else
   {
     m_distanceMap.clear();
+    resetStatistics(m_statistics.distance);
   }
   if (numBytesIntensity != 0)
   {
     m_intensityMap.resize(numPixel);
-    memcpy(&m_intensityMap[0], &*itBuf, numBytesIntensity);
+    if (m_statisticsEnabled && (m_intensityByteDepth == sizeof(uint16_t)))
+    {
+      copyMapWithStatistics(&*itBuf, numPixel, m_intensityMap, m_statistics.intensity);
+    }
+    else
+    {
+      memcpy(&m_intensityMap[0], &*itBuf, numBytesIntensity);
+      resetStatistics(m_statistics.intensity);
+    }
     itBuf += numBytesIntensity;
   }
   else
   {
     m_intensityMap.clear();
+    resetStatistics(m_statistics.intensity);
   }
   if (numBytesState != 0)
   {
@@ -441,6 +540,14 @@ bool SafeVisionaryData::parseRoiData(std::vector<uint8_t>::iterator itBuf, size_
   const uint32_t length = readUnalignLittleEndian<uint32_t>(&*itBuf);
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf("Malformed data, length of data segment ROI does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_ROI;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -454,14 +561,6 @@ bool SafeVisionaryData::parseRoiData(std::vector<uint8_t>::iterator itBuf, size_
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf("Malformed data, length of data segment ROI does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_ROI;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -499,6 +598,14 @@ bool SafeVisionaryData::parseDeviceStatusData(std::vector<uint8_t>::iterator itB
   const uint32_t length = readUnalignLittleEndian<uint32_t>(&*itBuf);
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf("Malformed data, length of Device Status header does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_DEVICESTATUS;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -512,14 +619,6 @@ bool SafeVisionaryData::parseDeviceStatusData(std::vector<uint8_t>::iterator itB
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf("Malformed data, length of Device Status header does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_DEVICESTATUS;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -557,6 +656,14 @@ bool SafeVisionaryData::parseLocalIOsData(std::vector<uint8_t>::iterator itBuf,
   const uint32_t length = readUnalignLittleEndian<uint32_t>(&*itBuf);
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf("Malformed data, length of Device Status header does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_LOCALIOS;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -570,14 +677,6 @@ bool SafeVisionaryData::parseLocalIOsData(std::vector<uint8_t>::iterator itBuf,
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf("Malformed data, length of Device Status header does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_LOCALIOS;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -614,6 +713,15 @@ bool SafeVisionaryData::parseFieldInformationData(std::vector<uint8_t>::iterator
   const uint32_t length = readUnalignLittleEndian<uint32_t>(&*itBuf);
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf(
+      "Malformed data, length of data segment Field Information does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_FIELDINFORMATION;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -628,15 +736,6 @@ bool SafeVisionaryData::parseFieldInformationData(std::vector<uint8_t>::iterator
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf(
-      "Malformed data, length of data segment Field Information does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_FIELDINFORMATION;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -676,6 +775,15 @@ bool SafeVisionaryData::parseLogicSignalsData(std::vector<uint8_t>::iterator itB
 
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf(
+      "Malformed data, length of data segment Logic Signals does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_LOGICSIGNALS;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -689,15 +797,6 @@ bool SafeVisionaryData::parseLogicSignalsData(std::vector<uint8_t>::iterator itB
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf(
-      "Malformed data, length of data segment Logic Signals does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_LOGICSIGNALS;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -736,6 +835,14 @@ bool SafeVisionaryData::parseIMUData(std::vector<uint8_t>::iterator itBuf, size_
 
   itBuf += sizeof(uint32_t);
 
+  // length does not include the second length field, so add 4 bytes
+  if ((length + sizeof(uint32_t)) != size)
+  {
+    std::printf("Malformed data, length of data segment IMU does not match package size.\n");
+    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_IMU;
+    return false;
+  }
+
   //-----------------------------------------------
   // Data ends with a CRC32 field and a copy of the length byte
   const uint32_t dataSize        = length - 8u;
@@ -749,14 +856,6 @@ bool SafeVisionaryData::parseIMUData(std::vector<uint8_t>::iterator itBuf, size_
     return false;
   }
 
-  // length does not include the second length field, so add 4 bytes
-  if ((length + sizeof(uint32_t)) != size)
-  {
-    std::printf("Malformed data, length of data segment IMU does not match package size.\n");
-    m_lastDataHandlerError = DataHandlerError::INVALID_LENGTH_SEGMENT_IMU;
-    return false;
-  }
-
   // get second length field
   const uint32_t lengthCopy = readUnalignLittleEndian<uint32_t>(&*(itBuf + dataSize + 4));
 
@@ -794,6 +893,61 @@ void SafeVisionaryData::generatePointCloud(std::vector<PointXYZ>& pointCloud)
   return VisionaryData::generatePointCloud(m_distanceMap, VisionaryData::RADIAL, pointCloud);
 }
 
+void SafeVisionaryData::generatePointCloud(const std::vector<uint16_t>& distanceMap,
+                                           std::vector<PointXYZ>& pointCloud)
+{
+  if (distanceMap.size() != m_distanceMap.size())
+  {
+    // the map does not belong to the metadata of this frame
+    pointCloud.clear();
+    return;
+  }
+  return VisionaryData::generatePointCloud(distanceMap, VisionaryData::RADIAL, pointCloud);
+}
+
+void SafeVisionaryData::generatePointCloudRegion(
+  std::vector<PointXYZ>& pointCloud, int colBegin, int rowBegin, int colEnd, int rowEnd)
+{
+  return VisionaryData::generatePointCloudRegion(
+    m_distanceMap, VisionaryData::RADIAL, colBegin, rowBegin, colEnd, rowEnd, pointCloud);
+}
+
+void SafeVisionaryData::generateQuantizedPointCloud(QuantizedPointCloud& pointCloud)
+{
+  return VisionaryData::generateQuantizedPointCloud(
+    m_distanceMap, VisionaryData::RADIAL, pointCloud);
+}
+
+void SafeVisionaryData::generateCroppedPointCloud(std::vector<PointXYZ>& pointCloud,
+                                                  const PointCloudGating& gating)
+{
+  return VisionaryData::generateCroppedPointCloud(
+    m_distanceMap, VisionaryData::RADIAL, gating, pointCloud);
+}
+
+const std::vector<PointXYZ>& SafeVisionaryData::getPointCloudLookUpTable()
+{
+  // Calculate disortion data from XML metadata once.
+  if (m_preCalcCamInfoType != VisionaryData::RADIAL)
+  {
+    preCalcCamInfo(VisionaryData::RADIAL);
+  }
+  return m_preCalcCamInfo;
+}
+
+void SafeVisionaryData::generateLaserScan(std::vector<float>& ranges, const LaserScanConfig& config)
+{
+  return VisionaryData::generateLaserScan(m_distanceMap, VisionaryData::RADIAL, config, ranges);
+}
+
+void SafeVisionaryData::generatePointCloud(std::vector<PointXYZ>& pointCloud,
+                                           PixelBinning binning,
+                                           int binSize)
+{
+  return VisionaryData::generatePointCloud(
+    m_distanceMap, VisionaryData::RADIAL, binning, binSize, pointCloud);
+}
+
 const std::vector<uint16_t>& SafeVisionaryData::getDistanceMap() const
 {
   return m_distanceMap;
@@ -864,6 +1018,35 @@ DataHandlerError SafeVisionaryData::getLastError()
   return m_lastDataHandlerError;
 }
 
+void SafeVisionaryData::setStatisticsEnabled(bool enabled, uint32_t histogramBins)
+{
+  // round down to a power of 2, so the bin of a value is a shift
+  int shift = 16;
+  while ((shift > 0) && ((1u << (17 - shift)) <= histogramBins))
+  {
+    --shift;
+  }
+  m_statisticsEnabled = enabled;
+
+  MapStatistics* maps[2] = {&m_statistics.distance, &m_statistics.intensity};
+  for (int i = 0; i < 2; i++)
+  {
+    maps[i]->histogramShift = shift;
+    maps[i]->histogram.assign(enabled ? (0x10000u >> shift) : 0u, 0u);
+    resetStatistics(*maps[i]);
+  }
+}
+
+const FrameStatistics& SafeVisionaryData::getStatistics() const
+{
+  return m_statistics;
+}
+
+StageHistograms& SafeVisionaryData::getStageHistograms()
+{
+  return m_stageHistograms;
+}
+
 DataSetsActive SafeVisionaryData::getDataSetsActive()
 {
   return m_dataSetsActive;
@@ -876,6 +1059,8 @@ void SafeVisionaryData::clearData(uint32_t changedCounter)
     m_distanceMap.clear();
     m_intensityMap.clear();
     m_stateMap.clear();
+    resetStatistics(m_statistics.distance);
+    resetStatistics(m_statistics.intensity);
 
     // In case data segment "Depthmap" is not available use the changed counter as frame number.
     // The changed counter is incremented each Blob and is identical to the frame number.
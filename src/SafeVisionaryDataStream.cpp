@@ -21,6 +21,7 @@
 
 #include "sick_safevisionary_base/SafeVisionaryDataStream.h"
 #include "sick_safevisionary_base/CRC.h"
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
 #include "sick_safevisionary_base/VisionaryEndian.h"
 #include <cstring>
 #include <iostream>
@@ -28,146 +29,151 @@
 
 //#define ENABLE_CRC_CHECK_UDP_FRAGMENT
 
+namespace visionary {
 namespace {
-/// Maximum size of the BLOBs
-/// todo
-constexpr size_t BLOB_SIZE_MAX = 3000u * 1024u;
-
-// Max UDP Packet size
-// We don't support jumbo frames here
-// The normal Ethernet MTU is 1500 bytes
-// the minimum IPv4 header size is 20bytes
-// the UDP header size is 8 bytes
-constexpr size_t MAX_UDP_BLOB_PACKET_SIZE = 1500u - (20u + 8u);
-
-// Max TCP Packet size
-// We don't support jumbo frames here
-// The normal Ethernet MTU is 1500 bytes
-// the minimum IPv4 header size is 20bytes
-// the minimum IPv4 TCP header size is 20 bytes
-constexpr size_t MAX_TCP_BLOB_PACKET_SIZE = 1500u - (20u + 20u);
-
-/// Fixed value used in the protocols checksum field
-/// A checksum is not necessary since error checking is done on lower protocol levels already
-constexpr uint8_t PSEUDO_CHECKSUM = 0x45u;
-
-// 4 byte 0x2020202
-// 4 byte Packet Length
-// 2 byte Protocol Version
-// 1 byte Packet Type
-constexpr int32_t BLOB_HEADER_SIZE = 11; // 4+4+2+1 = 11
-
-#pragma pack(push, 1)
-/// Structure of UDP header.
-/// All values are big-endian.
-struct UdpDataHeader
+/// Adds to a health counter. Only the receiving thread writes the counters, so a relaxed load and
+/// store is sufficient and avoids a locked read-modify-write.
+void count(std::atomic<uint64_t>& counter, uint64_t value = 1u)
 {
-  uint16_t
-    packetNumber; ///< packet number: current Blob number, incremented by one for each complete Blob
-  uint16_t fragmentNumber; ///< current fragment number, incremented by one for new each fragment,
-                           ///< set to 0 in case of a new Blob
-  uint32_t timeStamp; ///< Time in us when the UDP datagram is generated, increasing monotonically
-                      ///< starting from system initialization.
-  uint32_t sourceIpAddress;  ///< IP address of the sensor
-  uint16_t sourcePortNumber; ///< UDP port number of the sensor
-  uint32_t destIpAddress;    ///< IP address of the target
-  uint16_t destPortNumber;   ///< UDP port number of the target
-  uint16_t protocolVersion;  ///< protocol version of the UDP header
-  uint16_t
-    dataLength; ///< length of the data within the UDP packet: bytes after protocol version
-                ///< (including Packet Type) until end of fragment (including pseudo checksum)
-  uint8_t flags; ///< flags of the fragment: Bit0-Bit6 reserved, Bit7 FIN: Set when this fragment is
-                 ///< the last one of the Blob
-  uint8_t packetType; //< type of the packed, set to 'b' = 0x62: Data packet
-};
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
 
-/// Structure of Blob header.
-/// All values are big-endian.
-struct BlobDataHeader
+#ifdef ENABLE_INSTRUMENTATION
+/// Records the APPLICATION stage, the time since the previous call for the next Blob returned,
+/// and stores the time this call returns
+class ApplicationTimer
 {
-  uint32_t blobStart;  ///< 4 STx bytes, marks the start of Blob data, set to 0x02 0x02 0x02 0x02
-  uint32_t blobLength; ///< length of the Blob data
-  uint16_t protocolVersion;  ///< protocol version of the Blob data
-  uint8_t packetType;        ///< type of the packet, set to 'b' = 0x62: Data packet
-  uint16_t blobId;           ///< ID of the Blob data, set to 1 (3D data)
-  uint16_t numberOfSegments; ///< number of data segments within the Blob data
-};
-#pragma pack(pop)
-
-/// Version of UDP protocol
-constexpr uint8_t UDP_PROTOCOL_VERSION = 0x0001u;
-
-/// Packet type of UDP telegram: 'b' = Blob data
-constexpr uint8_t PACKET_TYPE_DATA = 0x62u;
-
-/// Bitmask for the flag last fragment
-constexpr uint8_t FLAG_LAST_FRAGMENT = (1u << 7);
-
-/// Blob data start bytes
-constexpr uint32_t BLOB_DATA_START = 0x02020202u;
-
-/// Protocol version of Blob data
-constexpr uint8_t BLOB_DATA_PROTOCOL_VERSION = 0x0001u;
+public:
+  ApplicationTimer(StageHistograms& histograms, std::chrono::steady_clock::time_point& lastReturn)
+    : m_histograms(histograms)
+    , m_lastReturn(lastReturn)
+  {
+    if (m_histograms.isEnabled() && (m_lastReturn != std::chrono::steady_clock::time_point()))
+    {
+      m_histograms.record(InstrumentationStage::APPLICATION,
+                          std::chrono::steady_clock::now() - m_lastReturn);
+    }
+  }
 
-/// ID of Blob data (1: 3D data)
-constexpr uint8_t BLOB_DATA_BLOB_ID = 0x0001u;
+  ~ApplicationTimer()
+  {
+    m_lastReturn = m_histograms.isEnabled() ? std::chrono::steady_clock::now()
+                                            : std::chrono::steady_clock::time_point();
+  }
 
+private:
+  StageHistograms& m_histograms;
+  std::chrono::steady_clock::time_point& m_lastReturn;
+};
+#endif
 } // namespace
 
-namespace visionary {
+uint64_t StreamHealth::getNumBlobsDropped() const
+{
+  uint64_t numBlobsDropped = 0u;
+  for (uint64_t blobs : blobsDropped)
+  {
+    numBlobsDropped += blobs;
+  }
+  return numBlobsDropped;
+}
+
 SafeVisionaryDataStream::SafeVisionaryDataStream(std::shared_ptr<VisionaryData> dataHandler)
   : m_dataHandler(dataHandler)
+  , m_safeDataHandler(dynamic_cast<SafeVisionaryData*>(dataHandler.get()))
   , m_blobNumber(0u)
   , m_numSegments(0u)
   , m_lastDataStreamError(DataStreamError::OK)
+  , m_lastCompleteBlobNumber(0u)
+  , m_hasLastCompleteBlobNumber(false)
 {
+  std::atomic<uint64_t>* counters[] = {&m_health.fragmentsReceived,
+                                       &m_health.fragmentsSkipped,
+                                       &m_health.bytesReceived,
+                                       &m_health.blobsCompleted,
+                                       &m_health.resyncs,
+                                       &m_health.timeouts,
+                                       &m_health.blobNumberGaps,
+                                       &m_health.blobsLost};
+  for (std::atomic<uint64_t>* counter : counters)
+  {
+    counter->store(0u);
+  }
+  for (std::atomic<uint64_t>& counter : m_health.blobsDropped)
+  {
+    counter.store(0u);
+  }
+  for (std::atomic<uint64_t>& counter : m_health.segmentErrors)
+  {
+    counter.store(0u);
+  }
+
   m_blobDataBuffer.reserve(
     BLOB_SIZE_MAX); // reserve maximum BLOB size to avoid (slow) reallocations
 }
 
 SafeVisionaryDataStream::~SafeVisionaryDataStream() {}
 
-bool SafeVisionaryDataStream::openUdpConnection(std::uint16_t port)
+bool SafeVisionaryDataStream::openUdpConnection(std::uint16_t port, int receiveBufferSize)
 {
   bool retValue{true};
 
-  m_pTransportUdp = std::unique_ptr<UdpSocket>(new UdpSocket());
-  if (m_pTransportUdp->bindPort(port) != 0)
+  std::unique_ptr<UdpSocket> pTransport(new UdpSocket());
+  if (pTransport->bindPort(port, receiveBufferSize) != 0)
   {
-    m_pTransportUdp = nullptr;
-    retValue        = false;
+    retValue = false;
+  }
+  else
+  {
+    m_pTransportUdp = std::move(pTransport);
   }
 
   return retValue;
 }
 
+bool SafeVisionaryDataStream::openUdpConnection(std::unique_ptr<ITransport> transport)
+{
+  m_pTransportUdp = std::move(transport);
+  return true;
+}
+
 bool SafeVisionaryDataStream::openTcpConnection(std::uint16_t port, std::string deviceIpAddress)
 {
   bool retValue{true};
 
-  if (m_pTransportTcp.openTcp(port) != 0)
+  std::unique_ptr<TcpSocket> pTransport(new TcpSocket());
+  if (pTransport->openTcp(port) != 0)
   {
     retValue = false;
   }
-  if (m_pTransportTcp.connect(deviceIpAddress, port) != 0)
+  if (pTransport->connect(deviceIpAddress, port) != 0)
     retValue = false;
 
+  m_pTransportTcp = std::move(pTransport);
   return retValue;
 }
+
+bool SafeVisionaryDataStream::openTcpConnection(std::unique_ptr<ITransport> transport)
+{
+  m_pTransportTcp = std::move(transport);
+  return true;
+}
 void SafeVisionaryDataStream::closeUdpConnection()
 {
+  // the transport is only released by the next open or the destructor, so a receive blocked in
+  // another thread returns with an error instead of accessing a destroyed transport
   if (m_pTransportUdp)
   {
     m_pTransportUdp->shutdown();
-    m_pTransportUdp = nullptr;
   }
 }
 void SafeVisionaryDataStream::closeTcpConnection()
 {
-  // if (m_pTransportTcp)
+  // the transport is only released by the next open or the destructor, so a receive blocked in
+  // another thread returns with an error instead of accessing a destroyed transport
+  if (m_pTransportTcp)
   {
-    m_pTransportTcp.shutdown();
-    //  m_pTransportTcp = nullptr;
+    m_pTransportTcp->shutdown();
   }
 }
 
@@ -184,6 +190,7 @@ bool SafeVisionaryDataStream::getNextFragment(std::vector<std::uint8_t>& receive
     // timeout
     std::printf("Blob data receive timeout\n");
     m_lastDataStreamError = DataStreamError::DATA_RECEIVE_TIMEOUT;
+    count(m_health.timeouts);
     return false;
   }
 
@@ -196,6 +203,8 @@ bool SafeVisionaryDataStream::getNextFragment(std::vector<std::uint8_t>& receive
   }
 
   receiveBuffer.resize(receiveSize);
+  count(m_health.fragmentsReceived);
+  count(m_health.bytesReceived, static_cast<uint64_t>(receiveSize));
 
   return true;
 }
@@ -205,12 +214,13 @@ int32_t SafeVisionaryDataStream::getNextTcpReception(std::vector<std::uint8_t>&
   int32_t receiveSize{0};
 
   // receive next TCP packet
-  receiveSize = m_pTransportTcp.recv(receiveBuffer, MAX_TCP_BLOB_PACKET_SIZE);
+  receiveSize = m_pTransportTcp->recv(receiveBuffer, MAX_TCP_BLOB_PACKET_SIZE);
 
   if (receiveSize < 0)
   {
     std::printf("Receive Failed\n");
     m_lastDataStreamError = DataStreamError::DATA_RECEIVE_TIMEOUT;
+    count(m_health.timeouts);
     return -1;
   }
 
@@ -224,6 +234,8 @@ int32_t SafeVisionaryDataStream::getNextTcpReception(std::vector<std::uint8_t>&
 
   if (receiveSize > 0)
     receiveBuffer.resize(receiveSize);
+  count(m_health.fragmentsReceived);
+  count(m_health.bytesReceived, static_cast<uint64_t>(receiveSize));
 
   return receiveSize;
 }
@@ -231,8 +243,19 @@ int32_t SafeVisionaryDataStream::getNextTcpReception(std::vector<std::uint8_t>&
 bool SafeVisionaryDataStream::parseUdpHeader(std::vector<std::uint8_t>& buffer,
                                              UdpProtocolData& udpProtocolData)
 {
+  VISIONARY_STAGE_TIMER(fragmentTimer, m_stageHistograms, FRAGMENT);
+
   udpProtocolData = {0u, 0u, 0u, false};
 
+  if (buffer.size() < sizeof(UdpDataHeader) + sizeof(uint32_t))
+  {
+    // too short for the UDP header and the CRC value
+    std::printf("Received UDP datagram of %u bytes is too short for the UDP header.\n",
+                static_cast<unsigned int>(buffer.size()));
+    m_lastDataStreamError = DataStreamError::INVALID_LENGTH_UDP_HEADER;
+    return false;
+  }
+
   // read UPD data header
   UdpDataHeader* pUdpHeader = reinterpret_cast<UdpDataHeader*>(buffer.data());
 
@@ -299,6 +322,7 @@ bool SafeVisionaryDataStream::getBlobStartUdp(bool& lastFragment)
 {
   std::vector<uint8_t> receiveBuffer;
   bool foundBlobStart{false};
+  uint32_t numSkipped{0u};
   lastFragment = false;
 
   while (!foundBlobStart)
@@ -335,8 +359,16 @@ bool SafeVisionaryDataStream::getBlobStartUdp(bool& lastFragment)
       // found valid start of Blob data
       foundBlobStart = true;
     }
-
-    // not first fragment -> continue with next UDP fragment
+    else
+    {
+      // not first fragment -> continue with next UDP fragment
+      count(m_health.fragmentsSkipped);
+      numSkipped++;
+    }
+  }
+  if (foundBlobStart && (numSkipped != 0u))
+  {
+    count(m_health.resyncs);
   }
   return foundBlobStart;
 }
@@ -346,9 +378,18 @@ bool SafeVisionaryDataStream::getBlobStartTcp(std::vector<std::uint8_t>& receive
   int32_t receiveSize = 0;
   int blobCounter     = 0;
 
+  // the rest of the current Blob is always skipped
+  count(m_health.resyncs);
+
   while (true)
   {
     receiveSize = getNextTcpReception(receiveBufferPacketSize);
+    if (receiveSize < 0)
+    {
+      // timeout or connection closed, the error is kept
+      receiveBufferPacketSize.clear();
+      return false;
+    }
 
     if (receiveSize == BLOB_HEADER_SIZE)
     {
@@ -374,14 +415,19 @@ bool SafeVisionaryDataStream::getBlobStartTcp(std::vector<std::uint8_t>& receive
       }
     }
   }
-
-  return false;
 }
 
 bool SafeVisionaryDataStream::parseBlobHeaderTcp()
 {
   bool blobHeaderValid{true};
 
+  if (m_blobDataBuffer.size() < sizeof(BlobDataHeader))
+  {
+    std::printf("Received Blob data is too short for the Blob header.\n");
+    m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+    return false;
+  }
+
   // we have the first fragment -> check Blob protocol header
   BlobDataHeader* pBlobHeader = reinterpret_cast<BlobDataHeader*>(m_blobDataBuffer.data());
 
@@ -432,6 +478,15 @@ bool SafeVisionaryDataStream::parseBlobHeaderTcp()
     m_offsetSegment.clear();
     m_changeCounter.clear();
 
+    // the segment table must fit into the received data
+    const std::size_t tableSize = sizeof(BlobDataHeader) + m_numSegments * 2u * sizeof(uint32_t);
+    if ((m_numSegments == 0u) || (m_blobDataBuffer.size() < tableSize))
+    {
+      std::printf("Blob segment table of %u segments exceeds the received data.\n", m_numSegments);
+      m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+      return false;
+    }
+
     uint32_t blobDataPos = sizeof(BlobDataHeader);
     for (uint32_t segmentCounter = 0u; segmentCounter < m_numSegments; segmentCounter++)
     {
@@ -457,6 +512,13 @@ bool SafeVisionaryDataStream::parseBlobHeaderUdp()
 {
   bool blobHeaderValid{true};
 
+  if (m_blobDataBuffer.size() < sizeof(BlobDataHeader))
+  {
+    std::printf("Received Blob data is too short for the Blob header.\n");
+    m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+    return false;
+  }
+
   // we have the first fragment -> check Blob protocol header
   BlobDataHeader* pBlobHeader = reinterpret_cast<BlobDataHeader*>(m_blobDataBuffer.data());
 
@@ -507,6 +569,15 @@ bool SafeVisionaryDataStream::parseBlobHeaderUdp()
     m_offsetSegment.clear();
     m_changeCounter.clear();
 
+    // the segment table must fit into the received data
+    const std::size_t tableSize = sizeof(BlobDataHeader) + m_numSegments * 2u * sizeof(uint32_t);
+    if ((m_numSegments == 0u) || (m_blobDataBuffer.size() < tableSize))
+    {
+      std::printf("Blob segment table of %u segments exceeds the received data.\n", m_numSegments);
+      m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+      return false;
+    }
+
     uint32_t blobDataPos = sizeof(BlobDataHeader);
     for (uint32_t segmentCounter = 0u; segmentCounter < m_numSegments; segmentCounter++)
     {
@@ -530,17 +601,45 @@ bool SafeVisionaryDataStream::parseBlobHeaderUdp()
 
 bool SafeVisionaryDataStream::parseBlobData()
 {
+  VISIONARY_STAGE_TIMER(parseTimer, m_stageHistograms, PARSE);
+
+  if (!checkSegmentOffsets())
+  {
+    m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+    return false;
+  }
+
   uint32_t currentSegment{0};
 
   // First segment always contains the XML Metadata
   // Blob data begins after packet type, so subtract length of blobId and numberOfSegments
-  uint32_t beginOfBlobData = sizeof(BlobDataHeader) - 2 * sizeof(uint16_t);
+  uint32_t beginOfBlobData = BLOB_DATA_SEGMENT_BASE;
   std::string xmlSegment(&m_blobDataBuffer[beginOfBlobData + m_offsetSegment[currentSegment]],
                          &m_blobDataBuffer[beginOfBlobData + m_offsetSegment[currentSegment + 1]]);
 
   if (m_dataHandler->parseXML(xmlSegment, m_changeCounter[currentSegment]))
   {
     auto dataSetsActive = m_dataHandler->getDataSetsActive();
+
+    // each active data set needs its own segment after the XML segment
+    const bool dataSets[] = {dataSetsActive.hasDataSetDepthMap,
+                             dataSetsActive.hasDataSetDeviceStatus,
+                             dataSetsActive.hasDataSetROI,
+                             dataSetsActive.hasDataSetLocalIOs,
+                             dataSetsActive.hasDataSetFieldInfo,
+                             dataSetsActive.hasDataSetLogicSignals,
+                             dataSetsActive.hasDataSetIMU};
+    uint32_t numDataSets = 0u;
+    for (bool dataSet : dataSets)
+    {
+      numDataSets += dataSet ? 1u : 0u;
+    }
+    if (numDataSets >= m_numSegments)
+    {
+      std::printf("Blob has %u segments for %u data sets.\n", m_numSegments, numDataSets);
+      m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+      return false;
+    }
     if (dataSetsActive.hasDataSetDepthMap)
     {
       currentSegment++;
@@ -664,11 +763,15 @@ bool SafeVisionaryDataStream::getNextBlobUdp()
   uint16_t expectedFragmentNumber{0u};
   bool blobDataComplete{false};
   bool lastFragment{false};
+#ifdef ENABLE_INSTRUMENTATION
+  ApplicationTimer applicationTimer(m_stageHistograms, m_lastBlobReturn);
+#endif
 
   m_blobDataBuffer.clear();
 
   if (getBlobStartUdp(lastFragment))
   {
+    VISIONARY_STAGE_TIMER(receiveTimer, m_stageHistograms, RECEIVE);
     if (parseBlobHeaderUdp())
     {
       // in case the Blob data consists only of one fragment, nothing has to be done here, the
@@ -680,14 +783,17 @@ bool SafeVisionaryDataStream::getNextBlobUdp()
 
         UdpProtocolData udpProtocolData{};
         // receive next UDP fragment
-        if (getNextFragment(receiveBuffer))
+        if (!getNextFragment(receiveBuffer))
+        {
+          // timeout or closed connection, keep its error
+          break;
+        }
+
+        // parse and check UDP data header
+        if (!parseUdpHeader(receiveBuffer, udpProtocolData))
         {
-          // parse and check UDP data header
-          if (!parseUdpHeader(receiveBuffer, udpProtocolData))
-          {
-            // UDP protocol error, e.g. wrong version, unexpected length
-            break;
-          }
+          // UDP protocol error, e.g. wrong version, unexpected length
+          break;
         }
 
         if (m_blobNumber != udpProtocolData.blobNumber)
@@ -729,6 +835,12 @@ bool SafeVisionaryDataStream::getNextBlobUdp()
   bool result{false};
   if (blobDataComplete)
   {
+    countCompleteBlobNumber();
+    if (m_recorder)
+    {
+      VISIONARY_STAGE_TIMER(recordTimer, m_stageHistograms, RECORD);
+      m_recorder->record(m_blobDataBuffer.data(), m_blobDataBuffer.size());
+    }
     result = parseBlobData();
     if (result)
     {
@@ -736,7 +848,7 @@ bool SafeVisionaryDataStream::getNextBlobUdp()
     }
   }
 
-  return result;
+  return countBlobResult(result);
 }
 
 bool SafeVisionaryDataStream::getNextBlobTcp(std::vector<std::uint8_t>& receiveBufferPacketSize)
@@ -744,6 +856,9 @@ bool SafeVisionaryDataStream::getNextBlobTcp(std::vector<std::uint8_t>& receiveB
   std::vector<uint8_t> receiveBuffer;
   bool blobDataComplete{false};
   int32_t receiveSize = 0;
+#ifdef ENABLE_INSTRUMENTATION
+  ApplicationTimer applicationTimer(m_stageHistograms, m_lastBlobReturn);
+#endif
 
   m_blobDataBuffer.clear();
 
@@ -762,36 +877,21 @@ bool SafeVisionaryDataStream::getNextBlobTcp(std::vector<std::uint8_t>& receiveB
     }
   }
 
-  while (!blobDataComplete)
   {
-    // receive next Tcp packet
-    receiveSize = getNextTcpReception(receiveBuffer);
-
-    if (receiveSize > 0 && receiveSize != BLOB_HEADER_SIZE)
+    // the Blob is complete when the header of the next Blob arrives
+    VISIONARY_STAGE_TIMER(receiveTimer, m_stageHistograms, RECEIVE);
+    while (!blobDataComplete)
     {
-      uint8_t* const blobDataBufferEnd = m_blobDataBuffer.data() + m_blobDataBuffer.size();
-
-      m_blobDataBuffer.resize(m_blobDataBuffer.size() + receiveSize);
-
-      memcpy(blobDataBufferEnd, &receiveBuffer[0], receiveSize);
-    }
-
-    if ((receiveSize == BLOB_HEADER_SIZE))
-    {
-      // we have the first fragment -> check Blob protocol header
-      BlobDataHeader* pBlobHeader = reinterpret_cast<BlobDataHeader*>(receiveBuffer.data());
-
-      // check Blob data start bytes
-      const uint32_t blobDataStartBytes = readUnalignBigEndian<uint32_t>(&pBlobHeader->blobStart);
-      if (blobDataStartBytes == BLOB_DATA_START)
+      // receive next Tcp packet
+      receiveSize = getNextTcpReception(receiveBuffer);
+      if (receiveSize < 0)
       {
-        // start bytes of Blob data have not been found
-        receiveBufferPacketSize.resize(BLOB_HEADER_SIZE);
-        memcpy(receiveBufferPacketSize.data(), &receiveBuffer[0], BLOB_HEADER_SIZE);
-
-        blobDataComplete = 1;
+        // timeout or connection closed, no further Blob header will follow
+        receiveBufferPacketSize.clear();
+        break;
       }
-      else
+
+      if (receiveSize > 0 && receiveSize != BLOB_HEADER_SIZE)
       {
         uint8_t* const blobDataBufferEnd = m_blobDataBuffer.data() + m_blobDataBuffer.size();
 
@@ -799,27 +899,186 @@ bool SafeVisionaryDataStream::getNextBlobTcp(std::vector<std::uint8_t>& receiveB
 
         memcpy(blobDataBufferEnd, &receiveBuffer[0], receiveSize);
       }
+
+      if ((receiveSize == BLOB_HEADER_SIZE))
+      {
+        // we have the first fragment -> check Blob protocol header
+        BlobDataHeader* pBlobHeader = reinterpret_cast<BlobDataHeader*>(receiveBuffer.data());
+
+        // check Blob data start bytes
+        const uint32_t blobDataStartBytes = readUnalignBigEndian<uint32_t>(&pBlobHeader->blobStart);
+        if (blobDataStartBytes == BLOB_DATA_START)
+        {
+          // start bytes of Blob data have not been found
+          receiveBufferPacketSize.resize(BLOB_HEADER_SIZE);
+          memcpy(receiveBufferPacketSize.data(), &receiveBuffer[0], BLOB_HEADER_SIZE);
+
+          blobDataComplete = 1;
+        }
+        else
+        {
+          uint8_t* const blobDataBufferEnd = m_blobDataBuffer.data() + m_blobDataBuffer.size();
+
+          m_blobDataBuffer.resize(m_blobDataBuffer.size() + receiveSize);
+
+          memcpy(blobDataBufferEnd, &receiveBuffer[0], receiveSize);
+        }
+      }
     }
   }
 
+  // Without the header of the next Blob the buffered data is the last Blob of the stream. It is
+  // handed over if the segment table confirms that it has been received completely.
+  const DataStreamError receiveError = m_lastDataStreamError;
+  if (!blobDataComplete && m_blobDataBuffer.empty())
+  {
+    return countBlobResult(false);
+  }
+
   if (parseBlobHeaderTcp())
   {
     bool result{false};
-    if (blobDataComplete)
+    if (m_recorder && (blobDataComplete || checkSegmentOffsets()))
     {
-      result = parseBlobData();
-      if (result)
-      {
-        m_lastDataStreamError = DataStreamError::OK;
-      }
+      VISIONARY_STAGE_TIMER(recordTimer, m_stageHistograms, RECORD);
+      m_recorder->record(m_blobDataBuffer.data(), m_blobDataBuffer.size());
+    }
+    result = parseBlobData();
+    if (result)
+    {
+      // a failed receive stays visible to the caller of the last Blob
+      m_lastDataStreamError = blobDataComplete ? DataStreamError::OK : receiveError;
     }
 
-    return result;
+    return countBlobResult(result);
   }
   else
+  {
+    return countBlobResult(false);
+  }
+}
+
+bool SafeVisionaryDataStream::processBlob(const std::uint8_t* data, std::size_t size)
+{
+  if (size < sizeof(BlobDataHeader))
+  {
+    std::printf("Blob data is too short: %zu bytes\n", size);
+    m_lastDataStreamError = DataStreamError::INVALID_BLOB_HEADER;
+    return countBlobResult(false);
+  }
+
+  // the buffer has been reserved for the largest Blob, so this is a plain copy
+  m_blobDataBuffer.assign(data, data + size);
+
+  bool result{false};
+  if (parseBlobHeaderUdp())
+  {
+    result = parseBlobData();
+    if (result)
+    {
+      m_lastDataStreamError = DataStreamError::OK;
+    }
+  }
+  return countBlobResult(result);
+}
+
+bool SafeVisionaryDataStream::checkSegmentOffsets() const
+{
+  // each data segment consists at least of length, timestamp, version, CRC32 and length copy
+  const uint32_t minSegmentSize = 3u * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t);
+
+  if (m_offsetSegment.size() != static_cast<std::size_t>(m_numSegments) + 1u)
   {
     return false;
   }
+  for (std::size_t segment = 0u; segment < m_offsetSegment.size(); ++segment)
+  {
+    if ((BLOB_DATA_SEGMENT_BASE + static_cast<std::size_t>(m_offsetSegment[segment])) >
+        m_blobDataBuffer.size())
+    {
+      std::printf("Offset of Blob segment %zu exceeds the Blob data.\n", segment);
+      return false;
+    }
+    if (segment == 0u)
+    {
+      continue;
+    }
+    // the first segment holds the XML and may have any size, all others are data segments
+    const uint32_t minSize = (segment > 1u) ? minSegmentSize : 0u;
+    if (m_offsetSegment[segment] < m_offsetSegment[segment - 1u] + minSize)
+    {
+      std::printf("Offsets of Blob segment %zu are invalid.\n", segment - 1u);
+      return false;
+    }
+  }
+  return true;
+}
+
+void SafeVisionaryDataStream::countCompleteBlobNumber()
+{
+  if (m_hasLastCompleteBlobNumber)
+  {
+    // the Blob number wraps around, so the difference is taken modulo 2^16
+    const uint16_t numMissing = static_cast<uint16_t>(m_blobNumber - m_lastCompleteBlobNumber - 1u);
+    if (numMissing != 0u)
+    {
+      count(m_health.blobNumberGaps);
+      count(m_health.blobsLost, numMissing);
+    }
+  }
+  m_lastCompleteBlobNumber    = m_blobNumber;
+  m_hasLastCompleteBlobNumber = true;
+}
+
+bool SafeVisionaryDataStream::countBlobResult(bool result)
+{
+  if (result)
+  {
+    count(m_health.blobsCompleted);
+    return result;
+  }
+
+  count(m_health.blobsDropped[static_cast<std::size_t>(m_lastDataStreamError)]);
+  const bool segmentError =
+    (m_lastDataStreamError == DataStreamError::PARSE_XML_ERROR) ||
+    (m_lastDataStreamError >= DataStreamError::DATA_SEGMENT_DEPTHMAP_ERROR);
+  if (segmentError && (nullptr != m_safeDataHandler))
+  {
+    count(m_health.segmentErrors[static_cast<std::size_t>(m_safeDataHandler->getLastError())]);
+  }
+  return result;
+}
+
+StreamHealth SafeVisionaryDataStream::getHealth() const
+{
+  StreamHealth health;
+  health.fragmentsReceived = m_health.fragmentsReceived.load(std::memory_order_relaxed);
+  health.fragmentsSkipped  = m_health.fragmentsSkipped.load(std::memory_order_relaxed);
+  health.bytesReceived     = m_health.bytesReceived.load(std::memory_order_relaxed);
+  health.blobsCompleted    = m_health.blobsCompleted.load(std::memory_order_relaxed);
+  health.resyncs           = m_health.resyncs.load(std::memory_order_relaxed);
+  health.timeouts          = m_health.timeouts.load(std::memory_order_relaxed);
+  health.blobNumberGaps    = m_health.blobNumberGaps.load(std::memory_order_relaxed);
+  health.blobsLost         = m_health.blobsLost.load(std::memory_order_relaxed);
+  for (std::size_t idx = 0u; idx < NUM_DATA_STREAM_ERRORS; ++idx)
+  {
+    health.blobsDropped[idx] = m_health.blobsDropped[idx].load(std::memory_order_relaxed);
+  }
+  for (std::size_t idx = 0u; idx < NUM_DATA_HANDLER_ERRORS; ++idx)
+  {
+    health.segmentErrors[idx] = m_health.segmentErrors[idx].load(std::memory_order_relaxed);
+  }
+  return health;
+}
+
+void SafeVisionaryDataStream::setRecorder(std::shared_ptr<BlobRecorder> recorder)
+{
+  m_recorder = recorder;
+}
+
+StageHistograms& SafeVisionaryDataStream::getStageHistograms()
+{
+  return m_stageHistograms;
 }
 
 DataStreamError SafeVisionaryDataStream::getLastError()
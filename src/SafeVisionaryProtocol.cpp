@@ -0,0 +1,58 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/SafeVisionaryProtocol.h"
+#include "sick_safevisionary_base/CRC.h"
+#include "sick_safevisionary_base/VisionaryEndian.h"
+
+#include <cstring>
+
+namespace visionary {
+
+std::size_t writeUdpFragment(uint8_t* datagram,
+                             uint16_t blobNumber,
+                             uint16_t fragmentNumber,
+                             uint32_t timestamp,
+                             bool isLastFragment,
+                             const uint8_t* payload,
+                             std::size_t payloadSize)
+{
+  // addresses and ports are not evaluated by the receiver
+  std::memset(datagram, 0, sizeof(UdpDataHeader));
+  writeUnalignBigEndian<uint16_t>(datagram + offsetof(UdpDataHeader, packetNumber), blobNumber);
+  writeUnalignBigEndian<uint16_t>(datagram + offsetof(UdpDataHeader, fragmentNumber),
+                                  fragmentNumber);
+  writeUnalignBigEndian<uint32_t>(datagram + offsetof(UdpDataHeader, timeStamp), timestamp);
+  writeUnalignBigEndian<uint16_t>(datagram + offsetof(UdpDataHeader, protocolVersion),
+                                  UDP_PROTOCOL_VERSION);
+  writeUnalignBigEndian<uint16_t>(datagram + offsetof(UdpDataHeader, dataLength),
+                                  static_cast<uint16_t>(payloadSize));
+  datagram[offsetof(UdpDataHeader, flags)]      = isLastFragment ? FLAG_LAST_FRAGMENT : 0u;
+  datagram[offsetof(UdpDataHeader, packetType)] = PACKET_TYPE_DATA;
+  std::memcpy(datagram + sizeof(UdpDataHeader), payload, payloadSize);
+
+  const uint32_t udpDataSize = static_cast<uint32_t>(sizeof(UdpDataHeader) + payloadSize);
+  writeUnalignBigEndian<uint32_t>(
+    datagram + udpDataSize, ~CRC_calcCrc32CBlock(datagram, udpDataSize, CRC_DEFAULT_INIT_VALUE32));
+  return udpDataSize + sizeof(uint32_t);
+}
+
+} // namespace visionary
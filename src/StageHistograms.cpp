@@ -0,0 +1,218 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/StageHistograms.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace visionary {
+
+namespace InstrumentationStage {
+const char* getName(Enum stage)
+{
+  switch (stage)
+  {
+    case RECEIVE:
+      return "receive";
+    case FRAGMENT:
+      return "fragment";
+    case RECORD:
+      return "record";
+    case PARSE:
+      return "parse";
+    case APPLICATION:
+      return "application";
+    case XML:
+      return "xml";
+    case DEPTHMAP_CRC:
+      return "depthmap_crc";
+    case DEPTHMAP_COPY:
+      return "depthmap_copy";
+    default:
+      return "unknown";
+  }
+}
+} // namespace InstrumentationStage
+
+double HistogramSnapshot::getMean() const
+{
+  return (count != 0u) ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+uint64_t HistogramSnapshot::getPercentile(double quantile) const
+{
+  uint64_t total = 0u;
+  for (uint64_t bucket : buckets)
+  {
+    total += bucket;
+  }
+  if (total == 0u)
+  {
+    return 0u;
+  }
+
+  // rank of the quantile, counted from 1
+  const uint64_t rank =
+    std::max<uint64_t>(1u, static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5));
+  uint64_t numBelow = 0u;
+  for (std::size_t idx = 0u; idx < buckets.size(); ++idx)
+  {
+    numBelow += buckets[idx];
+    if (numBelow >= rank)
+    {
+      return std::min(LatencyHistogram::getBucketUpperBound(idx), max);
+    }
+  }
+  return max;
+}
+
+constexpr int LatencyHistogram::SUB_BUCKET_BITS;
+constexpr int LatencyHistogram::MAX_EXPONENT;
+constexpr std::size_t LatencyHistogram::NUM_BUCKETS;
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+std::size_t LatencyHistogram::getBucketIndex(uint64_t nanoseconds)
+{
+  const uint64_t subBuckets = uint64_t(1) << SUB_BUCKET_BITS;
+  if (nanoseconds < subBuckets)
+  {
+    return static_cast<std::size_t>(nanoseconds);
+  }
+  if (nanoseconds >= (uint64_t(1) << MAX_EXPONENT))
+  {
+    return NUM_BUCKETS - 1u;
+  }
+
+#if defined(__GNUC__)
+  const int exponent = 63 - __builtin_clzll(nanoseconds);
+#else
+  int exponent = SUB_BUCKET_BITS;
+  while ((nanoseconds >> (exponent + 1)) != 0u)
+  {
+    ++exponent;
+  }
+#endif
+  const uint64_t mantissa = (nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (subBuckets - 1u);
+  return static_cast<std::size_t>(((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) +
+                                  mantissa);
+}
+
+uint64_t LatencyHistogram::getBucketLowerBound(std::size_t index)
+{
+  const uint64_t subBuckets = uint64_t(1) << SUB_BUCKET_BITS;
+  if (index < subBuckets)
+  {
+    return index;
+  }
+  const int exponent      = static_cast<int>(index >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+  const uint64_t mantissa = index & (subBuckets - 1u);
+  return (subBuckets + mantissa) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(std::size_t index)
+{
+  if ((index + 1u) < NUM_BUCKETS)
+  {
+    return getBucketLowerBound(index + 1u);
+  }
+  return std::numeric_limits<uint64_t>::max();
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+  m_buckets[getBucketIndex(nanoseconds)].fetch_add(1u, std::memory_order_relaxed);
+  m_count.fetch_add(1u, std::memory_order_relaxed);
+  m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while ((nanoseconds > max) &&
+         !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+  {
+  }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+  HistogramSnapshot snapshot;
+  snapshot.count = m_count.load(std::memory_order_relaxed);
+  snapshot.sum   = m_sum.load(std::memory_order_relaxed);
+  snapshot.max   = m_max.load(std::memory_order_relaxed);
+  snapshot.buckets.resize(NUM_BUCKETS);
+  for (std::size_t idx = 0u; idx < NUM_BUCKETS; ++idx)
+  {
+    snapshot.buckets[idx] = m_buckets[idx].load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+void LatencyHistogram::reset()
+{
+  for (std::atomic<uint64_t>& bucket : m_buckets)
+  {
+    bucket.store(0u, std::memory_order_relaxed);
+  }
+  m_count.store(0u, std::memory_order_relaxed);
+  m_sum.store(0u, std::memory_order_relaxed);
+  m_max.store(0u, std::memory_order_relaxed);
+}
+
+StageHistograms::StageHistograms()
+  : m_enabled(false)
+{
+}
+
+void StageHistograms::setEnabled(bool enabled)
+{
+  m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool StageHistograms::isEnabled() const
+{
+  return m_enabled.load(std::memory_order_relaxed);
+}
+
+void StageHistograms::record(InstrumentationStage::Enum stage,
+                             std::chrono::steady_clock::duration duration)
+{
+  const int64_t nanoseconds =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  m_histograms[stage].record((nanoseconds > 0) ? static_cast<uint64_t>(nanoseconds) : 0u);
+}
+
+HistogramSnapshot StageHistograms::snapshot(InstrumentationStage::Enum stage) const
+{
+  return m_histograms[stage].snapshot();
+}
+
+void StageHistograms::reset()
+{
+  for (LatencyHistogram& histogram : m_histograms)
+  {
+    histogram.reset();
+  }
+}
+
+} // namespace visionary
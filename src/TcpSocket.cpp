@@ -23,6 +23,13 @@
 
 namespace visionary {
 
+TcpSocket::TcpSocket()
+  : m_socket(INVALID_SOCKET)
+  , m_socketServer(INVALID_SOCKET)
+  , m_socketTcp(INVALID_SOCKET)
+{
+}
+
 int TcpSocket::connect(const std::string& hostname, uint16_t port)
 {
   int iResult = 0;
@@ -99,6 +106,13 @@ int TcpSocket::openServer(uint16_t port)
     return (int)INVALID_SOCKET;
   }
 
+#ifndef _WIN32
+  // allow to listen again on the port while connections of a previous server are in TIME_WAIT
+  int reuseAddress = 1;
+  setsockopt(
+    m_socketServer, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddress, sizeof(reuseAddress));
+#endif
+
   //-----------------------------------------------
   // Bind the socket to any address and the specified port.
   sockaddr_in server;
@@ -172,15 +186,21 @@ bool TcpSocket::WaitForConnection()
 int TcpSocket::shutdown()
 {
   // Close the socket when finished receiving datagrams
+  // only the sockets which have been opened
+  SOCKET sockets[] = {m_socket, m_socketServer, m_socketTcp};
+  for (SOCKET socket : sockets)
+  {
+    if (socket != INVALID_SOCKET)
+    {
 #ifdef _WIN32
-  closesocket(m_socket);
-  closesocket(m_socketServer);
-  closesocket(m_socketTcp);
-  WSACleanup();
+      closesocket(socket);
 #else
-  close(m_socket);
-  close(m_socketServer);
-  close(m_socketTcp);
+      close(socket);
+#endif
+    }
+  }
+#ifdef _WIN32
+  WSACleanup();
 #endif
   m_socket       = INVALID_SOCKET;
   m_socketServer = INVALID_SOCKET;
@@ -189,10 +209,43 @@ int TcpSocket::shutdown()
   return 0;
 }
 
+int TcpSocket::shutdownConnection()
+{
+  if (m_socket == INVALID_SOCKET)
+  {
+    return 0;
+  }
+#ifdef _WIN32
+  return ::shutdown(m_socket, SD_BOTH);
+#else
+  return ::shutdown(m_socket, SHUT_RDWR);
+#endif
+}
+
+int TcpSocket::closeConnection()
+{
+  int iResult = 0;
+  if (m_socket != INVALID_SOCKET)
+  {
+#ifdef _WIN32
+    iResult = closesocket(m_socket);
+#else
+    iResult = close(m_socket);
+#endif
+    m_socket = INVALID_SOCKET;
+  }
+  return iResult;
+}
+
 int TcpSocket::send(const std::vector<std::uint8_t>& buffer)
 {
-  // send buffer via TCP socket
-  return ::send(m_socket, (char*)buffer.data(), static_cast<int>(buffer.size()), 0);
+  // send buffer via TCP socket, a closed connection is reported by the result instead of SIGPIPE
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+  return ::send(m_socket, (char*)buffer.data(), static_cast<int>(buffer.size()), flags);
 }
 
 int TcpSocket::recv(std::vector<std::uint8_t>& buffer, std::size_t maxBytesToReceive)
@@ -0,0 +1,321 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/TemporalDepthFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define TEMPORAL_DEPTH_FILTER_SSE2
+#endif
+
+namespace visionary {
+
+namespace {
+inline bool isValid(uint16_t value)
+{
+  return value != 0 && value != uint16_t(0xFFFF);
+}
+
+/// Moving average step of a single pixel, identical to the vectorized version
+inline uint16_t emaPixel(uint16_t value, float& state, float alpha, float jumpThreshold)
+{
+  if (!isValid(value))
+  {
+    return 0;
+  }
+  const float x    = static_cast<float>(value);
+  const float diff = x - state;
+  if (!(state > 0.f) || (std::fabs(diff) > jumpThreshold * state))
+  {
+    state = x;
+  }
+  else
+  {
+    state = state + alpha * diff;
+  }
+  return static_cast<uint16_t>(std::lrint(state));
+}
+
+/// Median step of a single pixel, identical to the vectorized version
+inline uint16_t medianPixel(uint16_t value,
+                            uint16_t* ring,
+                            size_t ringStride,
+                            int historySize,
+                            int ringIndex,
+                            uint16_t& lastOutput,
+                            uint16_t jumpFactor)
+{
+  const bool valid       = isValid(value);
+  const uint16_t absDiff = (value > lastOutput) ? value - lastOutput : lastOutput - value;
+  const uint16_t limit =
+    static_cast<uint16_t>((static_cast<uint32_t>(lastOutput) * jumpFactor) >> 16);
+  if (valid && (lastOutput != 0) && (absDiff > limit))
+  {
+    for (int j = 0; j < historySize; j++)
+    {
+      ring[j * ringStride] = 0;
+    }
+  }
+  ring[ringIndex * ringStride] = value;
+  if (!valid)
+  {
+    lastOutput = 0;
+    return 0;
+  }
+
+  uint16_t values[TemporalDepthFilter::MAX_HISTORY_SIZE] = {};
+  int numValid = 0;
+  for (int j = 0; j < historySize; j++)
+  {
+    const uint16_t sample = ring[j * ringStride];
+    if (isValid(sample))
+    {
+      values[numValid++] = sample;
+    }
+  }
+  uint16_t* median = values + (numValid - 1) / 2;
+  std::nth_element(values, median, values + numValid);
+  lastOutput = *median;
+  return *median;
+}
+} // namespace
+
+const int TemporalDepthFilter::MAX_HISTORY_SIZE;
+
+TemporalDepthFilter::TemporalDepthFilter(Mode mode, int historySize)
+  : m_mode(mode)
+  , m_historySize(std::max(1, std::min(historySize, MAX_HISTORY_SIZE)))
+  , m_alpha(0.3f)
+  , m_jumpThreshold(0.05f)
+  , m_ringIndex(0)
+{
+}
+
+TemporalDepthFilter::~TemporalDepthFilter() {}
+
+void TemporalDepthFilter::setMode(Mode mode)
+{
+  m_mode = mode;
+  reset();
+}
+
+TemporalDepthFilter::Mode TemporalDepthFilter::getMode() const
+{
+  return m_mode;
+}
+
+void TemporalDepthFilter::setHistorySize(int historySize)
+{
+  m_historySize = std::max(1, std::min(historySize, MAX_HISTORY_SIZE));
+  m_ring.clear();
+  reset();
+}
+
+int TemporalDepthFilter::getHistorySize() const
+{
+  return m_historySize;
+}
+
+void TemporalDepthFilter::setSmoothingFactor(float alpha)
+{
+  m_alpha = std::max(0.f, std::min(alpha, 1.f));
+}
+
+void TemporalDepthFilter::setJumpThreshold(float relativeThreshold)
+{
+  m_jumpThreshold = std::max(0.f, relativeThreshold);
+}
+
+void TemporalDepthFilter::reset()
+{
+  std::fill(m_emaState.begin(), m_emaState.end(), 0.f);
+  std::fill(m_ring.begin(), m_ring.end(), 0u);
+  std::fill(m_lastOutput.begin(), m_lastOutput.end(), 0u);
+  m_ringIndex = 0;
+}
+
+void TemporalDepthFilter::apply(const std::vector<uint16_t>& distanceMap,
+                                std::vector<uint16_t>& filteredMap)
+{
+  const size_t numPixels = distanceMap.size();
+  filteredMap.resize(numPixels);
+
+  if (Mode::EMA == m_mode)
+  {
+    if (m_emaState.size() != numPixels)
+    {
+      m_emaState.assign(numPixels, 0.f);
+    }
+    applyEma(distanceMap.data(), filteredMap.data(), numPixels);
+  }
+  else
+  {
+    if ((m_lastOutput.size() != numPixels) ||
+        (m_ring.size() != numPixels * static_cast<size_t>(m_historySize)))
+    {
+      m_ring.assign(numPixels * m_historySize, 0u);
+      m_lastOutput.assign(numPixels, 0u);
+      m_ringIndex = 0;
+    }
+    applyMedian(distanceMap.data(), filteredMap.data(), numPixels);
+    m_ringIndex = (m_ringIndex + 1) % m_historySize;
+  }
+}
+
+void TemporalDepthFilter::applyEma(const uint16_t* input, uint16_t* output, size_t count)
+{
+  float* state = m_emaState.data();
+  size_t i     = 0u;
+#ifdef TEMPORAL_DEPTH_FILTER_SSE2
+  const __m128i zero     = _mm_setzero_si128();
+  const __m128i ones     = _mm_set1_epi32(-1);
+  const __m128i bias32   = _mm_set1_epi32(0x8000);
+  const __m128i bias16   = _mm_set1_epi16(static_cast<short>(0x8000));
+  const __m128 alpha     = _mm_set1_ps(m_alpha);
+  const __m128 threshold = _mm_set1_ps(m_jumpThreshold);
+  const __m128 signMask  = _mm_set1_ps(-0.f);
+  const __m128 zeroPs    = _mm_setzero_ps();
+  for (; i + 8u <= count; i += 8u)
+  {
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    const __m128i invalid =
+      _mm_or_si128(_mm_cmpeq_epi16(values, zero), _mm_cmpeq_epi16(values, ones));
+
+    __m128i result[2];
+    for (int half = 0; half < 2; half++)
+    {
+      const __m128i values32 =
+        half == 0 ? _mm_unpacklo_epi16(values, zero) : _mm_unpackhi_epi16(values, zero);
+      const __m128i invalid32 =
+        half == 0 ? _mm_unpacklo_epi16(invalid, invalid) : _mm_unpackhi_epi16(invalid, invalid);
+      const __m128 invalidPs = _mm_castsi128_ps(invalid32);
+
+      const __m128 x    = _mm_cvtepi32_ps(values32);
+      const __m128 s    = _mm_loadu_ps(state + i + 4 * half);
+      const __m128 diff = _mm_sub_ps(x, s);
+
+      // restart the average for pixels without history and for jumps
+      const __m128 restart =
+        _mm_or_ps(_mm_cmple_ps(s, zeroPs),
+                  _mm_cmpgt_ps(_mm_andnot_ps(signMask, diff), _mm_mul_ps(threshold, s)));
+      const __m128 updated = _mm_add_ps(s, _mm_mul_ps(alpha, diff));
+      __m128 next = _mm_or_ps(_mm_and_ps(restart, x), _mm_andnot_ps(restart, updated));
+      next        = _mm_or_ps(_mm_and_ps(invalidPs, s), _mm_andnot_ps(invalidPs, next));
+      _mm_storeu_ps(state + i + 4 * half, next);
+
+      result[half] = _mm_andnot_si128(invalid32, _mm_cvtps_epi32(next));
+    }
+
+    // pack into unsigned 16 bit by shifting into the signed range and back
+    const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(result[0], bias32),
+                                           _mm_sub_epi32(result[1], bias32));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_xor_si128(packed, bias16));
+  }
+#endif
+  for (; i < count; i++)
+  {
+    output[i] = emaPixel(input[i], state[i], m_alpha, m_jumpThreshold);
+  }
+}
+
+void TemporalDepthFilter::applyMedian(const uint16_t* input, uint16_t* output, size_t count)
+{
+  const int historySize = m_historySize;
+  const int ringIndex   = m_ringIndex;
+  uint16_t* ring        = m_ring.data();
+  uint16_t* lastOutput  = m_lastOutput.data();
+  const uint16_t jumpFactor =
+    static_cast<uint16_t>(std::min(65535.f, std::round(m_jumpThreshold * 65536.f)));
+
+  size_t i = 0u;
+#ifdef TEMPORAL_DEPTH_FILTER_SSE2
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i ones   = _mm_set1_epi32(-1);
+  const __m128i one    = _mm_set1_epi16(1);
+  const __m128i bias   = _mm_set1_epi16(static_cast<short>(0x8000));
+  const __m128i factor = _mm_set1_epi16(static_cast<short>(jumpFactor));
+  for (; i + 8u <= count; i += 8u)
+  {
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    const __m128i last   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lastOutput + i));
+    const __m128i valid  = _mm_andnot_si128(
+      _mm_or_si128(_mm_cmpeq_epi16(values, zero), _mm_cmpeq_epi16(values, ones)), ones);
+
+    // |value - last| > last * threshold, with unsigned saturation instead of unsigned compares
+    const __m128i absDiff =
+      _mm_or_si128(_mm_subs_epu16(values, last), _mm_subs_epu16(last, values));
+    const __m128i limit = _mm_mulhi_epu16(last, factor);
+    const __m128i exceeds =
+      _mm_andnot_si128(_mm_cmpeq_epi16(_mm_subs_epu16(absDiff, limit), zero), ones);
+    const __m128i jump =
+      _mm_and_si128(_mm_andnot_si128(_mm_cmpeq_epi16(last, zero), exceeds), valid);
+
+    // update the ring, load the history and move invalid samples to the end of the sort order
+    __m128i samples[MAX_HISTORY_SIZE];
+    __m128i numValid = zero;
+    for (int j = 0; j < historySize; j++)
+    {
+      __m128i* itRing = reinterpret_cast<__m128i*>(ring + j * count + i);
+      __m128i sample  = (j == ringIndex) ? values : _mm_andnot_si128(jump, _mm_loadu_si128(itRing));
+      _mm_storeu_si128(itRing, sample);
+
+      const __m128i invalid =
+        _mm_or_si128(_mm_cmpeq_epi16(sample, zero), _mm_cmpeq_epi16(sample, ones));
+      numValid   = _mm_sub_epi16(numValid, _mm_andnot_si128(invalid, ones));
+      samples[j] = _mm_xor_si128(_mm_or_si128(sample, invalid), bias);
+    }
+
+    // odd-even transposition sort, signed compares on the biased values
+    for (int pass = 0; pass < historySize; pass++)
+    {
+      for (int j = pass & 1; j + 1 < historySize; j += 2)
+      {
+        const __m128i lower = _mm_min_epi16(samples[j], samples[j + 1]);
+        samples[j + 1]      = _mm_max_epi16(samples[j], samples[j + 1]);
+        samples[j]          = lower;
+      }
+    }
+
+    // select the lower median of the valid samples of each pixel
+    const __m128i medianIndex = _mm_srai_epi16(_mm_sub_epi16(numValid, one), 1);
+    __m128i median            = zero;
+    for (int j = 0; j < historySize; j++)
+    {
+      const __m128i select = _mm_cmpeq_epi16(medianIndex, _mm_set1_epi16(static_cast<short>(j)));
+      median = _mm_or_si128(median, _mm_and_si128(select, _mm_xor_si128(samples[j], bias)));
+    }
+    median = _mm_and_si128(median, valid);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lastOutput + i), median);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), median);
+  }
+#endif
+  for (; i < count; i++)
+  {
+    output[i] =
+      medianPixel(input[i], ring + i, count, historySize, ringIndex, lastOutput[i], jumpFactor);
+  }
+}
+
+} // namespace visionary
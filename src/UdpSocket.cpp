@@ -94,7 +94,9 @@ int UdpSocket::connect(const std::string& hostname, uint16_t port)
   return iResult;
 }
 
-int UdpSocket::bindPort(std::uint16_t port)
+constexpr int UdpSocket::DEFAULT_RECEIVE_BUFFER_SIZE;
+
+int UdpSocket::bindPort(std::uint16_t port, int receiveBufferSize)
 {
   int iResult = 0;
 
@@ -102,8 +104,8 @@ int UdpSocket::bindPort(std::uint16_t port)
 
   if (iResult >= 0)
   {
-    // set socket receive buffer size to 512kB
-    int bufferSize    = 512 * 1024;
+    // set socket receive buffer size
+    int bufferSize    = receiveBufferSize;
     int bufferSizeLen = sizeof(bufferSize);
     iResult = setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, (char*)&bufferSize, bufferSizeLen);
 
@@ -121,6 +123,21 @@ int UdpSocket::bindPort(std::uint16_t port)
   return iResult;
 }
 
+int UdpSocket::getReceiveBufferSize() const
+{
+  int bufferSize = 0;
+#ifdef _WIN32
+  int bufferSizeLen = sizeof(bufferSize);
+#else
+  socklen_t bufferSizeLen = sizeof(bufferSize);
+#endif
+  if (getsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, (char*)&bufferSize, &bufferSizeLen) != 0)
+  {
+    return -1;
+  }
+  return bufferSize;
+}
+
 int UdpSocket::shutdown()
 {
   // Close the socket when finished receiving datagrams
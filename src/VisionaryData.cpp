@@ -33,12 +33,20 @@ namespace visionary {
 
 const float bad_point = std::numeric_limits<float>::quiet_NaN();
 
+const int VisionaryData::MAX_BIN_SIZE;
+
 VisionaryData::VisionaryData()
 {
   m_frameNum            = 0;
+  // beyond any 32 bit change counter, so that the first XML segment is always parsed
+  m_changeCounter       = std::numeric_limits<uint_fast32_t>::max();
   m_cameraParams.width  = 0;
   m_cameraParams.height = 0;
   m_preCalcCamInfoType  = VisionaryData::UNKNOWN;
+
+  m_preCalcCamInfoBinnedType = VisionaryData::UNKNOWN;
+  m_preCalcCamInfoBinning    = PixelBinning::STRIDE;
+  m_preCalcCamInfoBinSize    = 0;
 }
 
 VisionaryData::~VisionaryData() {}
@@ -67,61 +75,149 @@ int VisionaryData::getItemLength(std::string dataType)
   return 0;
 }
 
+namespace {
+// Undistorted direction of the ray through the given (sub-)pixel position, scaled such that
+// multiplying with a distance in [mm] results in a point in [m].
+PointXYZ calcCamInfo(const CameraParameters& cameraParams,
+                     bool isRadial,
+                     double row,
+                     double col)
+{
+  // we map from image coordinates with origin top left and x
+  // horizontal (right) and y vertical
+  // (downwards) to camera coordinates with origin in center and x
+  // to the left and y upwards (seen
+  // from the sensor position)
+  const double yp = (cameraParams.cy - row) / cameraParams.fy;
+  const double xp = (cameraParams.cx - col) / cameraParams.fx;
+
+  // correct the camera distortion
+  const double r2 = xp * xp + yp * yp;
+  const double r4 = r2 * r2;
+  const double k  = 1 + cameraParams.k1 * r2 + cameraParams.k2 * r4;
+
+  // Undistorted direction vector of the point
+  const float x = static_cast<float>(xp * k);
+  const float y = static_cast<float>(yp * k);
+  const float z = 1.0f;
+  double s0     = 1000;
+  if (isRadial)
+  {
+    s0 = std::sqrt(x * x + y * y + z * z) * 1000;
+  }
+  PointXYZ point;
+  point.x = static_cast<float>(x / s0);
+  point.y = static_cast<float>(y / s0);
+  point.z = static_cast<float>(z / s0);
+  return point;
+}
+
+// Reduce a pixel block to a single distance value, ignoring invalid pixels.
+// Returns 0 (invalid) in case the block does not contain any valid pixel.
+uint16_t binPixelBlock(const uint16_t* blockBegin, int rowStride, int binSize, PixelBinning binning)
+{
+  uint16_t values[VisionaryData::MAX_BIN_SIZE * VisionaryData::MAX_BIN_SIZE];
+  int numValid = 0;
+  for (int row = 0; row < binSize; row++)
+  {
+    const uint16_t* itRow = blockBegin + row * rowStride;
+    for (int col = 0; col < binSize; col++)
+    {
+      const uint16_t value = itRow[col];
+      if (value != 0 && value != uint16_t(0xFFFF))
+      {
+        values[numValid++] = value;
+      }
+    }
+  }
+
+  if (numValid == 0)
+  {
+    return 0;
+  }
+  if (PixelBinning::MIN == binning)
+  {
+    return *std::min_element(values, values + numValid);
+  }
+  uint16_t* median = values + numValid / 2;
+  std::nth_element(values, median, values + numValid);
+  return *median;
+}
+
+// Polynomial approximation of atan2 with a maximal error of about 1e-5 rad. Only uses arithmetic
+// and selects, so it is much cheaper than std::atan2 and can be vectorized by the compiler.
+inline float fastAtan2(float y, float x)
+{
+  const float absX = std::fabs(x);
+  const float absY = std::fabs(y);
+  const float a    = std::min(absX, absY) / (std::max(absX, absY) + 1e-30f);
+  const float s    = a * a;
+  float angle      = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+  angle            = (absY > absX) ? 1.57079637f - angle : angle;
+  angle            = (x < 0.f) ? 3.14159274f - angle : angle;
+  return (y < 0.f) ? -angle : angle;
+}
+} // namespace
+
+void VisionaryData::getCam2WorldMatrix(const CameraParameters& cameraParams, float (&matrix)[12])
+{
+  for (int i = 0; i < 12; i++)
+  {
+    matrix[i] = static_cast<float>(cameraParams.cam2worldMatrix[i]);
+  }
+  matrix[3] /= 1000.f;
+  matrix[7] /= 1000.f;
+  matrix[11] /= 1000.f;
+}
+
 void VisionaryData::preCalcCamInfo(const ImageType& imgType)
 {
   assert(imgType != UNKNOWN); // Unknown image type for the point cloud transformation
 
+  m_preCalcCamInfo.clear();
   m_preCalcCamInfo.reserve(m_cameraParams.height * m_cameraParams.width);
 
   //-----------------------------------------------
   // transform each pixel into Cartesian coordinates
   for (int row = 0; row < m_cameraParams.height; row++)
   {
-    double yp  = (m_cameraParams.cy - row) / m_cameraParams.fy;
-    double yp2 = yp * yp;
-
     for (int col = 0; col < m_cameraParams.width; col++)
     {
-      // we map from image coordinates with origin top left and x
-      // horizontal (right) and y vertical
-      // (downwards) to camera coordinates with origin in center and x
-      // to the left and y upwards (seen
-      // from the sensor position)
-      const double xp = (m_cameraParams.cx - col) / m_cameraParams.fx;
-
-      // correct the camera distortion
-      const double r2 = xp * xp + yp2;
-      const double r4 = r2 * r2;
-      const double k  = 1 + m_cameraParams.k1 * r2 + m_cameraParams.k2 * r4;
-
-      // Undistorted direction vector of the point
-      const float x = static_cast<float>(xp * k);
-      const float y = static_cast<float>(yp * k);
-      const float z = 1.0f;
-      double s0     = 0;
-      if (RADIAL == imgType)
-      {
-        s0 = std::sqrt(x * x + y * y + z * z) * 1000;
-      }
-      else if (PLANAR == imgType)
-      {
-        s0 = 1000;
-      }
-      else
-      {
-        assert(!"Unknown image type for the point cloud transformation");
-      }
-      PointXYZ point;
-      point.x = static_cast<float>(x / s0);
-      point.y = static_cast<float>(y / s0);
-      point.z = static_cast<float>(z / s0);
-
-      m_preCalcCamInfo.push_back(point);
+      m_preCalcCamInfo.push_back(calcCamInfo(m_cameraParams, RADIAL == imgType, row, col));
     }
   }
   m_preCalcCamInfoType = imgType;
 }
 
+void VisionaryData::preCalcCamInfoBinned(const ImageType& imgType,
+                                         PixelBinning binning,
+                                         int binSize)
+{
+  assert(imgType != UNKNOWN); // Unknown image type for the point cloud transformation
+
+  const int binnedHeight = m_cameraParams.height / binSize;
+  const int binnedWidth  = m_cameraParams.width / binSize;
+
+  // STRIDE samples a single pixel, MIN and MEDIAN represent the whole block
+  const double offset =
+    (PixelBinning::STRIDE == binning) ? static_cast<double>(binSize / 2) : (binSize - 1) / 2.;
+
+  m_preCalcCamInfoBinned.clear();
+  m_preCalcCamInfoBinned.reserve(binnedHeight * binnedWidth);
+
+  for (int row = 0; row < binnedHeight; row++)
+  {
+    for (int col = 0; col < binnedWidth; col++)
+    {
+      m_preCalcCamInfoBinned.push_back(calcCamInfo(
+        m_cameraParams, RADIAL == imgType, row * binSize + offset, col * binSize + offset));
+    }
+  }
+  m_preCalcCamInfoBinnedType = imgType;
+  m_preCalcCamInfoBinning    = binning;
+  m_preCalcCamInfoBinSize    = binSize;
+}
+
 void VisionaryData::generatePointCloud(const std::vector<uint16_t>& map,
                                        const ImageType& imgType,
                                        std::vector<PointXYZ>& pointCloud)
@@ -169,6 +265,348 @@ void VisionaryData::generatePointCloud(const std::vector<uint16_t>& map,
   return;
 }
 
+void VisionaryData::generatePointCloudRegion(const std::vector<uint16_t>& map,
+                                             const ImageType& imgType,
+                                             int colBegin,
+                                             int rowBegin,
+                                             int colEnd,
+                                             int rowEnd,
+                                             std::vector<PointXYZ>& pointCloud)
+{
+  const int width  = m_cameraParams.width;
+  const int height = m_cameraParams.height;
+  if ((pointCloud.size() != map.size()) ||
+      (map.size() != static_cast<size_t>(width) * static_cast<size_t>(height)))
+  {
+    generatePointCloud(map, imgType, pointCloud);
+    return;
+  }
+  // Calculate disortion data from XML metadata once.
+  if (m_preCalcCamInfoType != imgType)
+  {
+    preCalcCamInfo(imgType);
+  }
+
+  colBegin = std::max(0, colBegin);
+  rowBegin = std::max(0, rowBegin);
+  colEnd   = std::min(width, colEnd);
+  rowEnd   = std::min(height, rowEnd);
+
+  const float f2rc =
+    static_cast<float>(m_cameraParams.f2rc / 1000.f); // PointCloud should be in [m] and not in [mm]
+
+  const float pixelSizeZ = m_scaleZ;
+
+  for (int row = rowBegin; row < rowEnd; row++)
+  {
+    const size_t rowOffset = static_cast<size_t>(row) * width;
+    for (int col = colBegin; col < colEnd; col++)
+    {
+      const uint16_t value        = map[rowOffset + col];
+      const PointXYZ& undistorted = m_preCalcCamInfo[rowOffset + col];
+      PointXYZ& point             = pointCloud[rowOffset + col];
+      if (value == 0 || value == uint16_t(0xFFFF))
+      {
+        point.x = bad_point;
+        point.y = bad_point;
+        point.z = bad_point;
+      }
+      else
+      {
+        const float distance = static_cast<float>(value) * pixelSizeZ;
+        point.x              = undistorted.x * distance;
+        point.y              = undistorted.y * distance;
+        point.z              = undistorted.z * distance - f2rc;
+      }
+    }
+  }
+}
+
+void VisionaryData::generatePointCloud(const std::vector<uint16_t>& map,
+                                       const ImageType& imgType,
+                                       PixelBinning binning,
+                                       int binSize,
+                                       std::vector<PointXYZ>& pointCloud)
+{
+  binSize = std::max(1, std::min(binSize, MAX_BIN_SIZE));
+  if (binSize == 1)
+  {
+    generatePointCloud(map, imgType, pointCloud);
+    return;
+  }
+
+  const int width        = m_cameraParams.width;
+  const int binnedHeight = m_cameraParams.height / binSize;
+  const int binnedWidth  = width / binSize;
+  if (map.size() < static_cast<size_t>(width * m_cameraParams.height))
+  {
+    pointCloud.clear();
+    return;
+  }
+
+  // Calculate the decimated distortion data from XML metadata once per binning configuration.
+  if (m_preCalcCamInfoBinnedType != imgType || m_preCalcCamInfoBinning != binning ||
+      m_preCalcCamInfoBinSize != binSize)
+  {
+    preCalcCamInfoBinned(imgType, binning, binSize);
+  }
+  pointCloud.resize(binnedHeight * binnedWidth);
+
+  const float f2rc =
+    static_cast<float>(m_cameraParams.f2rc / 1000.f); // PointCloud should be in [m] and not in [mm]
+
+  const float pixelSizeZ = m_scaleZ;
+
+  // STRIDE only reads the center pixel of each block
+  const int strideOffset = (binSize / 2) * width + binSize / 2;
+
+  std::vector<PointXYZ>::const_iterator itUndistorted = m_preCalcCamInfoBinned.begin();
+  std::vector<PointXYZ>::iterator itPC                = pointCloud.begin();
+  for (int row = 0; row < binnedHeight; row++)
+  {
+    const uint16_t* itBlock = map.data() + row * binSize * width;
+    for (int col = 0; col < binnedWidth; col++, itBlock += binSize, ++itPC, ++itUndistorted)
+    {
+      uint16_t value;
+      if (PixelBinning::STRIDE == binning)
+      {
+        value = itBlock[strideOffset];
+      }
+      else
+      {
+        value = binPixelBlock(itBlock, width, binSize, binning);
+      }
+
+      PointXYZ point;
+      // If point is valid put it to point cloud
+      if (value == 0 || value == uint16_t(0xFFFF))
+      {
+        point.x = bad_point;
+        point.y = bad_point;
+        point.z = bad_point;
+      }
+      else
+      {
+        // calculate coordinates & store in point cloud vector
+        float distance = static_cast<float>(value) * pixelSizeZ;
+        point.x        = itUndistorted->x * distance;
+        point.y        = itUndistorted->y * distance;
+        point.z        = itUndistorted->z * distance - f2rc;
+      }
+      *itPC = point;
+    }
+  }
+}
+
+void VisionaryData::generateCroppedPointCloud(const std::vector<uint16_t>& map,
+                                              const ImageType& imgType,
+                                              const PointCloudGating& gating,
+                                              std::vector<PointXYZ>& pointCloud)
+{
+  // Calculate disortion data from XML metadata once.
+  if (m_preCalcCamInfoType != imgType)
+  {
+    preCalcCamInfo(imgType);
+  }
+  size_t cloudSize = std::min(map.size(), m_preCalcCamInfo.size());
+  pointCloud.resize(cloudSize);
+
+  // Translate the range gate into raw distance values. The invalid values 0 and 0xFFFF are
+  // always outside of the gate.
+  const double minRaw = std::ceil(gating.minRange * 1000. / m_scaleZ);
+  const double maxRaw = std::floor(gating.maxRange * 1000. / m_scaleZ);
+  const uint16_t minDistance =
+    static_cast<uint16_t>(std::max(1., std::min(minRaw, static_cast<double>(0xFFFE))));
+  const uint16_t maxDistance =
+    static_cast<uint16_t>(std::max(0., std::min(maxRaw, static_cast<double>(0xFFFE))));
+
+  const float f2rc =
+    static_cast<float>(m_cameraParams.f2rc / 1000.f); // PointCloud should be in [m] and not in [mm]
+
+  const float pixelSizeZ = m_scaleZ;
+
+  float m[12];
+  getCam2WorldMatrix(m_cameraParams, m);
+
+  float b[12];
+  for (int i = 0; i < 12; i++)
+  {
+    b[i] = static_cast<float>(gating.world2boxMatrix[i]);
+  }
+
+  //-----------------------------------------------
+  // transform each pixel into Cartesian coordinates
+  std::vector<uint16_t>::const_iterator itMap   = map.begin();
+  std::vector<PointXYZ>::iterator itUndistorted = m_preCalcCamInfo.begin();
+  std::vector<PointXYZ>::iterator itPC          = pointCloud.begin();
+  for (size_t i = 0; i < cloudSize; ++i, ++itMap, ++itUndistorted)
+  {
+    PointXYZ point;
+    bool accepted = (*itMap >= minDistance) && (*itMap <= maxDistance);
+    if (accepted)
+    {
+      // calculate coordinates in the camera frame
+      const float distance = static_cast<float>((*itMap)) * pixelSizeZ;
+      const float cx       = itUndistorted->x * distance;
+      const float cy       = itUndistorted->y * distance;
+      const float cz       = itUndistorted->z * distance - f2rc;
+
+      // transform into world coordinates
+      point.x = m[0] * cx + m[1] * cy + m[2] * cz + m[3];
+      point.y = m[4] * cx + m[5] * cy + m[6] * cz + m[7];
+      point.z = m[8] * cx + m[9] * cy + m[10] * cz + m[11];
+
+      if (gating.useCropBox)
+      {
+        const float bx = b[0] * point.x + b[1] * point.y + b[2] * point.z + b[3];
+        const float by = b[4] * point.x + b[5] * point.y + b[6] * point.z + b[7];
+        const float bz = b[8] * point.x + b[9] * point.y + b[10] * point.z + b[11];
+        accepted = (bx >= gating.boxMin[0]) && (bx <= gating.boxMax[0]) &&
+                   (by >= gating.boxMin[1]) && (by <= gating.boxMax[1]) &&
+                   (bz >= gating.boxMin[2]) && (bz <= gating.boxMax[2]);
+      }
+    }
+
+    if (accepted)
+    {
+      *itPC = point;
+      ++itPC;
+    }
+    else if (!gating.removeRejected)
+    {
+      point.x = bad_point;
+      point.y = bad_point;
+      point.z = bad_point;
+      *itPC   = point;
+      ++itPC;
+    }
+  }
+  pointCloud.erase(itPC, pointCloud.end());
+}
+
+void VisionaryData::generateQuantizedPointCloud(const std::vector<uint16_t>& map,
+                                                const ImageType& imgType,
+                                                QuantizedPointCloud& pointCloud)
+{
+  // Calculate disortion data from XML metadata once.
+  if (m_preCalcCamInfoType != imgType)
+  {
+    preCalcCamInfo(imgType);
+  }
+  const size_t cloudSize = std::min(map.size(), m_preCalcCamInfo.size());
+  if (cloudSize == static_cast<size_t>(m_cameraParams.width * m_cameraParams.height))
+  {
+    pointCloud.resize(m_cameraParams.width, m_cameraParams.height);
+  }
+  else
+  {
+    pointCloud.resize(static_cast<uint32_t>(cloudSize), 1u);
+  }
+
+  // Scale the distance directly into quantization steps
+  const float invUnit    = 1.f / pointCloud.getUnit();
+  const float f2rc       = static_cast<float>(m_cameraParams.f2rc / 1000.f) * invUnit;
+  const float pixelSizeZ = m_scaleZ * invUnit;
+
+  const PointXYZ16 badPoint = {QuantizedPointCloud::INVALID_VALUE,
+                               QuantizedPointCloud::INVALID_VALUE,
+                               QuantizedPointCloud::INVALID_VALUE};
+
+  std::vector<uint16_t>::const_iterator itMap         = map.begin();
+  std::vector<PointXYZ>::const_iterator itUndistorted = m_preCalcCamInfo.begin();
+  std::vector<PointXYZ16>::iterator itPC              = pointCloud.getPoints().begin();
+  for (size_t i = 0; i < cloudSize; ++i, ++itPC, ++itMap, ++itUndistorted)
+  {
+    if (*itMap == 0 || *itMap == uint16_t(0xFFFF))
+    {
+      *itPC = badPoint;
+    }
+    else
+    {
+      const float distance = static_cast<float>((*itMap)) * pixelSizeZ;
+      itPC->x              = QuantizedPointCloud::quantize(itUndistorted->x * distance, 1.f);
+      itPC->y              = QuantizedPointCloud::quantize(itUndistorted->y * distance, 1.f);
+      itPC->z              = QuantizedPointCloud::quantize(itUndistorted->z * distance - f2rc, 1.f);
+    }
+  }
+}
+
+void VisionaryData::generateLaserScan(const std::vector<uint16_t>& map,
+                                      const ImageType& imgType,
+                                      const LaserScanConfig& config,
+                                      std::vector<float>& ranges)
+{
+  const int numBins =
+    (config.angleIncrement > 0.f) && (config.angleMax > config.angleMin)
+      ? static_cast<int>(std::ceil((config.angleMax - config.angleMin) / config.angleIncrement))
+      : 0;
+  ranges.assign(static_cast<size_t>(numBins), std::numeric_limits<float>::infinity());
+  if (numBins == 0)
+  {
+    return;
+  }
+
+  // Calculate disortion data from XML metadata once.
+  if (m_preCalcCamInfoType != imgType)
+  {
+    preCalcCamInfo(imgType);
+  }
+  const size_t numPixels = std::min(map.size(), m_preCalcCamInfo.size());
+
+  const float f2rc =
+    static_cast<float>(m_cameraParams.f2rc / 1000.f); // PointCloud should be in [m] and not in [mm]
+
+  const float pixelSizeZ = m_scaleZ;
+
+  float m[12];
+  getCam2WorldMatrix(m_cameraParams, m);
+
+  const float rangeMinSquared = config.rangeMin * config.rangeMin;
+  const float rangeMaxSquared = config.rangeMax * config.rangeMax;
+  const float binsPerRadian   = 1.f / config.angleIncrement;
+
+  // Only the squared range is compared per pixel, the square root is taken per bin at the end
+  float* itRanges = ranges.data();
+
+  std::vector<uint16_t>::const_iterator itMap         = map.begin();
+  std::vector<PointXYZ>::const_iterator itUndistorted = m_preCalcCamInfo.begin();
+  for (size_t i = 0; i < numPixels; ++i, ++itMap, ++itUndistorted)
+  {
+    if (*itMap == 0 || *itMap == uint16_t(0xFFFF))
+    {
+      continue;
+    }
+
+    const float distance = static_cast<float>((*itMap)) * pixelSizeZ;
+    const float cx       = itUndistorted->x * distance;
+    const float cy       = itUndistorted->y * distance;
+    const float cz       = itUndistorted->z * distance - f2rc;
+
+    const float wz = m[8] * cx + m[9] * cy + m[10] * cz + m[11];
+    if (!((wz >= config.minHeight) && (wz <= config.maxHeight)))
+    {
+      continue;
+    }
+    const float wx           = m[0] * cx + m[1] * cy + m[2] * cz + m[3];
+    const float wy           = m[4] * cx + m[5] * cy + m[6] * cz + m[7];
+    const float rangeSquared = wx * wx + wy * wy;
+    const float binPosition  = (fastAtan2(wy, wx) - config.angleMin) * binsPerRadian;
+
+    const bool inRange = (rangeSquared >= rangeMinSquared) && (rangeSquared <= rangeMaxSquared);
+    const bool inAngle = (binPosition >= 0.f) && (binPosition < static_cast<float>(numBins));
+    if (inRange && inAngle)
+    {
+      float& binRange = itRanges[static_cast<int>(binPosition)];
+      binRange        = std::min(binRange, rangeSquared);
+    }
+  }
+
+  for (int bin = 0; bin < numBins; bin++)
+  {
+    itRanges[bin] = std::sqrt(itRanges[bin]);
+  }
+}
+
 void VisionaryData::transformPointCloud(std::vector<PointXYZ>& pointCloud) const
 {
   // turn cam 2 world translations from [m] to [mm]
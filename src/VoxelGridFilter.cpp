@@ -0,0 +1,261 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/VoxelGridFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace visionary {
+
+namespace {
+/// Number of key bits sorted per radix sort pass
+constexpr uint32_t RADIX_BITS = 11u;
+constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+/// Maximal number of bits of the voxel index per axis, so that all three fit into one key
+constexpr uint32_t MAX_AXIS_BITS = 21u;
+
+/// Number of bits needed to represent the values 0..maxValue
+uint32_t bitWidth(uint32_t maxValue)
+{
+  uint32_t bits = 0u;
+  while ((maxValue >> bits) != 0u)
+  {
+    bits++;
+  }
+  return bits;
+}
+
+/// Integer coordinate of the voxel containing the given finite value, the grid is anchored at 0
+int64_t voxelCoordinate(float value, float invLeafSize)
+{
+  // clamped far outside of the key range, so that the conversion is defined for any value
+  const double limit      = static_cast<double>(int64_t(1) << 52);
+  const double coordinate = std::floor(static_cast<double>(value) * invLeafSize);
+  return static_cast<int64_t>(std::max(-limit, std::min(coordinate, limit)));
+}
+
+/// Index of the voxel relative to the lowest occupied voxel coordinate, limited to maxIndex
+uint32_t voxelIndex(int64_t coordinate, int64_t minCoordinate, uint32_t maxIndex)
+{
+  return static_cast<uint32_t>(std::min<int64_t>(coordinate - minCoordinate, maxIndex));
+}
+
+bool isFinite(const PointXYZ& point)
+{
+  return std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z);
+}
+} // namespace
+
+VoxelGridFilter::VoxelGridFilter(float leafSize, Mode mode, std::size_t maxPoints)
+  : m_leafSize(leafSize)
+  , m_mode(mode)
+  , m_histogram(RADIX_SIZE)
+{
+  reserve(maxPoints);
+}
+
+VoxelGridFilter::~VoxelGridFilter() {}
+
+void VoxelGridFilter::reserve(std::size_t maxPoints)
+{
+  m_keys.reserve(maxPoints);
+  m_keysScratch.reserve(maxPoints);
+  m_indices.reserve(maxPoints);
+  m_indicesScratch.reserve(maxPoints);
+}
+
+void VoxelGridFilter::setLeafSize(float leafSize)
+{
+  m_leafSize = leafSize;
+}
+
+float VoxelGridFilter::getLeafSize() const
+{
+  return m_leafSize;
+}
+
+void VoxelGridFilter::setMode(Mode mode)
+{
+  m_mode = mode;
+}
+
+VoxelGridFilter::Mode VoxelGridFilter::getMode() const
+{
+  return m_mode;
+}
+
+void VoxelGridFilter::filter(const std::vector<PointXYZ>& input, std::vector<PointXYZ>& output)
+{
+  output.clear();
+  if (input.empty() || !(m_leafSize > 0.f))
+  {
+    return;
+  }
+
+  //-----------------------------------------------
+  // Voxel coordinates spanned by the valid points. The grid is anchored at the origin like in PCL,
+  // so a static point falls into the same voxel in every frame.
+  const float invLeafSize = 1.f / m_leafSize;
+  int64_t minX            = std::numeric_limits<int64_t>::max();
+  int64_t minY            = minX;
+  int64_t minZ            = minX;
+  int64_t maxX            = std::numeric_limits<int64_t>::min();
+  int64_t maxY            = maxX;
+  int64_t maxZ            = maxX;
+  for (std::vector<PointXYZ>::const_iterator it = input.begin(); it != input.end(); ++it)
+  {
+    if (!isFinite(*it))
+    {
+      continue;
+    }
+    const int64_t x = voxelCoordinate(it->x, invLeafSize);
+    const int64_t y = voxelCoordinate(it->y, invLeafSize);
+    const int64_t z = voxelCoordinate(it->z, invLeafSize);
+    minX            = std::min(minX, x);
+    minY            = std::min(minY, y);
+    minZ            = std::min(minZ, z);
+    maxX            = std::max(maxX, x);
+    maxY            = std::max(maxY, y);
+    maxZ            = std::max(maxZ, z);
+  }
+  if (minX > maxX)
+  {
+    // no valid point at all
+    return;
+  }
+
+  const uint32_t maxIndex = (1u << MAX_AXIS_BITS) - 1u;
+  const uint32_t numX     = voxelIndex(maxX, minX, maxIndex);
+  const uint32_t numY     = voxelIndex(maxY, minY, maxIndex);
+  const uint32_t numZ     = voxelIndex(maxZ, minZ, maxIndex);
+  const uint32_t bitsY    = bitWidth(numY);
+  const uint32_t bitsZ    = bitWidth(numZ);
+
+  //-----------------------------------------------
+  // Voxel key of each valid point
+  m_keys.resize(input.size());
+  m_indices.resize(input.size());
+  std::size_t numPoints = 0u;
+  for (std::size_t i = 0u; i < input.size(); i++)
+  {
+    const PointXYZ& point = input[i];
+    if (!isFinite(point))
+    {
+      continue;
+    }
+    const uint64_t ix    = voxelIndex(voxelCoordinate(point.x, invLeafSize), minX, numX);
+    const uint64_t iy    = voxelIndex(voxelCoordinate(point.y, invLeafSize), minY, numY);
+    const uint64_t iz    = voxelIndex(voxelCoordinate(point.z, invLeafSize), minZ, numZ);
+    m_keys[numPoints]    = (ix << (bitsY + bitsZ)) | (iy << bitsZ) | iz;
+    m_indices[numPoints] = static_cast<uint32_t>(i);
+    numPoints++;
+  }
+
+  sortByKey(numPoints, bitWidth(numX) + bitsY + bitsZ);
+
+  //-----------------------------------------------
+  // Reduce each run of equal keys to one point
+  std::size_t runBegin = 0u;
+  while (runBegin < numPoints)
+  {
+    const uint64_t key = m_keys[runBegin];
+    std::size_t runEnd = runBegin + 1u;
+    while (runEnd < numPoints && m_keys[runEnd] == key)
+    {
+      runEnd++;
+    }
+
+    if (Mode::FIRST_POINT == m_mode)
+    {
+      // the radix sort is stable, so the run starts with the first point of the input
+      output.push_back(input[m_indices[runBegin]]);
+    }
+    else
+    {
+      double sumX = 0.;
+      double sumY = 0.;
+      double sumZ = 0.;
+      for (std::size_t i = runBegin; i < runEnd; i++)
+      {
+        const PointXYZ& point = input[m_indices[i]];
+        sumX += point.x;
+        sumY += point.y;
+        sumZ += point.z;
+      }
+      const double count = static_cast<double>(runEnd - runBegin);
+      PointXYZ centroid;
+      centroid.x = static_cast<float>(sumX / count);
+      centroid.y = static_cast<float>(sumY / count);
+      centroid.z = static_cast<float>(sumZ / count);
+      output.push_back(centroid);
+    }
+    runBegin = runEnd;
+  }
+}
+
+void VoxelGridFilter::sortByKey(std::size_t numPoints, uint32_t keyBits)
+{
+  if (numPoints == 0u)
+  {
+    return;
+  }
+
+  m_keysScratch.resize(m_keys.size());
+  m_indicesScratch.resize(m_indices.size());
+
+  for (uint32_t shift = 0u; shift < keyBits; shift += RADIX_BITS)
+  {
+    std::fill(m_histogram.begin(), m_histogram.end(), 0u);
+    for (std::size_t i = 0u; i < numPoints; i++)
+    {
+      m_histogram[(m_keys[i] >> shift) & (RADIX_SIZE - 1u)]++;
+    }
+
+    // skip passes in which all keys have the same digit
+    if (m_histogram[(m_keys[0] >> shift) & (RADIX_SIZE - 1u)] == numPoints)
+    {
+      continue;
+    }
+
+    // exclusive prefix sum: start position of each digit
+    uint32_t position = 0u;
+    for (uint32_t digit = 0u; digit < RADIX_SIZE; digit++)
+    {
+      const uint32_t count = m_histogram[digit];
+      m_histogram[digit]   = position;
+      position += count;
+    }
+
+    for (std::size_t i = 0u; i < numPoints; i++)
+    {
+      const uint32_t target    = m_histogram[(m_keys[i] >> shift) & (RADIX_SIZE - 1u)]++;
+      m_keysScratch[target]    = m_keys[i];
+      m_indicesScratch[target] = m_indices[i];
+    }
+    m_keys.swap(m_keysScratch);
+    m_indices.swap(m_indicesScratch);
+  }
+}
+
+} // namespace visionary
@@ -0,0 +1,156 @@
+// -- BEGIN LICENSE BLOCK ----------------------------------------------
+/*!
+*  Copyright (C) 2023, SICK AG, Waldkirch, Germany
+*  Copyright (C) 2023, FZI Forschungszentrum Informatik, Karlsruhe, Germany
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+
+*/
+// -- END LICENSE BLOCK ------------------------------------------------
+
+#include "sick_safevisionary_base/DeviceEmulator.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+volatile std::sig_atomic_t g_stop = 0;
+
+void onSignal(int)
+{
+  g_stop = 1;
+}
+
+void printUsage(const char* name)
+{
+  std::printf("Usage: %s [options]\n"
+              "  --tcp               stream over TCP instead of UDP\n"
+              "  --ip <address>      UDP destination address (default: 127.0.0.1)\n"
+              "  --port <port>       port of the first camera (default: 6060)\n"
+              "  --width <pixels>    image width (default: 512)\n"
+              "  --height <pixels>   image height (default: 424)\n"
+              "  --fps <rate>        frames per second per camera, 0 = unlimited (default: 30)\n"
+              "  --cameras <count>   number of cameras on consecutive ports (default: 1)\n"
+              "  --link-rate <Mbit>  UDP link rate of each camera, 0 = unlimited (default: 1000)\n"
+              "  --duration <s>      stop after the given time (default: until interrupted)\n",
+              name);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  visionary::DeviceEmulator emulator;
+  double duration = 0.0;
+  int width       = 512;
+  int height      = 424;
+
+  for (int idx = 1; idx < argc; ++idx)
+  {
+    const std::string option = argv[idx];
+    const char* value        = (idx + 1 < argc) ? argv[idx + 1] : nullptr;
+    if (option == "--tcp")
+    {
+      emulator.setProtocol(visionary::DeviceEmulator::Protocol::TCP);
+      continue;
+    }
+    if ((option == "--help") || (nullptr == value))
+    {
+      printUsage(argv[0]);
+      return (option == "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    ++idx;
+
+    if (option == "--ip")
+    {
+      emulator.setDestination(value);
+    }
+    else if (option == "--port")
+    {
+      emulator.setPort(static_cast<uint16_t>(std::atoi(value)));
+    }
+    else if (option == "--width")
+    {
+      width = std::atoi(value);
+    }
+    else if (option == "--height")
+    {
+      height = std::atoi(value);
+    }
+    else if (option == "--fps")
+    {
+      emulator.setFrameRate(std::atof(value));
+    }
+    else if (option == "--cameras")
+    {
+      emulator.setNumCameras(static_cast<unsigned int>(std::atoi(value)));
+    }
+    else if (option == "--link-rate")
+    {
+      emulator.setLinkRate(std::atof(value) * 1e6);
+    }
+    else if (option == "--duration")
+    {
+      duration = std::atof(value);
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  emulator.setResolution(width, height);
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+#ifndef _WIN32
+  // a TCP client which disconnects must not terminate the emulator
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (!emulator.start())
+  {
+    return EXIT_FAILURE;
+  }
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t lastBlobs                                 = 0u;
+  uint64_t lastBytes                                 = 0u;
+  while (!g_stop)
+  {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    const uint64_t blobs = emulator.getNumBlobsSent();
+    const uint64_t bytes = emulator.getNumBytesSent();
+    std::printf("%llu blobs/s, %.1f MB/s\n",
+                static_cast<unsigned long long>(blobs - lastBlobs),
+                static_cast<double>(bytes - lastBytes) / 1e6);
+    lastBlobs = blobs;
+    lastBytes = bytes;
+
+    const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if ((duration > 0.0) && (elapsed >= duration))
+    {
+      break;
+    }
+  }
+
+  emulator.stop();
+  return EXIT_SUCCESS;
+}